@@ -32,6 +32,7 @@ typedef struct
     time_t bdmModifiedDVDPrev;
     int bdmGameCount;
     base_game_info_t *bdmGames;
+    sb_resolve_t bdmResolve; // ISO images of bdmGames that are still to be read.
     char bdmDriver[32];
     int bdmDeviceType;      // Type of BDM device, see BDM_TYPE_* above
     int bdmDeviceTick;      // Used alongside BdmGeneration to tell if device data needs to be refreshed
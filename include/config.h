@@ -80,6 +80,7 @@ enum CONFIG_INDEX {
 #define CONFIG_OPL_DISABLE_DEBUG        "disable_debug"
 #define CONFIG_OPL_PS2LOGO              "ps2logo"
 #define CONFIG_OPL_HDD_GAME_LIST_CACHE  "hdd_game_list_cache"
+#define CONFIG_OPL_TEXTURE_CACHE        "texture_cache"
 #define CONFIG_OPL_EXIT_PATH            "exit_path"
 #define CONFIG_OPL_AUTO_SORT            "autosort"
 #define CONFIG_OPL_AUTO_REFRESH         "autorefresh"
@@ -133,18 +134,30 @@ enum CONFIG_INDEX {
 
 struct config_value_t
 {
-    // Including the NULL terminator
-    char key[CONFIG_KEY_NAME_LEN];
-    char val[CONFIG_KEY_VALUE_LEN];
+    // Both are stored in the blocks of the config set. At most CONFIG_KEY_NAME_LEN and CONFIG_KEY_VALUE_LEN long, including the NULL terminator.
+    char *key;
+    char *val;
+    u32 hash;
+    // Room for the value, including the NULL terminator
+    u16 valSize;
 
     struct config_value_t *next;
 };
 
+struct config_block;
+
 typedef struct
 {
     int type;
+    // The values, in the order they were added
     struct config_value_t *head;
     struct config_value_t *tail;
+    // Open-addressing index of the values by key, with at least twice as many slots as values
+    struct config_value_t **index;
+    unsigned int indexMask;
+    unsigned int count;
+    // The values, keys and strings are allocated from these blocks, which are freed together by configClear()
+    struct config_block *blocks;
     char *filename;
     int modified;
     u32 uid;
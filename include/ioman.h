@@ -10,11 +10,38 @@
 #define IO_ERR_DUPLICIT_HANDLER     -3
 #define IO_ERR_INVALID_HANDLER      -4
 #define IO_ERR_IO_BLOCKED           -5
+#define IO_ERR_NO_MEMORY            -6
+
+// Request priorities. Requests are processed in the order they were queued, the more urgent priorities first.
+#define IO_PRIORITY_HIGH   0 // the user is waiting for it
+#define IO_PRIORITY_NORMAL 1
+#define IO_PRIORITY_LOW    2 // background work: prefetching, polling the devices
+#define IO_PRIORITY_COUNT  3
+
+// ioPutRequestEx flags
+#define IO_REQ_COALESCE 0x01 // not queued again if a request of the same type and data is still waiting
 
 typedef void (*io_request_handler_t)(void *request);
 
 typedef void (*io_simpleaction_t)(void);
 
+/// Queue statistics, for profiling
+typedef struct
+{
+    /// requests waiting, per priority
+    unsigned int depth[IO_PRIORITY_COUNT];
+    /// most requests waiting at once
+    unsigned int peakDepth;
+    unsigned int processed;
+    /// requests that were not queued, because the same request was still waiting
+    unsigned int coalesced;
+    /// requests dropped before being processed
+    unsigned int cancelled;
+    /// time the requests waited in the queue, in ms: recent average and longest
+    unsigned int waitAvg;
+    unsigned int waitMax;
+} io_stats_t;
+
 /** initializes the io worker thread */
 void ioInit(void);
 
@@ -24,21 +51,42 @@ void ioEnd(void);
 /** registers a handler for a certain request type */
 int ioRegisterHandler(int type, io_request_handler_t handler);
 
-/** schedules a new request into the pending request list
+/** registers a handler for a certain request type, with a function that is given the data of the requests that are dropped
+ * (by ioRemoveRequests, or because they were cancelled) instead of being processed */
+int ioRegisterHandlerEx(int type, io_request_handler_t handler, io_request_handler_t release);
+
+/** schedules a new request into the pending request list, with the normal priority
  * @note The data are not freed! */
 int ioPutRequest(int type, void *data);
 
-/** removes all requests of a given type from the queue
+/** schedules a new request into the pending request list
+ * @param priority one of IO_PRIORITY_*
+ * @param flags IO_REQ_* flags. A request that is coalesced with one that is waiting gives it its priority, if that is more urgent.
+ * @param token cancellation token, or NULL: the request is dropped if the value of the token changes before it is processed */
+int ioPutRequestEx(int type, void *data, int priority, int flags, const int *token);
+
+/** removes all requests of a given type from the queue, and waits for the one being processed (if any) to complete
  * @param type the type of the requests to remove
  * @return the count of the requests removed */
 int ioRemoveRequests(int type);
 
+/** removes the requests that were cancelled with the given token from the queue, without waiting for the I/O thread to reach them.
+ * A request that was cancelled while being processed is not waited for: it completes, and its handler has to cope with that.
+ * @return the count of the requests removed */
+int ioCancelRequests(const int *token);
+
 /** returns the count of pending requests */
 int ioGetPendingRequestCount(void);
 
 /** returns nonzero if there are any pending io requests */
 int ioHasPendingRequests(void);
 
+/** returns nonzero if there are pending io requests of the given priority, or of a more urgent one */
+int ioHasPendingRequestsAt(int priority);
+
+/** fills in the queue statistics */
+void ioGetStats(io_stats_t *stats);
+
 /** returns nonzero if the io thread is running */
 int ioIsRunning(void);
 
@@ -2,6 +2,7 @@
 #define __IOSUPPORT_H
 
 #include "include/config.h"
+#include "include/textures.h"
 
 #define IO_MODE_SELECTED_NONE -1
 #define IO_MODE_SELECTED_ALL  MODE_COUNT
@@ -137,7 +138,7 @@ typedef struct _item_list_t
 
     config_set_t *(*itemGetConfig)(item_list_t *itemList, int id);
 
-    int (*itemGetImage)(item_list_t *itemList, char *folder, int isRelative, char *value, char *suffix, GSTEXTURE *resultTex, short psm);
+    int (*itemGetImage)(item_list_t *itemList, char *folder, int isRelative, char *value, char *suffix, GSTEXTURE *resultTex, const tex_fit_t *fit);
 
     void (*itemCleanUp)(item_list_t *itemList, int exception);
 
@@ -146,6 +147,10 @@ typedef struct _item_list_t
     int (*itemCheckVMC)(item_list_t *itemList, char *name, int createSize);
 
     int (*itemIconId)(item_list_t *itemList);
+
+    /** Reads the details of the next game that itemUpdate() could only list by name (set callback to NULL if not applicable).
+     * @return 1 if the game was read, -1 if it could not be read, 0 if there are no games left to read. */
+    int (*itemResolve)(item_list_t *itemList, int *id);
 } item_list_t;
 
 #endif
@@ -52,6 +52,7 @@
 #define IO_MENU_UPDATE_DEFFERED   2
 #define IO_CACHE_LOAD_ART         3 // io call to handle the loading of covers
 #define IO_COMPAT_UPDATE_DEFFERED 4
+#define IO_MENU_RESOLVE_DEFFERED  5 // reads the games that were listed by name only, a few at a time
 
 // Codes have been planned to fit the design of the GUI functions within gui.c.
 #define OPL_COMPAT_UPDATE_STAT_WIP        0
@@ -63,7 +64,7 @@
 #define OPL_VMODE_CHANGE_CONFIRMATION_TIMEOUT_MS 10000
 
 int oplPath2Mode(const char *path);
-int oplGetAppImage(const char *device, char *folder, int isRelative, char *value, char *suffix, GSTEXTURE *resultTex, short psm);
+int oplGetAppImage(const char *device, char *folder, int isRelative, char *value, char *suffix, GSTEXTURE *resultTex, const tex_fit_t *fit);
 int oplScanApps(int (*callback)(const char *path, config_set_t *appConfig, void *arg), void *arg);
 int oplShouldAppsUpdate(void);
 config_set_t *oplGetLegacyAppsConfig(void);
@@ -138,6 +139,7 @@ extern int gYOff;
 extern int gOverscan;
 extern int gSelectButton;
 extern int gHDDGameListCache;
+extern int gTextureCache;
 
 extern int gEnableSFX;
 extern int gEnableBootSND;
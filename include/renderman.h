@@ -54,6 +54,17 @@ typedef struct
     GSTEXTURE *txt;
 } rm_quad_t;
 
+/// VRAM use of the textures
+typedef struct
+{
+    u32 uploadBytes; ///< Bytes of textures uploaded in the last frame
+    u32 uploadPeak;  ///< Most bytes uploaded in one frame
+    u32 deferred;    ///< New textures put off to the next frame in the last frame, for being over the upload budget
+    u32 evictions;   ///< Textures evicted to stay within the VRAM budget
+    u32 resident;    ///< Bytes of VRAM held by the textures
+    u32 budget;      ///< Bytes of VRAM left for the textures
+} rm_texture_stats_t;
+
 // Some convenience globals
 extern const u64 gColWhite;
 extern const u64 gColBlack;
@@ -88,6 +99,9 @@ void rmInvalidateTexture(GSTEXTURE *txt);
 /** Unload texture from texture manager, performance optimization */
 void rmUnloadTexture(GSTEXTURE *txt);
 
+/** Fills the VRAM statistics of the textures */
+void rmGetTextureStats(rm_texture_stats_t *stats);
+
 void rmDrawQuad(rm_quad_t *q);
 
 /** Queues a specified pixmap (tinted with colour) to be rendered on specified position */
@@ -37,10 +37,25 @@ typedef struct
     u8 unknown2[10];                // Always zero
 } USBExtreme_game_entry_t;
 
+struct game_cache_list;
+
+/// ISO images listed by sbReadList() before their startup IDs are known (these are not in games.bin yet). sbResolveNext() reads them one at a time.
+typedef struct
+{
+    int next;                         // Next game of the list to check.
+    int unsaved;                      // Games resolved since games.bin was last updated.
+    int failed;                       // Games that could not be read.
+    int skipUnreadable;               // The next sbReadList() drops the games that could not be read, instead of trying them again.
+    struct game_cache_list *cache[2]; // games.bin of the CD and DVD folders.
+} sb_resolve_t;
+
 int isValidIsoName(char *name, int *pNameLen);
 int sbIsSameSize(const char *prefix, int prevSize);
 int sbCreateSemaphore(void);
-int sbReadList(base_game_info_t **list, const char *prefix, int *fsize, int *gamecount);
+int sbReadList(base_game_info_t **list, const char *prefix, int *fsize, int *gamecount, sb_resolve_t *resolve);
+int sbResolveNext(base_game_info_t *list, const char *prefix, int gamecount, sb_resolve_t *resolve, int *id);
+int sbResolveGame(base_game_info_t *game, const char *prefix, sb_resolve_t *resolve);
+void sbFreeResolve(sb_resolve_t *resolve);
 int sbPrepare(base_game_info_t *game, config_set_t *configSet, int size_cdvdman, void **cdvdman_irx, int *patchindex);
 void sbUnprepare(void *pCommon);
 void sbRebuildULCfg(base_game_info_t **list, const char *prefix, int gamecount, int excludeID);
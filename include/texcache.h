@@ -16,8 +16,26 @@ typedef struct
     int lastUsed;
 
     int UID;
+
+    // loaded ahead of being displayed, and not displayed yet
+    int prefetched;
 } cache_entry_t;
 
+/// Cache statistics, reported when the cache is destroyed
+typedef struct
+{
+    /// images that were already loaded when they came into view
+    unsigned int hits;
+    /// images that had to be loaded after they came into view
+    unsigned int misses;
+    /// images loaded ahead of the scrolling
+    unsigned int prefetched;
+    /// prefetched images released before they were displayed
+    unsigned int wasted;
+    /// prefetches dropped because the scrolling direction changed
+    unsigned int cancelled;
+} cache_stats_t;
+
 
 /// One texture cache instance
 typedef struct
@@ -28,13 +46,29 @@ typedef struct
     /// count of entries (copy of the requested cache size upon cache initialization)
     int count;
 
+    /// memory the loaded images may take, in bytes (0: only limited by the entry count)
+    unsigned int budget;
+    /// memory taken by the loaded images when it was last checked
+    unsigned int used;
+
     /// directory prefix for this cache (if any)
     char *prefix;
     int isPrefixRelative;
     char *suffix;
 
+    /// size the images are shrunk to when they are loaded
+    tex_fit_t fit;
+
     int nextUID;
 
+    /// scrolling direction the prefetches are made in, and the item it was determined from
+    int direction;
+    void *anchor;
+    /// cancellation token of the prefetches, bumped when the direction changes to drop those still queued
+    int generation;
+
+    cache_stats_t stats;
+
     /// the cache entries itself
     cache_entry_t *content;
 } image_cache_t;
@@ -49,7 +83,7 @@ void cacheEnd();
 
 /** Initializes a single cache
  */
-image_cache_t *cacheInitCache(int userId, const char *prefix, int isPrefixRelative, const char *suffix, int count);
+image_cache_t *cacheInitCache(int userId, const char *prefix, int isPrefixRelative, const char *suffix, int count, unsigned int budget);
 
 /** Destroys a given cache (unallocates all memory stored there, disconnects the pixmaps from the usage points).
  */
@@ -57,4 +91,13 @@ void cacheDestroyCache(image_cache_t *cache);
 
 GSTEXTURE *cacheGetTexture(image_cache_t *cache, item_list_t *list, int *cacheId, int *UID, char *value);
 
+/** Queues the loading of an image that is not displayed yet, if the I/O thread is idle.
+ * Returns 1 if the image is already cached (the next one may be tried), 0 otherwise.
+ */
+int cachePrefetchTexture(image_cache_t *cache, item_list_t *list, int *cacheId, int *UID, char *value);
+
+/** Sets the scrolling direction (1 forward, -1 backward). Prefetches queued for the other direction are dropped.
+ */
+void cacheSetDirection(image_cache_t *cache, int direction);
+
 #endif
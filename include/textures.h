@@ -103,9 +103,18 @@ enum INTERNAL_TEXTURE {
 #define ERR_MISSING_ALPHA -6
 #define ERR_BAD_DEPTH     -7
 
+/// Size an image is drawn at, in pixels: larger images are shrunk to it when they are loaded (0: no limit).
+typedef struct
+{
+    short width;
+    short height;
+    /// reduce truecolour images to 256 colours
+    short palettize;
+} tex_fit_t;
+
 int texLookupInternalTexId(const char *name);
 int texLoadInternal(GSTEXTURE *texture, int texId);
-int texDiscoverLoad(GSTEXTURE *texture, const char *path, int texId);
+int texDiscoverLoad(GSTEXTURE *texture, const char *path, int texId, const tex_fit_t *fit);
 void texFree(GSTEXTURE *texture);
 
 #endif
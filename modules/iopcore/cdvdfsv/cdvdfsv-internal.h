@@ -13,6 +13,7 @@
 #include <sifcmd.h>
 #include <sifman.h>
 #include <sysclib.h>
+#include <sysmem.h>
 #include <thbase.h>
 #include <thevent.h>
 #include <thsemap.h>
@@ -34,7 +35,10 @@ extern void cdvdfsv_register_scmd_rpc(SifRpcDataQueue_t *rpc_DQ);
 extern void cdvdfsv_register_ncmd_rpc(SifRpcDataQueue_t *rpc_DQ);
 extern void cdvdfsv_register_searchfile_rpc(SifRpcDataQueue_t *rpc_DQ);
 extern void sysmemSendEE(void *buf, void *EE_addr, int size);
+extern int sysmemSendEEAsync(void *buf, void *EE_addr, int size);
+extern void sysmemWaitEE(int id);
 extern int sceCdChangeThreadPriority(int priority);
 extern u8 *cdvdfsv_buf;
+extern void cdvdfsv_init_pipe_buf(void);
 
 #endif
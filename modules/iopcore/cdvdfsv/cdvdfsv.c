@@ -74,6 +74,7 @@ static void init_thread(void *args)
     sceSifInitRpc(0);
 
     cdvdfsv_buf = sceGetFsvRbuf();
+    cdvdfsv_init_pipe_buf();
     cdvdfsv_startrpcthreads();
 
     ExitDeleteThread();
@@ -235,7 +236,8 @@ static void *cbrpc_shutdown(int fno, void *buf, int size)
 }
 
 //--------------------------------------------------------------
-void sysmemSendEE(void *buf, void *EE_addr, int size)
+// Starts a transfer to EE RAM. Returns its ID, for sysmemWaitEE().
+int sysmemSendEEAsync(void *buf, void *EE_addr, int size)
 {
     SifDmaTransfer_t dmat;
     int oldstate, id;
@@ -251,10 +253,20 @@ void sysmemSendEE(void *buf, void *EE_addr, int size)
         CpuResumeIntr(oldstate);
     } while (!id);
 
+    return id;
+}
+
+void sysmemWaitEE(int id)
+{
     while (sceSifDmaStat(id) >= 0)
         ;
 }
 
+void sysmemSendEE(void *buf, void *EE_addr, int size)
+{
+    sysmemWaitEE(sysmemSendEEAsync(buf, EE_addr, size));
+}
+
 //-------------------------------------------------------------------------
 int sceCdChangeThreadPriority(int priority)
 {
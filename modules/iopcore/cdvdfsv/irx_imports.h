@@ -9,6 +9,7 @@
 #include <sifcmd.h>
 #include <sifman.h>
 #include "smsutils.h"
+#include <sysmem.h>
 #include <thbase.h>
 #include <thevent.h>
 #include <thsemap.h>
@@ -99,13 +99,26 @@ enum CDVD_ST_CMDS {
 };
 
 //--------------------------------------------------------------
+/*  While the data of a chunk is being sent to the EE, the next chunk is read into a second buffer.
+    The second buffer has the size of CDVDMAN's FS buffer and is allocated once, when the module starts.
+    Without it, CDVDMAN's FS buffer is used alone, as before. */
+#define CDVDFSV_PIPE_BUF_SIZE (CDVDMAN_FS_SECTORS * 2048 + 64)
+
+static u8 *cdvdfsv_pipe_buf;
+
+void cdvdfsv_init_pipe_buf(void)
+{
+    // Taken from the top of the memory, to leave the rest unfragmented.
+    cdvdfsv_pipe_buf = AllocSysMemory(ALLOC_LAST, CDVDFSV_PIPE_BUF_SIZE, NULL);
+}
+
 static inline void cdvd_readee(void *buf)
 { // Read Disc data to EE mem buffer
     u8 curlsn_buf[16];
-    u32 nbytes, nsectors, sectors_to_read, size_64b, size_64bb, bytesent, temp;
+    u32 nbytes, nsectors, next_sectors, sectors_to_read, size_64b, size_64bb, bytesent, temp, chunk, extra;
     u16 sector_size;
-    int flag_64b, fsverror;
-    void *fsvRbuf = (void *)cdvdfsv_buf;
+    int flag_64b, fsverror, dma_id, cur;
+    u8 *rbuf[2];
     void *eeaddr_64b, *eeaddr2_64b;
     cdvdfsv_readee_t readee;
     RpcCdvd_t *r = (RpcCdvd_t *)buf;
@@ -149,7 +162,6 @@ static inline void cdvd_readee(void *buf)
     temp -= (u32)eeaddr2_64b;
     readee.pdst2 = eeaddr2_64b; // get the end address on a 64 bytes align
     readee.b2len = temp;        // get bytes remainder at end of 64 bytes align
-    fsvRbuf += temp;
 
     if (readee.b1len)
         flag_64b = 0; // 64 bytes alignment flag
@@ -160,60 +172,63 @@ static inline void cdvd_readee(void *buf)
             flag_64b = 1;
     }
 
-    while (1) {
-        do {
-            if ((sectors_to_read == 0) || (sceCdGetError() == SCECdErABRT)) {
-                sysmemSendEE((void *)&readee, (void *)r->eeaddr1, sizeof(cdvdfsv_readee_t));
-
-                *((u32 *)&curlsn_buf[0]) = nbytes;
-                sysmemSendEE((void *)curlsn_buf, (void *)r->eeaddr2, 16);
-
-                *(int *)buf = nbytes;
-                return;
-            }
-
-            if (flag_64b == 0) { // not 64 bytes aligned buf
-                // The data of the last sector of the chunk will be used to correct buffer alignment.
-                if (sectors_to_read < CDVDMAN_FS_SECTORS - 1)
-                    nsectors = sectors_to_read;
-                else
-                    nsectors = CDVDMAN_FS_SECTORS - 1;
-                temp = nsectors + 1;
-            } else { // 64 bytes aligned buf
-                if (sectors_to_read < CDVDMAN_FS_SECTORS)
-                    nsectors = sectors_to_read;
-                else
-                    nsectors = CDVDMAN_FS_SECTORS;
-                temp = nsectors;
-            }
+    // If the buffer is not 64 bytes aligned, the data of the last sector of each chunk will be used to correct buffer alignment.
+    extra = flag_64b ? 0 : 1;
 
-            if (sceCdRead(r->lsn, temp, (void *)fsvRbuf, NULL) == 0) {
-                if (sceCdGetError() == SCECdErNO) {
-                    fsverror = SCECdErREADCF;
-                    sceCdSC(CDSC_SET_ERROR, &fsverror);
-                }
+    chunk = (CDVDMAN_FS_SECTORS * 2048) / sector_size;
+    rbuf[0] = cdvdfsv_buf;
+    // Short requests are read in a single chunk. With a single buffer, each read waits for the previous transfer.
+    rbuf[1] = (cdvdfsv_pipe_buf != NULL && r->sectors + extra > chunk) ? cdvdfsv_pipe_buf : cdvdfsv_buf;
+    rbuf[0] += readee.b2len;
+    rbuf[1] += readee.b2len;
 
-                *(int *)buf = bytesent;
-                return;
-            }
-            sceCdSync(0);
+    cur = 0;
+    nsectors = (sectors_to_read < chunk - extra) ? sectors_to_read : chunk - extra;
+    if (sceCdGetError() != SCECdErABRT) {
+        if (sceCdRead(r->lsn, nsectors + extra, rbuf[cur], NULL) == 0)
+            goto read_error;
+        sceCdSync(0);
 
+        while (1) {
             size_64b = nsectors * sector_size;
             size_64bb = size_64b;
 
             if (!flag_64b) {
                 if (sectors_to_read == r->sectors) // check that was the first read. Data read will be skewed by readee.b1len bytes into the adjacent sector.
-                    memcpy((void *)readee.buf1, (void *)fsvRbuf, readee.b1len);
+                    memcpy((void *)readee.buf1, rbuf[cur], readee.b1len);
 
                 if ((sectors_to_read == nsectors) && (readee.b1len)) // For the last sector read.
                     size_64bb = size_64b - 64;
             }
 
-            if (size_64bb > 0) {
-                sysmemSendEE((void *)(fsvRbuf + readee.b1len), (void *)eeaddr_64b, size_64bb);
-                bytesent += size_64bb;
+            dma_id = (size_64bb > 0) ? sysmemSendEEAsync(rbuf[cur] + readee.b1len, eeaddr_64b, size_64bb) : 0;
+
+            // Start reading the next chunk while this one is sent.
+            next_sectors = 0;
+            if (sectors_to_read > nsectors && sceCdGetError() != SCECdErABRT) {
+                next_sectors = sectors_to_read - nsectors;
+                if (next_sectors > chunk - extra)
+                    next_sectors = chunk - extra;
+
+                if (rbuf[cur ^ 1] == rbuf[cur] && dma_id != 0) {
+                    sysmemWaitEE(dma_id);
+                    dma_id = 0;
+                }
+
+                if (sceCdRead(r->lsn + nsectors, next_sectors + extra, rbuf[cur ^ 1], NULL) == 0) {
+                    if (dma_id != 0)
+                        sysmemWaitEE(dma_id);
+                    bytesent += size_64bb;
+                    *((u32 *)&curlsn_buf[0]) = bytesent;
+                    sysmemSendEE((void *)curlsn_buf, (void *)r->eeaddr2, 16);
+                    goto read_error;
+                }
             }
 
+            if (dma_id != 0)
+                sysmemWaitEE(dma_id);
+            bytesent += size_64bb;
+
             *((u32 *)&curlsn_buf[0]) = bytesent;
             sysmemSendEE((void *)curlsn_buf, (void *)r->eeaddr2, 16);
 
@@ -221,10 +236,34 @@ static inline void cdvd_readee(void *buf)
             r->lsn += nsectors;
             eeaddr_64b += size_64b;
 
-        } while ((flag_64b) || (sectors_to_read));
+            if (sectors_to_read == 0) {
+                // At the very last pass, copy readee.b2len bytes from the last sector, to complete the alignment correction.
+                if (!flag_64b)
+                    memcpy((void *)readee.buf2, rbuf[cur] + size_64b - readee.b2len, readee.b2len);
+                break;
+            }
+
+            if (next_sectors == 0) // Aborted
+                break;
+
+            sceCdSync(0);
+            cur ^= 1;
+            nsectors = next_sectors;
+        }
+    }
+
+    sysmemSendEE((void *)&readee, (void *)r->eeaddr1, sizeof(cdvdfsv_readee_t));
+
+    *((u32 *)&curlsn_buf[0]) = nbytes;
+    sysmemSendEE((void *)curlsn_buf, (void *)r->eeaddr2, 16);
+
+    *(int *)buf = nbytes;
+    return;
 
-        // At the very last pass, copy readee.b2len bytes from the last sector, to complete the alignment correction.
-        memcpy((void *)readee.buf2, (void *)(fsvRbuf + size_64b - readee.b2len), readee.b2len);
+read_error:
+    if (sceCdGetError() == SCECdErNO) {
+        fsverror = SCECdErREADCF;
+        sceCdSC(CDSC_SET_ERROR, &fsverror);
     }
 
     *(int *)buf = bytesent;
@@ -24,6 +24,7 @@
 #include <thbase.h>
 #include <thevent.h>
 #include <thsemap.h>
+#include <intrman.h>
 #include <stdio.h>
 #include <sysclib.h>
 #include <dev9.h>
@@ -120,6 +121,11 @@ static void ata_shutdown_cb(void);
 
 int ata_device_sector_io_internal(int device, void *buf, u64 lba, u32 nsectors, int dir);
 
+/* Queue of asynchronous transfers, served by the ATA thread. */
+static ata_io_req_t *ata_queue_head, *ata_queue_tail;
+static int ata_queue_sema = -1;
+static int ata_thread_id = -1;
+
 /* In v1.04, DMA was enabled in ata_set_dir() instead. */
 static void ata_pre_dma_cb(int bcr, int dir)
 {
@@ -676,6 +682,67 @@ int ata_device_sector_io_internal(int device, void *buf, u64 lba, u32 nsectors,
     return res;
 }
 
+static void ata_io_thread(void *arg)
+{
+    ata_io_req_t *req;
+    int OldState, res;
+
+    while (1) {
+        WaitSema(ata_queue_sema);
+
+        CpuSuspendIntr(&OldState);
+        req = ata_queue_head;
+        ata_queue_head = req->next;
+        CpuResumeIntr(OldState);
+
+        res = ata_device_sector_io_internal(req->device, req->buf, req->lba, req->nsectors, req->dir);
+        req->done(req, res);
+    }
+}
+
+/* Queues a transfer and returns immediately, so that the caller can work while the device is busy.
+   The thread is created on first use, as only the ZSO reader needs it.  */
+int ata_device_sector_io_async(ata_io_req_t *req)
+{
+    iop_thread_t thread;
+    iop_sema_t smp;
+    int OldState;
+
+    if (ata_thread_id < 0) {
+        smp.initial = 0;
+        smp.max = 0xFF;
+        smp.option = 0;
+        smp.attr = 0;
+        if ((ata_queue_sema = CreateSema(&smp)) < 0)
+            return ata_queue_sema;
+
+        /* Above the reading thread, so that the next transfer starts as soon as it is queued. It mostly waits for the DMA to complete.  */
+        thread.attr = TH_C;
+        thread.option = 0;
+        thread.thread = &ata_io_thread;
+        thread.stacksize = 0x600;
+        thread.priority = 0x0e;
+        if ((ata_thread_id = CreateThread(&thread)) < 0) {
+            DeleteSema(ata_queue_sema);
+            return ata_thread_id;
+        }
+        StartThread(ata_thread_id, NULL);
+    }
+
+    req->next = NULL;
+    CpuSuspendIntr(&OldState);
+    if (ata_queue_head == NULL)
+        ata_queue_head = req;
+    else
+        ata_queue_tail->next = req;
+    ata_queue_tail = req;
+    CpuResumeIntr(OldState);
+
+    SignalSema(ata_queue_sema);
+
+    return 0;
+}
+
 /* Export 4 */
 ata_devinfo_t *sceAtaInit(int device)
 {
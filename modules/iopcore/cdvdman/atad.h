@@ -55,6 +55,22 @@ int sceAtaGetError(void);
 int sceAtaDmaTransfer(int device, void *buf, u32 lba, u32 nsectors, int dir);
 int sceAtaFlushCache(int device);
 
+/* Queued DMA transfers. The request is carried out by the ATA thread, in submission order, and done() is then called from that thread.
+   The request must remain valid until done() is called.  */
+typedef struct _ata_io_req
+{
+    struct _ata_io_req *next;
+    void *buf;
+    u64 lba;
+    u32 nsectors;
+    u8 device;
+    u8 dir;
+    void (*done)(struct _ata_io_req *req, int result);
+    void *arg;
+} ata_io_req_t;
+
+int ata_device_sector_io_async(ata_io_req_t *req);
+
 // APA Partition
 #define APA_MAGIC       0x00415041 // 'APA\0'
 #define APA_IDMAX       32
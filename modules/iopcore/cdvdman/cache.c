@@ -0,0 +1,292 @@
+/*
+  Copyright 2026, Open PS2 Loader contributors
+  Licenced under Academic Free License version 3.0
+  Review Open PS2 Loader README & LICENSE files for further details.
+*/
+
+#include "internal.h"
+
+/*
+  Sector cache, in front of the device's DeviceReadSectors().
+  Small reads are served from a set of fixed-size blocks, which are replaced in LRU order.
+  This allows games that alternate between a few files (or re-read the same TOC/index sectors) to hit the cache.
+  A miss loads all the blocks that the read spans with a single device access. When the blocks are accessed
+  sequentially, the whole cache is loaded at once, which lets the ZSO reader fetch many compressed blocks at a time.
+  Larger reads are passed through, as the device handles them efficiently and they would only evict useful blocks.
+  For ZSO images, the size is the user's cache setting (in sectors). ISO images get a smaller cache of their own,
+  which only keeps the sectors that were read (see DeviceReadSectorsISO()).
+*/
+
+#define CACHE_BLOCK_SECTORS 4
+#define CACHE_MAX_BLOCKS    16
+#define CACHE_INVALID       0xFFFFFFFF
+
+#define CACHE_BLOCK_FULL ((1 << CACHE_BLOCK_SECTORS) - 1)
+
+struct cache_block
+{
+    u32 lsn;  // First sector held, CACHE_INVALID if empty.
+    u32 age;  // Value of cache_clock when last used. 0 if empty.
+    u8 valid; // One bit per sector held. Only ISO reads leave blocks partially filled.
+};
+
+static struct cache_block cache_blocks[CACHE_MAX_BLOCKS];
+static u8 *cache_buf = NULL;
+static u8 cache_nblocks = 0;
+static u32 cache_clock = 0;
+static u32 cache_next_lsn = CACHE_INVALID; // First sector of the block after the last one used.
+static u32 iso_next_lsn = CACHE_INVALID;   // Sector after the last one read by DeviceReadSectorsISO().
+
+// Allocates the cache, once the type of image is known. Until then, all reads go straight to the device.
+void cdvdman_cache_init(unsigned int sectors)
+{
+    unsigned int i, nblocks;
+
+    nblocks = sectors / CACHE_BLOCK_SECTORS;
+    if (nblocks > CACHE_MAX_BLOCKS)
+        nblocks = CACHE_MAX_BLOCKS;
+    if (nblocks < 2 || cache_buf != NULL)
+        return;
+
+    if ((cache_buf = AllocSysMemory(ALLOC_FIRST, nblocks * CACHE_BLOCK_SECTORS * 2048, NULL)) == NULL) {
+        DPRINTF("cache: failed to allocate %u blocks\n", nblocks);
+        return;
+    }
+
+    for (i = 0; i < nblocks; i++)
+        cache_blocks[i].lsn = CACHE_INVALID;
+    cache_nblocks = nblocks;
+}
+
+static int cache_bypass(u64 lsn, unsigned int sectors)
+{
+    // If the cache is disabled, or the read is large enough, go straight to the device.
+    return (cache_nblocks == 0 || sectors >= cache_nblocks * CACHE_BLOCK_SECTORS || lsn + sectors > CACHE_INVALID);
+}
+
+// Returns the block that starts at lsn, if it is cached.
+static struct cache_block *cache_find(u32 lsn)
+{
+    unsigned int i;
+
+    for (i = 0; i < cache_nblocks; i++) {
+        if (cache_blocks[i].lsn == lsn && cache_blocks[i].valid == CACHE_BLOCK_FULL) {
+            cache_blocks[i].age = ++cache_clock;
+            return &cache_blocks[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Loads count blocks, starting from lsn, into the least recently used run of consecutive slots.
+static struct cache_block *cache_fill(u32 lsn, unsigned int count)
+{
+    struct cache_block *block;
+    unsigned int i, j, start;
+    u32 age, oldest;
+
+    // Empty blocks have an age of 0, so they are taken first.
+    start = 0;
+    oldest = CACHE_INVALID;
+    for (i = 0; i + count <= cache_nblocks; i++) {
+        for (age = 0, j = i; j < i + count; j++) {
+            if (cache_blocks[j].age > age)
+                age = cache_blocks[j].age;
+        }
+        if (age < oldest) {
+            oldest = age;
+            start = i;
+        }
+    }
+
+    block = &cache_blocks[start];
+    if (DeviceReadSectors(lsn, &cache_buf[start * CACHE_BLOCK_SECTORS * 2048], count * CACHE_BLOCK_SECTORS) != SCECdErNO) {
+        // i.e. the blocks extend beyond the end of the image.
+        for (j = 0; j < count; j++) {
+            block[j].lsn = CACHE_INVALID;
+            block[j].age = 0;
+            block[j].valid = 0;
+        }
+        return NULL;
+    }
+
+    for (j = 0; j < count; j++, lsn += CACHE_BLOCK_SECTORS) {
+        // Drop other copies of the sectors that were loaded.
+        for (i = 0; i < cache_nblocks; i++) {
+            if (cache_blocks[i].lsn == lsn) {
+                cache_blocks[i].lsn = CACHE_INVALID;
+                cache_blocks[i].age = 0;
+                cache_blocks[i].valid = 0;
+            }
+        }
+
+        block[j].lsn = lsn;
+        block[j].age = ++cache_clock;
+        block[j].valid = CACHE_BLOCK_FULL;
+    }
+    block->age = cache_clock;
+
+    return block;
+}
+
+// Loads the block at lsn and the following needed-1 blocks. Returns the first block, or NULL if it could not be read.
+static struct cache_block *cache_load(u32 lsn, unsigned int needed, int sequential)
+{
+    struct cache_block *block;
+    unsigned int count;
+
+    count = (sequential || needed > cache_nblocks) ? cache_nblocks : needed;
+
+    // If the blocks could not be read (i.e. the end of the image), load fewer.
+    for (; count > 0; count--) {
+        if ((block = cache_fill(lsn, count)) != NULL)
+            return block;
+    }
+
+    return NULL;
+}
+
+/*
+  Loads the blocks that cover the specified sectors, with a single device access.
+  For callers that will read these sectors in several parts, like the ZSO reader.
+*/
+void DeviceCacheSectors(u64 lsn, unsigned int sectors)
+{
+    u32 first, last, block;
+    int sequential;
+
+    if (sectors == 0 || cache_bypass(lsn, sectors))
+        return;
+
+    first = (u32)lsn - (u32)lsn % CACHE_BLOCK_SECTORS;
+    last = (u32)lsn + sectors - 1;
+    last -= last % CACHE_BLOCK_SECTORS;
+
+    // The previous read usually ended within the first block.
+    sequential = (first == cache_next_lsn || first + CACHE_BLOCK_SECTORS == cache_next_lsn);
+    cache_next_lsn = last + CACHE_BLOCK_SECTORS;
+
+    for (block = first; block <= last; block += CACHE_BLOCK_SECTORS) {
+        if (cache_find(block) == NULL) {
+            // Reload all the blocks, so that they stay together.
+            cache_load(first, (last - first) / CACHE_BLOCK_SECTORS + 1, sequential);
+            break;
+        }
+    }
+}
+
+int DeviceReadSectorsCached(u64 lsn, void *buffer, unsigned int sectors)
+{
+    struct cache_block *block;
+    unsigned int offset, n;
+    u32 start;
+    u8 *ptr;
+
+    if (cache_bypass(lsn, sectors))
+        return DeviceReadSectors(lsn, buffer, sectors);
+
+    for (ptr = buffer; sectors > 0; sectors -= n, lsn += n, ptr += n * 2048) {
+        offset = (u32)lsn % CACHE_BLOCK_SECTORS;
+        n = CACHE_BLOCK_SECTORS - offset;
+        if (n > sectors)
+            n = sectors;
+
+        start = (u32)lsn - offset;
+        if ((block = cache_find(start)) == NULL)
+            block = cache_load(start, (offset + sectors + CACHE_BLOCK_SECTORS - 1) / CACHE_BLOCK_SECTORS, start == cache_next_lsn);
+        cache_next_lsn = start + CACHE_BLOCK_SECTORS;
+
+        if (block == NULL)
+            return DeviceReadSectors(lsn, ptr, sectors);
+
+        memcpy(ptr, &cache_buf[((block - cache_blocks) * CACHE_BLOCK_SECTORS + offset) * 2048], n * 2048);
+    }
+
+    return SCECdErNO;
+}
+
+// Returns the block that starts at lsn, whichever of its sectors are held.
+static struct cache_block *cache_lookup(u32 lsn)
+{
+    unsigned int i;
+
+    for (i = 0; i < cache_nblocks; i++) {
+        if (cache_blocks[i].lsn == lsn)
+            return &cache_blocks[i];
+    }
+
+    return NULL;
+}
+
+// Copies the specified sectors, if they are all cached. Returns 1 if they were.
+static int cache_copy(u32 lsn, u8 *buffer, unsigned int sectors)
+{
+    struct cache_block *block;
+    unsigned int i;
+
+    for (i = 0; i < sectors; i++) {
+        block = cache_lookup(lsn + i - (lsn + i) % CACHE_BLOCK_SECTORS);
+        if (block == NULL || !(block->valid & (1 << ((lsn + i) % CACHE_BLOCK_SECTORS))))
+            return 0;
+    }
+
+    for (i = 0; i < sectors; i++) {
+        block = cache_lookup(lsn + i - (lsn + i) % CACHE_BLOCK_SECTORS);
+        block->age = ++cache_clock;
+        memcpy(&buffer[i * 2048], &cache_buf[((block - cache_blocks) * CACHE_BLOCK_SECTORS + (lsn + i) % CACHE_BLOCK_SECTORS) * 2048], 2048);
+    }
+
+    return 1;
+}
+
+// Keeps a copy of sectors that were just read. The blocks that they belong to replace the least recently used ones.
+static void cache_store(u32 lsn, const u8 *buffer, unsigned int sectors)
+{
+    struct cache_block *block;
+    unsigned int i, j, offset;
+
+    for (i = 0; i < sectors; i++) {
+        offset = (lsn + i) % CACHE_BLOCK_SECTORS;
+        if ((block = cache_lookup(lsn + i - offset)) == NULL) {
+            // Empty blocks have an age of 0, so they are taken first.
+            for (block = cache_blocks, j = 1; j < cache_nblocks; j++) {
+                if (cache_blocks[j].age < block->age)
+                    block = &cache_blocks[j];
+            }
+            block->lsn = lsn + i - offset;
+            block->valid = 0;
+        }
+
+        block->age = ++cache_clock;
+        block->valid |= 1 << offset;
+        memcpy(&cache_buf[((block - cache_blocks) * CACHE_BLOCK_SECTORS + offset) * 2048], &buffer[i * 2048], 2048);
+    }
+}
+
+/*
+  Reader for ISO images. Games re-read small TOC, path table and directory sectors, so small reads are cached.
+  A miss is read straight into the caller's buffer, and only the sectors that were read are then kept: unlike the ZSO
+  reader, nothing more is read from the device than what the game asked for.
+  Reads that continue the previous one (sequential runs, the read-ahead ring's prefetches) and reads larger than
+  half of the cache are not kept.
+*/
+int DeviceReadSectorsISO(u64 lsn, void *buffer, unsigned int sectors)
+{
+    int sequential, result;
+
+    sequential = (lsn == iso_next_lsn);
+    iso_next_lsn = (u32)(lsn + sectors);
+
+    if (sectors > cache_nblocks * CACHE_BLOCK_SECTORS / 2 || lsn + sectors > CACHE_INVALID)
+        return DeviceReadSectors(lsn, buffer, sectors);
+
+    if (cache_copy((u32)lsn, buffer, sectors))
+        return SCECdErNO;
+
+    result = DeviceReadSectors(lsn, buffer, sectors);
+    if (result == SCECdErNO && !sequential)
+        cache_store((u32)lsn, buffer, sectors);
+
+    return result;
+}
@@ -24,9 +24,14 @@ extern struct irx_export_table _exp_oplutils;
 extern struct irx_export_table _exp_dev9;
 #endif
 
-// reader function interface, raw reader impementation by default
-int DeviceReadSectorsCached(u64 sector, void *buffer, unsigned int count);
-int (*DeviceReadSectorsPtr)(u64 sector, void *buffer, unsigned int count) = &DeviceReadSectors;
+// ZSO indexes up to this size are loaded whole (64KB = images up to 32MB). Larger ones are paged in as needed.
+#define CDVDMAN_ZSO_IDX_FULL_MAX (64 * 1024)
+
+// Sector cache for ISO images (32KB), for the TOC and directory sectors that games read again. ZSO images use the user's cache setting instead.
+#define CDVDMAN_ISO_CACHE_SECTORS 16
+
+// reader function interface, cached raw reader impementation by default
+int (*DeviceReadSectorsPtr)(u64 sector, void *buffer, unsigned int count) = &DeviceReadSectorsISO;
 
 // internal functions prototypes
 static void oplShutdown(int poff);
@@ -38,11 +43,6 @@ static void cdvdman_startThreads(void);
 static void cdvdman_create_semaphores(void);
 static int cdvdman_read(u32 lsn, u32 sectors, u16 sector_size, void *buf);
 
-// Sector cache to improve IO
-static u8 MAX_SECTOR_CACHE = 0;
-static u8 *sector_cache = NULL;
-static u64 cur_sector = 0xffffffffffffffff;
-
 struct cdvdman_cb_data
 {
     void (*user_cb)(int reason);
@@ -70,6 +70,9 @@ static int cdvdman_debug_print_flag = 0;
 unsigned char sync_flag;
 unsigned char cdvdman_cdinited = 0;
 static unsigned int ReadPos = 0; /* Current buffer offset in 2048-byte sectors. */
+#ifdef READ_TRACE
+static unsigned int ReadHits; /* Sectors of the current read that came from the read-ahead buffer. */
+#endif
 
 #ifdef __USE_DEV9
 static int POFFThreadID;
@@ -78,16 +81,6 @@ static int POFFThreadID;
 typedef void (*oplShutdownCb_t)(void);
 static oplShutdownCb_t vmcShutdownCb = NULL;
 
-void initCache()
-{
-    u8 cache_size = cdvdman_settings.common.zso_cache;
-    if (cache_size && sector_cache == NULL) {
-        sector_cache = AllocSysMemory(ALLOC_FIRST, cache_size * 2048, NULL);
-        if (sector_cache)
-            MAX_SECTOR_CACHE = cache_size;
-    }
-}
-
 void oplRegisterShutdownCallback(oplShutdownCb_t cb)
 {
     vmcShutdownCb = cb;
@@ -164,25 +157,9 @@ void *ziso_alloc(u32 size)
     return AllocSysMemory(0, size, NULL);
 }
 
-/*
-  This small improvement will mostly benefit ZSO files.
-  For the same size of an ISO sector, we can have more than one ZSO blocks.
-  If we do a consecutive read of many ISO sectors we will have a huge amount of ZSO sectors ready.
-  Therefore reducing IO access for ZSO files.
-*/
-int DeviceReadSectorsCached(u64 lsn, void *buffer, unsigned int sectors)
+void ziso_free(void *ptr)
 {
-    if (sectors < MAX_SECTOR_CACHE) { // if MAX_SECTOR_CACHE is 0 then it will act as disabled and passthrough
-        if (cur_sector == 0xffffffffffffffff || lsn < cur_sector || (lsn + sectors) - cur_sector > MAX_SECTOR_CACHE) {
-            DeviceReadSectors(lsn, sector_cache, MAX_SECTOR_CACHE);
-            cur_sector = lsn;
-        }
-        int pos = lsn - cur_sector;
-        memcpy(buffer, &(sector_cache[pos * 2048]), 2048 * sectors);
-        return SCECdErNO;
-    }
-    int res = DeviceReadSectors(lsn, buffer, sectors);
-    return res;
+    FreeSysMemory(ptr);
 }
 
 /*
@@ -190,19 +167,19 @@ int DeviceReadSectorsCached(u64 lsn, void *buffer, unsigned int sectors)
   Since we can only do sector-based reads, this funtions acts as a wrapper.
   It will do at most 3 IO reads, most of the time only 1.
 */
-int read_raw_data(u8 *addr, u32 size, u32 offset, u32 shift)
+int read_raw_data(u8 *addr, u32 size, u64 offset)
 {
     u32 o_size = size;
-    u64 lba = offset / (2048 >> shift); // avoid overflow by shifting sector size instead of offset
-    u32 pos = (offset << shift) & 2047; // doesn't matter if it overflows since we only care about the 11 LSB anyways
+    u64 lba = offset >> 11;
+    u32 pos = (u32)offset & 2047;
 
-    // prevent caching if already reading into ZSO index cache
-    int (*ReadSectors)(u64 lsn, void *buffer, unsigned int sectors) = (addr == (u8 *)ziso_idx_cache) ? &DeviceReadSectors : &DeviceReadSectorsCached;
+    // load all the sectors that are about to be read in one go, as they may be read in up to 3 parts
+    DeviceCacheSectors(lba, (pos + size + 2047) / 2048);
 
     // read first block if not aligned to sector size
     if (pos) {
         int r = MIN(size, (2048 - pos));
-        ReadSectors(lba, ziso_tmp_buf, 1);
+        DeviceReadSectorsCached(lba, ziso_tmp_buf, 1);
         memcpy(addr, ziso_tmp_buf + pos, r);
         size -= r;
         lba++;
@@ -215,7 +192,7 @@ int read_raw_data(u8 *addr, u32 size, u32 offset, u32 shift)
         n_blocks++;
     if (n_blocks > 1) {
         int r = 2048 * (n_blocks - 1);
-        ReadSectors(lba, addr, n_blocks - 1);
+        DeviceReadSectorsCached(lba, addr, n_blocks - 1);
         size -= r;
         addr += r;
         lba += n_blocks - 1;
@@ -223,7 +200,7 @@ int read_raw_data(u8 *addr, u32 size, u32 offset, u32 shift)
 
     // read remaining data
     if (size) {
-        ReadSectors(lba, ziso_tmp_buf, 1);
+        DeviceReadSectorsCached(lba, ziso_tmp_buf, 1);
         memcpy(addr, ziso_tmp_buf, size);
         size = 0;
     }
@@ -232,6 +209,26 @@ int read_raw_data(u8 *addr, u32 size, u32 offset, u32 shift)
     return o_size - size;
 }
 
+#ifdef DEVICE_ASYNC_READS
+// reads the sectors that hold the data into the end of the buffer, in the background
+static u8 *read_raw_data_async(u8 *buf, u32 bufsize, u32 size, u64 offset)
+{
+    u32 pos = (u32)offset & 2047;
+    u32 nsectors = (pos + size + 2047) / 2048;
+    u8 *dst = buf + bufsize - nsectors * 2048;
+
+    if (nsectors * 2048 > bufsize || DeviceReadSectorsAsync(offset >> 11, dst, nsectors) != SCECdErNO)
+        return NULL;
+
+    return dst + pos;
+}
+
+static int read_raw_data_wait(void)
+{
+    return (DeviceReadSectorsWait() == SCECdErNO) ? 0 : -1;
+}
+#endif
+
 int DeviceReadSectorsCompressed(u64 lsn, void *addr, unsigned int count)
 {
     return (ziso_read_sector(addr, (u32)lsn, count) == count) ? SCECdErNO : SCECdErEOM;
@@ -244,19 +241,27 @@ static int ProbeZSO(u8 *buffer)
         return 0;
     probed = 1;
     if (*(u32 *)buffer == ZSO_MAGIC) {
-        // initialize ZSO
+        // initialize ZSO, keeping small indexes entirely in memory
+        ziso_idx_full_max = CDVDMAN_ZSO_IDX_FULL_MAX;
         ziso_init((ZISO_header *)buffer, *(u32 *)(buffer + sizeof(ZISO_header)));
-        // initialize cache
-        initCache();
+#ifdef DEVICE_ASYNC_READS
+        // the next blocks are read while the current ones are decoded
+        ziso_read_async = &read_raw_data_async;
+        ziso_read_wait = &read_raw_data_wait;
+#endif
         // redirect sector reader
         DeviceReadSectorsPtr = &DeviceReadSectorsCompressed;
+        cdvdman_cache_init(cdvdman_settings.common.zso_cache);
+    } else {
+        cdvdman_cache_init(CDVDMAN_ISO_CACHE_SECTORS);
     }
+    cdvdman_readahead_enable();
     return 1;
 }
 
 static int cdvdman_read_sectors(u32 lsn, unsigned int sectors, void *buf)
 {
-    unsigned int remaining;
+    unsigned int remaining, hits;
     void *ptr;
     int endOfMedia = 0;
 
@@ -306,7 +311,10 @@ static int cdvdman_read_sectors(u32 lsn, unsigned int sectors, void *buf)
             SetAlarm(&TargetTime, &cdvdemu_read_end_cb, NULL);
         }
 
-        cdvdman_stat.err = DeviceReadSectorsPtr(lsn, ptr, SectorsToRead);
+        cdvdman_stat.err = cdvdman_readahead_read(lsn, ptr, SectorsToRead, &hits);
+#ifdef READ_TRACE
+        ReadHits += hits;
+#endif
         if (cdvdman_stat.err != SCECdErNO) {
             if (cdvdman_settings.common.flags & IOPCORE_COMPAT_ACCU_READS)
                 CancelAlarm(&cdvdemu_read_end_cb, NULL);
@@ -351,8 +359,33 @@ static int cdvdman_read_sectors(u32 lsn, unsigned int sectors, void *buf)
     return (cdvdman_stat.err == SCECdErNO ? 0 : 1);
 }
 
+// Copies words from an aligned buffer to a higher address, which may be unaligned and overlap the source.
+static void cdvdman_move_up(u8 *dst, const u32 *src, u32 size)
+{
+    struct unaligned_u32
+    {
+        u32 value;
+    } __attribute__((packed)) *out = (struct unaligned_u32 *)dst;
+    u32 i;
+
+    if ((const u8 *)src == dst)
+        return;
+
+    for (i = size / 4; i-- > 0;)
+        out[i].value = src[i];
+}
+
 static int cdvdman_read(u32 lsn, u32 sectors, u16 sector_size, void *buf)
 {
+#ifdef READ_TRACE
+    // Traced here rather than per device read, so that the game's sector size and buffer alignment are recorded.
+    u32 trace_start = cdvdman_trace_ticks(), trace_lsn = lsn, trace_sectors = sectors;
+    void *trace_buf = buf;
+    u8 trace_flags;
+
+    ReadHits = 0;
+#endif
+
     cdvdman_stat.status = SCECdStatRead;
     buf = (void *)PHYSADDR(buf);
 
@@ -363,59 +396,76 @@ static int cdvdman_read(u32 lsn, u32 sectors, u16 sector_size, void *buf)
         offset = 12; // head - sub - data(2048) -- edc-ecc
 
     if ((u32)(buf)&3 || (sector_size != 2048)) {
-        // For transfers to unaligned buffers, a double-copy is required to avoid stalling the device's DMA channel.
+        /* The device cannot DMA to unaligned buffers, and OPL only has the 2048 bytes of user data of each sector.
+           The sectors are read with one device call into the aligned part of the buffer, then moved up to where they belong.
+           The first sector of an unaligned buffer is read through cdvdman_buf, as there is no room for it. */
+        u32 first, i;
+        u8 *bulk;
+
         WaitSema(cdvdman_searchfilesema);
 
-        u32 nsectors, nbytes;
-        u32 rpos = lsn;
-
-        while (sectors > 0) {
-            nsectors = sectors;
-            if (nsectors > CDVDMAN_BUF_SECTORS)
-                nsectors = CDVDMAN_BUF_SECTORS;
-
-            // For other sizes we can only read one sector at a time.
-            // There are only very few games (CDDA games, EA Tiburon) that will be affected
-            if (sector_size != 2048)
-                nsectors = 1;
-
-            cdvdman_read_sectors(rpos, nsectors, cdvdman_buf);
-
-            rpos += nsectors;
-            sectors -= nsectors;
-            nbytes = nsectors * sector_size;
-
-
-            // Copy the data for buffer.
-            // For any sector other than 2048 one sector at a time is copied.
-            memcpy((void *)((u32)buf + offset), cdvdman_buf, nbytes);
-
-            // For these custom sizes we need to manually fix the header.
-            // For 2340 we have 12bytes. 4 are position.
-            if (sector_size == 2340) {
-                u8 *header = (u8 *)buf;
-                // position.
-                sceCdlLOCCD p;
-                sceCdIntToPos(rpos - 1, &p); // to get current pos.
-                header[0] = p.minute;
-                header[1] = p.second;
-                header[2] = p.sector;
-                header[3] = 0; // p.track for cdda only non-zero
-
-                // Subheader and copy of subheader.
-                header[4] = header[8] = 0;
-                header[5] = header[9] = 0;
-                header[6] = header[10] = 0x8;
-                header[7] = header[11] = 0;
-            }
-            buf = (void *)((u8 *)buf + nbytes);
+        first = ((u32)buf & 3) ? 1 : 0;
+        if (first)
+            cdvdman_read_sectors(lsn, 1, cdvdman_buf);
+
+        if (sectors > first) {
+            bulk = (u8 *)(((u32)buf + first * sector_size) & ~3);
+            cdvdman_read_sectors(lsn + first, sectors - first, bulk);
+
+            // Backwards, as each sector moves up over the next ones.
+            for (i = sectors; i-- > first;)
+                cdvdman_move_up((u8 *)buf + i * sector_size + offset, (const u32 *)(bulk + (i - first) * 2048), 2048);
         }
+
+        if (first)
+            memcpy((u8 *)buf + offset, cdvdman_buf, 2048);
+
         SignalSema(cdvdman_searchfilesema);
+
+        // For these custom sizes we need to manually fix the header.
+        if (sector_size != 2048) {
+            for (i = 0; i < sectors; i++) {
+                u8 *header = (u8 *)buf + i * sector_size;
+
+                // For 2340 we have 12bytes. 4 are position.
+                if (sector_size == 2340) {
+                    // position.
+                    sceCdlLOCCD p;
+                    sceCdIntToPos(lsn + i, &p);
+                    header[0] = p.minute;
+                    header[1] = p.second;
+                    header[2] = p.sector;
+                    header[3] = 0; // p.track for cdda only non-zero
+
+                    // Subheader and copy of subheader.
+                    header[4] = header[8] = 0;
+                    header[5] = header[9] = 0;
+                    header[6] = header[10] = 0x8;
+                    header[7] = header[11] = 0;
+                }
+
+                // No EDC/ECC
+                memset(header + offset + 2048, 0, sector_size - offset - 2048);
+            }
+        }
     } else
         cdvdman_read_sectors(lsn, sectors, buf);
 
     ReadPos = 0; /* Reset the buffer offset indicator. */
 
+#ifdef READ_TRACE
+    trace_flags = 0;
+    if (ReadHits > 0 && ReadHits >= trace_sectors)
+        trace_flags |= CDVDMAN_TRACE_HIT;
+    else if (ReadHits > 0)
+        trace_flags |= CDVDMAN_TRACE_PARTIAL;
+    if (cdvdman_stat.StreamingData.StIsReading)
+        trace_flags |= CDVDMAN_TRACE_STREAM;
+    if (cdvdman_stat.err != SCECdErNO)
+        trace_flags |= CDVDMAN_TRACE_ERROR;
+    cdvdman_trace_record(trace_start, trace_lsn, trace_sectors, sector_size, trace_buf, trace_flags);
+#endif
+
     cdvdman_stat.status = SCECdStatPause;
 
     return 1;
@@ -840,6 +890,8 @@ int _start(int argc, char **argv)
     // create SCMD/searchfile semaphores
     cdvdman_create_semaphores();
 
+    cdvdman_readahead_init();
+
     // start cdvdman threads
     cdvdman_startThreads();
 
@@ -7,9 +7,9 @@
 #include "internal.h"
 
 #include <bdm.h>
-#include <bd_defrag.h>
 
 #include "device.h"
+#include "fragmap.h"
 
 #ifdef USE_BDM_ATA
 #include "atad.h"
@@ -17,10 +17,22 @@ char lba_48bit = 0;
 char atad_inited = 0;
 #endif
 
+#ifdef DEVICE_ASYNC_READS
+// A read may span more than one fragment, which takes one transfer for each.
+#define ASYNC_MAX_REQS 4
+
+static ata_io_req_t async_reqs[ASYNC_MAX_REQS];
+static int async_count;  // Transfers of the read in progress
+static int async_result; // SCECdErNO, or SCECdErREAD if any of them failed
+static int async_sema = -1;
+static u8 g_bd_is_ata;   // Only the internal HDD can be read in the background.
+#endif
+
 extern struct cdvdman_settings_bdm cdvdman_settings;
 static struct block_device *g_bd = NULL;
 static u32 g_bd_sectors_per_sector = 4;
 static int bdm_io_sema;
+static struct fragmap iso_map;
 
 extern struct irx_export_table _exp_bdm;
 
@@ -40,6 +52,9 @@ void bdm_connect_bd(struct block_device *bd)
         DPRINTF("attaching to %s%dp%d\n", bd->name, bd->devNr, bd->parNr);
         g_bd = bd;
         g_bd_sectors_per_sector = (2048 / bd->sectorSize);
+#ifdef DEVICE_ASYNC_READS
+        g_bd_is_ata = !strcmp(bd->name, "ata");
+#endif
         // Free usage of block device
         SignalSema(bdm_io_sema);
     }
@@ -65,6 +80,8 @@ void bdm_disconnect_bd(struct block_device *bd)
 
 void DeviceInit(void)
 {
+    struct cdvdman_fragfile *fragfile;
+    struct fragmap_extent *extents;
     iop_sema_t smp;
 
     DPRINTF("%s\n", __func__);
@@ -76,6 +93,14 @@ void DeviceInit(void)
     smp.attr = SA_THPRI;
     bdm_io_sema = CreateSema(&smp);
 
+    // The map in the patch zone is compact, but must be decoded for lookups.
+    fragfile = &cdvdman_settings.fragfile[0];
+    extents = AllocSysMemory(ALLOC_FIRST, (fragfile->frag_count + 1) * sizeof(struct fragmap_extent), NULL);
+    if (extents == NULL || fragfile->map_start >= BDM_FRAGMAP_SIZE ||
+        fragmap_decode(&iso_map, extents, &cdvdman_settings.fragmap[fragfile->map_start], BDM_FRAGMAP_SIZE - fragfile->map_start, fragfile->frag_count) != 0) {
+        DPRINTF("invalid fragment map\n");
+    }
+
     RegisterLibraryEntries(&_exp_bdm);
 
 #ifdef USE_BDM_ATA
@@ -84,6 +109,14 @@ void DeviceInit(void)
     atad_start();
     atad_inited = 1;
 #endif
+
+#ifdef DEVICE_ASYNC_READS
+    smp.initial = 0;
+    smp.max = ASYNC_MAX_REQS;
+    smp.attr = 0;
+    smp.option = 0;
+    async_sema = CreateSema(&smp);
+#endif
 }
 
 void DeviceDeinit(void)
@@ -133,6 +166,8 @@ void DeviceUnmount(void)
 
 int DeviceReadSectors(u64 lsn, void *buffer, unsigned int sectors)
 {
+    u32 sector, count, dev_sector, run;
+    u8 *ptr = buffer;
     int rv = SCECdErNO;
 
     // DPRINTF("%s(%u, 0x%p, %u)\n", __func__, (unsigned int)lsn, buffer, sectors);
@@ -140,14 +175,108 @@ int DeviceReadSectors(u64 lsn, void *buffer, unsigned int sectors)
     if (g_bd == NULL)
         return SCECdErTRMOPN;
 
+    if (iso_map.extents == NULL)
+        return SCECdErREAD;
+
+    sector = lsn * 4;
+    count = sectors * 4;
+
     WaitSema(bdm_io_sema);
-    if (bd_defrag(g_bd, cdvdman_settings.fragfile[0].frag_count, &cdvdman_settings.frags[cdvdman_settings.fragfile[0].frag_start], lsn * 4, buffer, sectors * 4) != (sectors * 4))
-        rv = SCECdErREAD;
+    while (count > 0) {
+        // A read that crosses fragments is split into one device read per fragment.
+        dev_sector = fragmap_lookup(&iso_map, sector, &run);
+        if (run == 0) {
+            rv = SCECdErREAD;
+            break;
+        }
+        if (run > count)
+            run = count;
+
+        if (g_bd->read(g_bd, dev_sector, ptr, run) != run) {
+            rv = SCECdErREAD;
+            break;
+        }
+
+        sector += run;
+        count -= run;
+        ptr += run * g_bd->sectorSize;
+    }
     SignalSema(bdm_io_sema);
 
     return rv;
 }
 
+#ifdef DEVICE_ASYNC_READS
+static void async_done(ata_io_req_t *req, int result)
+{
+    if (result != 0)
+        async_result = SCECdErREAD;
+    SignalSema(async_sema);
+}
+
+int DeviceReadSectorsAsync(u64 lsn, void *buffer, unsigned int sectors)
+{
+    u32 sector, count, dev_sector, run;
+    int nreqs, rv;
+
+    if (async_sema < 0 || iso_map.extents == NULL)
+        return SCECdErREAD;
+
+    sector = lsn * 4;
+    count = sectors * 4;
+    rv = SCECdErNO;
+
+    WaitSema(bdm_io_sema);
+    if (g_bd == NULL || !g_bd_is_ata) {
+        SignalSema(bdm_io_sema);
+        return SCECdErREAD;
+    }
+
+    // Map the read to the fragments first, so that it is either queued whole or not at all.
+    for (nreqs = 0; count > 0; nreqs++) {
+        dev_sector = fragmap_lookup(&iso_map, sector, &run);
+        if (nreqs == ASYNC_MAX_REQS || run == 0) {
+            SignalSema(bdm_io_sema);
+            return SCECdErREAD;
+        }
+        if (run > count)
+            run = count;
+
+        async_reqs[nreqs].buf = buffer;
+        async_reqs[nreqs].lba = dev_sector;
+        async_reqs[nreqs].nsectors = run;
+        async_reqs[nreqs].device = g_bd->devNr;
+        async_reqs[nreqs].dir = ATA_DIR_READ;
+        async_reqs[nreqs].done = &async_done;
+
+        buffer = (u8 *)buffer + run * g_bd->sectorSize;
+        sector += run;
+        count -= run;
+    }
+
+    async_result = SCECdErNO;
+    for (async_count = 0; async_count < nreqs; async_count++) {
+        if (ata_device_sector_io_async(&async_reqs[async_count]) != 0) {
+            // Let the parts already queued complete, so that nothing is left in flight when the caller falls back to other reads.
+            DeviceReadSectorsWait();
+            rv = SCECdErREAD;
+            break;
+        }
+    }
+    SignalSema(bdm_io_sema);
+
+    return rv;
+}
+
+int DeviceReadSectorsWait(void)
+{
+    for (; async_count > 0; async_count--)
+        WaitSema(async_sema);
+
+    return async_result;
+}
+#endif
+
 //
 // oplutils exported function, used by MCEMU
 //
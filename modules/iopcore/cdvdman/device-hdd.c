@@ -21,6 +21,16 @@ static unsigned char NumParts;
 
 static hdl_partspecs_t cdvdman_partspecs[HDL_NUM_PART_SPECS];
 
+#ifdef DEVICE_ASYNC_READS
+// A read may span more than one partition, which takes one transfer for each.
+#define ASYNC_MAX_REQS 4
+
+static ata_io_req_t async_reqs[ASYNC_MAX_REQS];
+static int async_count;  // Transfers of the read in progress
+static int async_result; // SCECdErNO, or SCECdErREAD if any of them failed
+static int async_sema = -1;
+#endif
+
 #ifdef HD_PRO
 extern int ata_device_set_write_cache(int device, int enable);
 #endif
@@ -78,6 +88,16 @@ void DeviceInit(void)
     if (cdvdman_settings.common.layer1_start == 0) // layer1 start not set, read it from APA header
         cdvdman_settings.common.layer1_start = apaHeader.layer1_start;
     NumParts = apaHeader.num_partitions;
+
+#ifdef DEVICE_ASYNC_READS
+    iop_sema_t smp;
+
+    smp.initial = 0;
+    smp.max = ASYNC_MAX_REQS;
+    smp.attr = 0;
+    smp.option = 0;
+    async_sema = CreateSema(&smp);
+#endif
 }
 
 void DeviceDeinit(void)
@@ -131,3 +151,63 @@ int DeviceReadSectors(u64 lsn, void *buffer, unsigned int sectors)
 
     return SCECdErNO;
 }
+
+#ifdef DEVICE_ASYNC_READS
+static void async_done(ata_io_req_t *req, int result)
+{
+    if (result != 0)
+        async_result = SCECdErREAD;
+    SignalSema(async_sema);
+}
+
+int DeviceReadSectorsAsync(u64 lsn, void *buffer, unsigned int sectors)
+{
+    hdl_partspecs_t *ps;
+    u32 nsectors;
+    int count;
+
+    if (async_sema < 0)
+        return SCECdErREAD;
+
+    // Map the read to the partitions first, so that it is either queued whole or not at all.
+    for (count = 0; sectors > 0; count++) {
+        if (count == ASYNC_MAX_REQS || cdvdman_get_part_specs((u32)lsn) != 0)
+            return SCECdErREAD;
+        ps = &cdvdman_partspecs[CurrentPart];
+
+        nsectors = (ps->part_offset + (ps->part_size / 2048)) - (u32)lsn;
+        if (sectors < nsectors)
+            nsectors = sectors;
+
+        async_reqs[count].buf = buffer;
+        async_reqs[count].lba = ps->data_start + (((u32)lsn - ps->part_offset) << 2);
+        async_reqs[count].nsectors = nsectors << 2;
+        async_reqs[count].device = 0;
+        async_reqs[count].dir = ATA_DIR_READ;
+        async_reqs[count].done = &async_done;
+
+        buffer = (u8 *)buffer + nsectors * 2048;
+        sectors -= nsectors;
+        lsn += nsectors;
+    }
+
+    async_result = SCECdErNO;
+    for (async_count = 0; async_count < count; async_count++) {
+        if (ata_device_sector_io_async(&async_reqs[async_count]) != 0) {
+            // Let the parts already queued complete, so that nothing is left in flight when the caller falls back to other reads.
+            DeviceReadSectorsWait();
+            return SCECdErREAD;
+        }
+    }
+
+    return SCECdErNO;
+}
+
+int DeviceReadSectorsWait(void)
+{
+    for (; async_count > 0; async_count--)
+        WaitSema(async_sema);
+
+    return async_result;
+}
+#endif
@@ -8,3 +8,13 @@ void DeviceUnmount(void); // Called when OPL is shutting down.
 void DeviceStop(void);    // Called before the PS2 is to be shut down.
 
 int DeviceReadSectors(u64 lsn, void *buffer, unsigned int sectors);
+
+#if (defined(HDD_DRIVER) && !defined(HD_PRO)) || defined(USE_BDM_ATA)
+#define DEVICE_ASYNC_READS
+#endif
+
+#ifdef DEVICE_ASYNC_READS
+// Background reads, so that data can be processed while the next data is read. Only one may be in progress at a time.
+int DeviceReadSectorsAsync(u64 lsn, void *buffer, unsigned int sectors); // Starts a read. Returns SCECdErNO, or an error if nothing was started.
+int DeviceReadSectorsWait(void);                                         // Waits for the read to complete, and returns its result.
+#endif
@@ -0,0 +1,128 @@
+/*
+  Copyright 2026, Open PS2 Loader contributors
+  Licenced under Academic Free License version 3.0
+  Review Open PS2 Loader README & LICENSE files for further details.
+*/
+
+#include "fragmap.h"
+
+static int fragmap_put(u8 *map, unsigned int size, unsigned int pos, u32 value)
+{
+    do {
+        if (pos >= size)
+            return -1;
+        map[pos++] = (value & 0x7F) | (value > 0x7F ? 0x80 : 0);
+        value >>= 7;
+    } while (value != 0);
+
+    return pos;
+}
+
+static int fragmap_get(const u8 *map, unsigned int size, unsigned int pos, u32 *value)
+{
+    unsigned int shift;
+    u8 c;
+
+    *value = 0;
+    for (shift = 0; shift < 35; shift += 7) {
+        if (pos >= size)
+            return -1;
+        c = map[pos++];
+        *value |= (u32)(c & 0x7F) << shift;
+        if (!(c & 0x80))
+            return pos;
+    }
+
+    return -1;
+}
+
+// Used by OPL, to build the map in the patch zone.
+int fragmap_encode(u8 *map, unsigned int size, const bd_fragment_t *frags, unsigned int count)
+{
+    unsigned int i, shift;
+    u32 bits, end;
+    s32 delta;
+    int pos;
+
+    // Largest unit that all the fragments are aligned to.
+    for (bits = 0, i = 0; i < count; i++)
+        bits |= frags[i].sector | frags[i].count;
+    for (shift = 0; shift < 31 && !(bits & (1u << shift)); shift++)
+        ;
+
+    if (size < 1)
+        return -1;
+    map[0] = shift;
+
+    for (pos = 1, end = 0, i = 0; i < count; i++) {
+        // The distance wraps around like the sector numbers, so fragments may be anywhere on the device.
+        delta = (s32)(frags[i].sector - end) >> shift;
+        if ((pos = fragmap_put(map, size, pos, frags[i].count >> shift)) < 0 ||
+            (pos = fragmap_put(map, size, pos, ((u32)delta << 1) ^ (u32)(delta >> 31))) < 0)
+            return -1;
+        end = frags[i].sector + frags[i].count;
+    }
+
+    return pos;
+}
+
+int fragmap_decode(struct fragmap *fm, struct fragmap_extent *extents, const u8 *map, unsigned int size, unsigned int count)
+{
+    u32 length, zigzag, file_sector, end;
+    unsigned int i, shift;
+    int pos;
+
+    if (size < 1 || (shift = map[0]) > 31)
+        return -1;
+
+    for (pos = 1, file_sector = 0, end = 0, i = 0; i < count; i++) {
+        if ((pos = fragmap_get(map, size, pos, &length)) < 0 || (pos = fragmap_get(map, size, pos, &zigzag)) < 0)
+            return -1;
+
+        extents[i].file_sector = file_sector;
+        extents[i].dev_sector = end + ((u32)((s32)(zigzag >> 1) ^ -(s32)(zigzag & 1)) << shift);
+        length <<= shift;
+        file_sector += length;
+        end = extents[i].dev_sector + length;
+    }
+    extents[count].file_sector = file_sector;
+    extents[count].dev_sector = end;
+
+    fm->extents = extents;
+    fm->count = count;
+    fm->cursor = 0;
+
+    return 0;
+}
+
+u32 fragmap_lookup(struct fragmap *fm, u32 sector, u32 *run)
+{
+    struct fragmap_extent *e = fm->extents;
+    unsigned int i, lo, hi, mid;
+
+    if (sector >= e[fm->count].file_sector) {
+        *run = 0;
+        return 0;
+    }
+
+    // Most reads are within the extent of the previous read, or the one after it.
+    i = fm->cursor;
+    if (sector < e[i].file_sector || sector >= e[i + 1].file_sector) {
+        if (sector >= e[i + 1].file_sector && sector < e[i + 2].file_sector) {
+            i++;
+        } else {
+            for (lo = 0, hi = fm->count; hi - lo > 1;) {
+                mid = (lo + hi) / 2;
+                if (e[mid].file_sector <= sector)
+                    lo = mid;
+                else
+                    hi = mid;
+            }
+            i = lo;
+        }
+        fm->cursor = i;
+    }
+
+    *run = e[i + 1].file_sector - sector;
+    return e[i].dev_sector + (sector - e[i].file_sector);
+}
@@ -66,6 +66,13 @@ struct SteamingData
     unsigned short int StIsReading;
     void *StIOP_bufaddr;
     u32 Stlsn;
+#ifdef STREAM_BANKS
+    u32 StFilled;                 // Bitmap of the banks that hold data.
+    u32 StReading;                // Bitmap of the banks being read.
+    unsigned char StReadingCount; // Number of banks being read.
+    unsigned char StReadBank;     // Bank that holds StReadPtr, unless the buffer is empty.
+    u32 StRefillStart;            // Time at which the read started.
+#endif
 };
 
 typedef struct
@@ -110,15 +117,31 @@ extern void cdvdman_fs_init(void);
 extern void cdvdman_searchfile_init(void);
 extern void cdvdman_initdev(void);
 
+extern void cdvdman_cache_init(unsigned int sectors);
+extern int DeviceReadSectorsCached(u64 lsn, void *buffer, unsigned int sectors);
+extern int DeviceReadSectorsISO(u64 lsn, void *buffer, unsigned int sectors);
+extern void DeviceCacheSectors(u64 lsn, unsigned int sectors);
+
+extern void cdvdman_readahead_init(void);
+extern void cdvdman_readahead_enable(void);
+extern int cdvdman_readahead_read(u32 lsn, void *buf, unsigned int sectors, unsigned int *hits);
+extern void cdvdman_readahead_getstat(struct cdvdman_readahead_stats *stats);
+extern void cdvdman_search_getstat(struct cdvdman_search_stats *stats);
+
+#ifdef READ_TRACE
+extern u32 cdvdman_trace_ticks(void);
+extern void cdvdman_trace_record(u32 start, u32 lsn, u32 sectors, u16 sector_size, const void *buf, u8 flags);
+extern int cdvdman_trace_get(u32 first, struct cdvdman_trace *trace, u32 size);
+#endif
+
+#ifdef STREAM_BANKS
+extern void cdvdman_stream_getstat(struct cdvdman_stream_stats *stats);
+#endif
+
 extern struct CDVDMAN_SETTINGS_TYPE cdvdman_settings;
 
-#if defined(HDD_DRIVER) || defined(USE_BDM_ATA)
-// HDD driver also uses this buffer, for aligning unaligned reads.
-#define CDVDMAN_BUF_SECTORS 2
-#else
-// Normally this buffer is only used by 'searchfile', only 1 sector used
+// Used by 'searchfile', and for the first sector of reads to unaligned buffers.
 #define CDVDMAN_BUF_SECTORS 1
-#endif
 extern u8 cdvdman_buf[CDVDMAN_BUF_SECTORS * 2048];
 
 extern int cdrom_io_sema;
@@ -37,7 +37,7 @@ static int cdrom_lseek(iop_file_t *f, int offset, int where);
 static int cdrom_getstat(iop_file_t *f, const char *filename, iox_stat_t *stat);
 static int cdrom_dopen(iop_file_t *f, const char *dirname);
 static int cdrom_dread(iop_file_t *f, iox_dirent_t *dirent);
-static int cdrom_ioctl(iop_file_t *f, u32 cmd, void *args);
+static int cdrom_ioctl(iop_file_t *f, unsigned long cmd, void *args);
 static int cdrom_devctl(iop_file_t *f, const char *name, int cmd, void *args, u32 arglen, void *buf, u32 buflen);
 static int cdrom_ioctl2(iop_file_t *f, int cmd, void *args, unsigned int arglen, void *buf, unsigned int buflen);
 
@@ -233,7 +233,8 @@ static int cdrom_open(iop_file_t *f, const char *filename, int mode)
 
     DPRINTF("cdrom_open %s mode=%d layer %d\n", filename, mode, f->unit);
 
-    strncpy(path_buffer, filename, sizeof(path_buffer));
+    strncpy(path_buffer, filename, sizeof(path_buffer) - 1);
+    path_buffer[sizeof(path_buffer) - 1] = '\0';
     cdrom_purifyPath(path_buffer);
 
     if ((result = cdvdman_open(f, path_buffer, mode)) >= 0)
@@ -370,7 +371,8 @@ static int cdrom_getstat(iop_file_t *f, const char *filename, iox_stat_t *stat)
     DPRINTF("cdrom_getstat %s layer %d\n", filename, f->unit);
     WaitEventFlag(cdvdman_stat.intr_ef, 1, WEF_AND, NULL);
 
-    strncpy(path_buffer, filename, sizeof(path_buffer));
+    strncpy(path_buffer, filename, sizeof(path_buffer) - 1);
+    path_buffer[sizeof(path_buffer) - 1] = '\0';
     cdrom_purifyPath(path_buffer); // Unlike the SCE original, purify the path right away.
 
     return sceCdLayerSearchFile((sceCdlFILE *)&stat->attr, path_buffer, f->unit) - 1;
@@ -429,7 +431,7 @@ static int cdrom_dread(iop_file_t *f, iox_dirent_t *dirent)
 }
 
 //--------------------------------------------------------------
-static int cdrom_ioctl(iop_file_t *f, u32 cmd, void *args)
+static int cdrom_ioctl(iop_file_t *f, unsigned long cmd, void *args)
 {
     register int r = 0;
 
@@ -538,6 +540,29 @@ static int cdrom_devctl(iop_file_t *f, const char *name, int cmd, void *args, u3
             *(int *)buf = cdvdman_stat.intr_ef;
             result = cdvdman_stat.intr_ef;
             break;
+        case CDIOC_OPL_RASTAT:
+            if (buflen < sizeof(struct cdvdman_readahead_stats)) {
+                result = -EINVAL;
+                break;
+            }
+            cdvdman_readahead_getstat(buf);
+            break;
+        case CDIOC_OPL_SEARCHSTAT:
+            if (buflen < sizeof(struct cdvdman_search_stats)) {
+                result = -EINVAL;
+                break;
+            }
+            cdvdman_search_getstat(buf);
+            break;
+#ifdef READ_TRACE
+        case CDIOC_OPL_TRACE:
+            if (arglen < sizeof(u32)) {
+                result = -EINVAL;
+                break;
+            }
+            result = cdvdman_trace_get(*(u32 *)args, buf, buflen);
+            break;
+#endif
         default:
             DPRINTF("cdrom_devctl unknown, cmd=0x%X\n", cmd);
             result = -EIO;
@@ -568,6 +593,11 @@ static int cdrom_ioctl2(iop_file_t *f, int cmd, void *args, unsigned int arglen,
             break;
         case CIOCSTREAMSTAT:
             r = sceCdStStat();
+#ifdef STREAM_BANKS
+            // The bank-based engine also returns its statistics, if there is room for them.
+            if (buf != NULL && buflen >= sizeof(struct cdvdman_stream_stats))
+                cdvdman_stream_getstat(buf);
+#endif
             break;
         default:
             DPRINTF("cdrom_ioctl2 unknown, cmd=0x%X\n", cmd);
@@ -0,0 +1,332 @@
+/*
+  Copyright 2026, Open PS2 Loader contributors
+  Licenced under Academic Free License version 3.0
+  Review Open PS2 Loader README & LICENSE files for further details.
+*/
+
+#include "internal.h"
+
+/*
+  Sequential read-ahead.
+  Once the game has read a few consecutive runs of sectors, a low-priority thread starts reading the following sectors
+  into a ring buffer, while the game is still busy with the data it already has. Sequential reads are then served from
+  the ring, instead of waiting for the device (and, for ZSO images, decompressing the blocks).
+  The ring has a fixed size of its own, and is only allocated once a sequential run is seen.
+  The prefetch window is the number of sectors the game is expected to consume during one device call,
+  which is derived from the measured device latency and the rate at which the game consumes sectors.
+  The state is not locked while the prefetch reads from the device, so reads that hit the ring do not wait for it.
+*/
+
+#define RA_SEQ_TRIGGER 2 // Number of consecutive sequential reads before prefetching starts.
+#define RA_MIN_WINDOW  2
+#define RA_RING_SECTORS 32 // 64KB
+
+extern int (*DeviceReadSectorsPtr)(u64 sector, void *buffer, unsigned int count);
+
+static u8 *ra_buf = NULL;
+static u16 ra_size = 0;  // Ring size, in sectors. 0 = not allocated.
+static u16 ra_head;      // Ring index of ra_lsn.
+static u16 ra_valid;     // Number of valid sectors in the ring, starting from ra_lsn.
+static u16 ra_fill;      // Number of sectors after the valid ones that are being read by the prefetch.
+static u16 ra_window;    // Number of sectors to prefetch per device call.
+static u32 ra_lsn;       // First LSN held in the ring.
+static u32 ra_next_lsn;  // LSN that a sequential read from the game would start at.
+static u32 ra_gen;       // Incremented when the ring is discarded, to drop the prefetch in progress.
+static u8 ra_seq;        // Consecutive sequential reads seen.
+static u8 ra_reading;    // Set while the game's read is waiting for the device, so that no prefetch is started.
+static u8 ra_disabled = 1; // Cleared once the image is probed, unless read-ahead is disabled or its buffer could not be allocated.
+static int ra_sema;        // Protects the state above.
+static int ra_dev_sema;    // Held across device reads: the ZSO reader may only be used by one thread at a time.
+static int ra_thread_sema = -1;
+static int ra_ThreadID;
+
+// Timing, in IOP clock ticks.
+static u32 ra_dev_ticks;  // Average duration of a prefetch device call.
+static u32 ra_game_ticks; // Average time taken by the game to consume a sector.
+static u32 ra_last_time;
+static u32 ra_last_sectors;
+static u32 ra_run_sectors; // Largest request of the current sequential run.
+
+static struct cdvdman_readahead_stats ra_stats;
+
+static u32 ra_get_ticks(void)
+{
+    iop_sys_clock_t clock;
+
+    GetSystemTime(&clock);
+    return clock.lo;
+}
+
+static void ra_update_window(void)
+{
+    u32 window;
+
+    if (ra_game_ticks == 0)
+        window = RA_MIN_WINDOW;
+    else
+        window = ra_dev_ticks / ra_game_ticks + 1;
+
+    /* Always try to have the next request ready, to avoid splitting it into several device calls.
+       The largest request of the run is used, as unaligned reads alternate between 1 sector and the rest of the request. */
+    if (window < ra_run_sectors)
+        window = ra_run_sectors;
+
+    if (window > ra_size / 2)
+        window = ra_size / 2;
+    if (window < RA_MIN_WINDOW)
+        window = RA_MIN_WINDOW;
+
+    ra_window = window;
+}
+
+// Drops the first n sectors of the ring. The sectors being prefetched stay where they are.
+static void ra_consume(unsigned int n)
+{
+    ra_lsn += n;
+    ra_head = (ra_head + n) % ra_size;
+    ra_valid -= n;
+}
+
+static void ra_discard(u32 lsn)
+{
+    ra_stats.wasted += ra_valid;
+    ra_valid = 0;
+    ra_fill = 0;
+    ra_head = 0;
+    ra_lsn = lsn;
+    ra_gen++;
+}
+
+static int ra_alloc(void)
+{
+    if ((ra_buf = AllocSysMemory(ALLOC_FIRST, RA_RING_SECTORS * 2048, NULL)) == NULL) {
+        DPRINTF("readahead: disabled, could not allocate the ring\n");
+        ra_disabled = 1;
+        return 0;
+    }
+
+    ra_size = RA_RING_SECTORS;
+    ra_update_window();
+    ra_stats.size = ra_size;
+
+    return 1;
+}
+
+// Copies the sectors from lsn that are in the ring. Returns the number of sectors copied.
+static unsigned int ra_copy(u32 lsn, u8 *buf, unsigned int sectors)
+{
+    unsigned int n, offset, done;
+
+    if (ra_valid == 0 || lsn < ra_lsn || lsn >= ra_lsn + ra_valid)
+        return 0;
+
+    ra_stats.wasted += lsn - ra_lsn;
+    ra_consume(lsn - ra_lsn);
+
+    for (done = 0; done < sectors && ra_valid > 0; done += n) {
+        n = sectors - done;
+        if (n > ra_valid)
+            n = ra_valid;
+        offset = ra_size - ra_head;
+        if (n > offset)
+            n = offset;
+
+        memcpy(buf + done * 2048, &ra_buf[ra_head * 2048], n * 2048);
+        ra_consume(n);
+    }
+    ra_stats.hits += done;
+
+    return done;
+}
+
+static void cdvdman_readahead_thread(void *args)
+{
+    unsigned int tail, n;
+    u32 lsn, start, gen;
+    int result;
+
+    while (1) {
+        WaitSema(ra_thread_sema);
+        WaitSema(ra_sema);
+
+        while (ra_seq >= RA_SEQ_TRIGGER && !ra_reading && ra_valid < ra_size) {
+            n = ra_size - ra_valid;
+            if (n < ra_window && ra_valid > 0)
+                break; // Avoid small reads, wait for the game to consume more.
+            if (n > ra_window)
+                n = ra_window;
+
+            tail = (ra_head + ra_valid) % ra_size;
+            if (n > ra_size - tail)
+                n = ra_size - tail;
+
+            lsn = ra_lsn + ra_valid;
+            if (mediaLsnCount) {
+                if (lsn >= mediaLsnCount)
+                    break;
+                if (lsn + n > mediaLsnCount)
+                    n = mediaLsnCount - lsn;
+            }
+
+            // The sectors are read past the valid ones, so the game may use the ring meanwhile.
+            ra_fill = n;
+            gen = ra_gen;
+            SignalSema(ra_sema);
+
+            WaitSema(ra_dev_sema);
+            start = ra_get_ticks();
+            result = DeviceReadSectorsPtr(lsn, &ra_buf[tail * 2048], n);
+            // The sectors are added before the device is given to the game, which may be waiting for them.
+            WaitSema(ra_sema);
+            SignalSema(ra_dev_sema);
+
+            if (gen != ra_gen) {
+                // The game went elsewhere during the read.
+                ra_stats.wasted += n;
+                continue;
+            }
+
+            ra_fill = 0;
+            if (result != SCECdErNO) {
+                ra_seq = 0;
+                break;
+            }
+
+            ra_dev_ticks = (ra_dev_ticks * 3 + (ra_get_ticks() - start)) / 4;
+            ra_update_window();
+
+            ra_valid += n;
+            ra_stats.prefetched += n;
+        }
+
+        SignalSema(ra_sema);
+    }
+}
+
+int cdvdman_readahead_read(u32 lsn, void *buf, unsigned int sectors, unsigned int *hits)
+{
+    unsigned int done;
+    u32 now;
+    int result;
+
+    *hits = 0;
+    if (ra_disabled)
+        return DeviceReadSectorsPtr(lsn, buf, sectors);
+
+    WaitSema(ra_sema);
+
+    now = ra_get_ticks();
+    if (lsn == ra_next_lsn) {
+        if (ra_seq < 0xFF)
+            ra_seq++;
+        if (ra_last_sectors != 0)
+            ra_game_ticks = (ra_game_ticks * 3 + (now - ra_last_time) / ra_last_sectors) / 4;
+    } else {
+        ra_seq = 0;
+        ra_game_ticks = 0;
+        ra_run_sectors = 0;
+    }
+    if (sectors > ra_run_sectors)
+        ra_run_sectors = sectors;
+
+    // Serve what we can from the ring. If the next sectors are being prefetched, wait for them rather than reading them again.
+    done = ra_copy(lsn, buf, sectors);
+    while (done < sectors && ra_fill != 0 && lsn + done >= ra_lsn + ra_valid && lsn + done < ra_lsn + ra_valid + ra_fill) {
+        SignalSema(ra_sema);
+        WaitSema(ra_dev_sema);
+        SignalSema(ra_dev_sema);
+        WaitSema(ra_sema);
+
+        done += ra_copy(lsn + done, (u8 *)buf + done * 2048, sectors - done);
+    }
+    *hits = done;
+
+    // Requests that do not fit into half of the ring cannot be double-buffered, so they are read directly.
+    if (sectors > RA_RING_SECTORS / 2)
+        ra_seq = 0;
+
+    result = SCECdErNO;
+    if (done < sectors) {
+        // The prefetcher could not keep up with a sequential read.
+        if (ra_seq > RA_SEQ_TRIGGER && ra_size != 0) {
+            ra_stats.underruns++;
+            if (ra_window < ra_size / 2)
+                ra_dev_ticks *= 2;
+        }
+
+        ra_stats.misses += sectors - done;
+        ra_discard(lsn + sectors);
+
+        ra_reading = 1;
+        SignalSema(ra_sema);
+
+        WaitSema(ra_dev_sema);
+        result = DeviceReadSectorsPtr(lsn + done, (u8 *)buf + done * 2048, sectors - done);
+        SignalSema(ra_dev_sema);
+
+        WaitSema(ra_sema);
+        ra_reading = 0;
+    }
+
+    ra_next_lsn = lsn + sectors;
+    ra_last_time = now;
+    ra_last_sectors = sectors;
+
+    if (result == SCECdErNO && ra_seq >= RA_SEQ_TRIGGER && (ra_size != 0 || ra_alloc())) {
+        ra_update_window();
+        ra_stats.window = ra_window;
+        SignalSema(ra_thread_sema);
+    }
+
+    SignalSema(ra_sema);
+
+    return result;
+}
+
+void cdvdman_readahead_getstat(struct cdvdman_readahead_stats *stats)
+{
+    WaitSema(ra_sema);
+    memcpy(stats, &ra_stats, sizeof(ra_stats));
+    SignalSema(ra_sema);
+}
+
+// Called once the image is probed. The ring itself is only allocated once the game reads sequentially.
+void cdvdman_readahead_enable(void)
+{
+    iop_thread_t thread_param;
+    iop_sema_t smp;
+
+    // Accurate reads emulate the drive's transfer rate, so data must not arrive early.
+    if ((cdvdman_settings.common.flags & IOPCORE_COMPAT_ACCU_READS) || ra_thread_sema >= 0)
+        return;
+
+    smp.initial = 0;
+    smp.max = 1;
+    smp.attr = 0;
+    smp.option = 0;
+    ra_thread_sema = CreateSema(&smp);
+
+    // Just below the reading thread, as this thread mostly waits for the device.
+    thread_param.thread = &cdvdman_readahead_thread;
+    thread_param.stacksize = 0x1000;
+    thread_param.priority = 0x10;
+    thread_param.attr = TH_C;
+    thread_param.option = 0xABCD0002;
+
+    ra_ThreadID = CreateThread(&thread_param);
+    StartThread(ra_ThreadID, NULL);
+
+    ra_disabled = 0;
+}
+
+void cdvdman_readahead_init(void)
+{
+    iop_sema_t smp;
+
+    smp.initial = 1;
+    smp.max = 1;
+    smp.attr = 0;
+    smp.option = 0;
+    ra_sema = CreateSema(&smp);
+    ra_dev_sema = CreateSema(&smp);
+}
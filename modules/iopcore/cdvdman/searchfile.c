@@ -21,6 +21,33 @@ typedef struct
 
 static layer_info_t layer_info[2];
 
+/*  Lookup caches. The disc image cannot change, so nothing is ever invalidated.
+    Resolved paths (including the ones that were not found) are kept, and so are the last directory sectors read,
+    for looking up the other files of the same directories. Both are replaced in LRU order. */
+#define PATH_CACHE_ENTRIES 16
+#define PATH_CACHE_NAME    48 // Longer paths are not cached.
+#define DIR_CACHE_SECTORS  4
+
+typedef struct
+{
+    char name[PATH_CACHE_NAME];
+    u32 lsn;
+    u32 size;
+    u32 used;
+    u8 layer;
+    u8 found;
+} path_cache_entry_t;
+
+static path_cache_entry_t path_cache[PATH_CACHE_ENTRIES];
+static u8 *dir_cache_buf = NULL; // Allocated on the first lookup.
+static u32 dir_cache_lsn[DIR_CACHE_SECTORS];
+static u32 dir_cache_used[DIR_CACHE_SECTORS];
+static u8 dir_cache_disabled;
+static u8 dir_read_failed; // Set when a directory sector could not be read, so that the lookup is not cached.
+static u32 search_clock; // Incremented for every use of a cache entry.
+
+static struct cdvdman_search_stats search_stats;
+
 //-------------------------------------------------------------------------
 static void cdvdman_trimspaces(char *str)
 {
@@ -39,6 +66,97 @@ static void cdvdman_trimspaces(char *str)
     }
 }
 
+//-------------------------------------------------------------------------
+// Returns a directory sector, from the cache if possible.
+static u8 *cdvdman_read_dir_sector(u32 lsn)
+{
+    unsigned int i, slot;
+
+    if (dir_cache_buf == NULL && !dir_cache_disabled) {
+        if ((dir_cache_buf = AllocSysMemory(ALLOC_FIRST, DIR_CACHE_SECTORS * 2048, NULL)) == NULL)
+            dir_cache_disabled = 1;
+    }
+
+    if (dir_cache_buf == NULL) {
+        search_stats.dir_misses++;
+        if (sceCdRead(lsn, 1, cdvdman_buf, NULL) == 0) {
+            dir_read_failed = 1;
+            return NULL;
+        }
+        sceCdSync(0);
+        if (sceCdGetError() != SCECdErNO) {
+            dir_read_failed = 1;
+            return NULL;
+        }
+        return cdvdman_buf;
+    }
+
+    slot = 0;
+    for (i = 0; i < DIR_CACHE_SECTORS; i++) {
+        if (dir_cache_used[i] != 0 && dir_cache_lsn[i] == lsn) {
+            search_stats.dir_hits++;
+            dir_cache_used[i] = ++search_clock;
+            return &dir_cache_buf[i * 2048];
+        }
+        if (dir_cache_used[i] < dir_cache_used[slot])
+            slot = i;
+    }
+
+    search_stats.dir_misses++;
+    dir_cache_used[slot] = 0;
+    if (sceCdRead(lsn, 1, &dir_cache_buf[slot * 2048], NULL) == 0) {
+        dir_read_failed = 1;
+        return NULL;
+    }
+    sceCdSync(0);
+    if (sceCdGetError() != SCECdErNO) {
+        dir_read_failed = 1;
+        return NULL;
+    }
+
+    dir_cache_lsn[slot] = lsn;
+    dir_cache_used[slot] = ++search_clock;
+
+    return &dir_cache_buf[slot * 2048];
+}
+
+//-------------------------------------------------------------------------
+static path_cache_entry_t *cdvdman_path_cache_lookup(const char *name, int layer)
+{
+    unsigned int i;
+
+    for (i = 0; i < PATH_CACHE_ENTRIES; i++) {
+        if (path_cache[i].used != 0 && path_cache[i].layer == layer && !strcmp(path_cache[i].name, name)) {
+            path_cache[i].used = ++search_clock;
+            return &path_cache[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void cdvdman_path_cache_add(const char *name, int layer, const struct dirTocEntry *tocEntryPointer)
+{
+    unsigned int i, slot;
+
+    if (strlen(name) >= PATH_CACHE_NAME)
+        return;
+
+    for (slot = 0, i = 1; i < PATH_CACHE_ENTRIES; i++) {
+        if (path_cache[i].used < path_cache[slot].used)
+            slot = i;
+    }
+
+    strcpy(path_cache[slot].name, name);
+    path_cache[slot].layer = layer;
+    path_cache[slot].found = tocEntryPointer != NULL;
+    if (tocEntryPointer != NULL) {
+        path_cache[slot].lsn = tocEntryPointer->fileLBA;
+        path_cache[slot].size = tocEntryPointer->fileSize;
+    }
+    path_cache[slot].used = ++search_clock;
+}
+
 //-------------------------------------------------------------------------
 static struct dirTocEntry *cdvdman_locatefile(char *name, u32 tocLBA, int tocLength, int layer)
 {
@@ -53,6 +171,7 @@ static struct dirTocEntry *cdvdman_locatefile(char *name, u32 tocLBA, int tocLen
     int r, len, filename_len;
     int tocPos;
     struct dirTocEntry *tocEntryPointer;
+    u8 *tocSector;
 
 lbl_startlocate:
     DPRINTF("cdvdman_locatefile start locating %s, layer=%d\n", name, layer);
@@ -97,9 +216,8 @@ lbl_startlocate:
     }
 
     while (tocLength > 0) {
-        if (sceCdRead(tocLBA, 1, cdvdman_buf, NULL) == 0)
+        if ((tocSector = cdvdman_read_dir_sector(tocLBA)) == NULL)
             return NULL;
-        sceCdSync(0);
         DPRINTF("cdvdman_locatefile tocLBA read done\n");
 
         tocLength -= 2048;
@@ -107,7 +225,7 @@ lbl_startlocate:
 
         tocPos = 0;
         do {
-            tocEntryPointer = (struct dirTocEntry *)&cdvdman_buf[tocPos];
+            tocEntryPointer = (struct dirTocEntry *)&tocSector[tocPos];
 
             if (tocEntryPointer->length == 0)
                 break;
@@ -156,8 +274,9 @@ lbl_startlocate:
 static int cdvdman_findfile(sceCdlFILE *pcdfile, const char *name, int layer)
 {
     static char cdvdman_filepath[256];
-    u32 lsn;
+    u32 lsn, size;
     struct dirTocEntry *tocEntryPointer;
+    path_cache_entry_t *cached;
     layer_info_t *pLayerInfo;
 
     cdvdman_init();
@@ -181,13 +300,29 @@ static int cdvdman_findfile(sceCdlFILE *pcdfile, const char *name, int layer)
         return 0;
     }
 
-    tocEntryPointer = cdvdman_locatefile(cdvdman_filepath, pLayerInfo->rootDirtocLBA, pLayerInfo->rootDirtocLength, layer);
-    if (tocEntryPointer == NULL) {
-        SignalSema(cdvdman_searchfilesema);
-        return 0;
+    if ((cached = cdvdman_path_cache_lookup(cdvdman_filepath, layer)) != NULL) {
+        search_stats.path_hits++;
+        if (!cached->found) {
+            SignalSema(cdvdman_searchfilesema);
+            return 0;
+        }
+        lsn = cached->lsn;
+        size = cached->size;
+    } else {
+        search_stats.path_misses++;
+        dir_read_failed = 0;
+        tocEntryPointer = cdvdman_locatefile(cdvdman_filepath, pLayerInfo->rootDirtocLBA, pLayerInfo->rootDirtocLength, layer);
+        // A file that was not found because of a read error might be found on the next attempt.
+        if (tocEntryPointer != NULL || !dir_read_failed)
+            cdvdman_path_cache_add(cdvdman_filepath, layer, tocEntryPointer);
+        if (tocEntryPointer == NULL) {
+            SignalSema(cdvdman_searchfilesema);
+            return 0;
+        }
+        lsn = tocEntryPointer->fileLBA;
+        size = tocEntryPointer->fileSize;
     }
 
-    lsn = tocEntryPointer->fileLBA;
     if (layer) {
         sceCdReadDvdDualInfo((int *)&pcdfile->lsn, (unsigned int *)&pcdfile->size);
         lsn += pcdfile->size;
@@ -200,7 +335,7 @@ static int cdvdman_findfile(sceCdlFILE *pcdfile, const char *name, int layer)
          (!strncmp(&cdvdman_filepath[strlen(cdvdman_filepath) - 6], ".pss", 4))))
         pcdfile->size = 0;
     else
-        pcdfile->size = tocEntryPointer->fileSize;
+        pcdfile->size = size;
 
     strcpy(pcdfile->name, strrchr(name, '\\') + 1);
 
@@ -211,6 +346,14 @@ static int cdvdman_findfile(sceCdlFILE *pcdfile, const char *name, int layer)
     return 1;
 }
 
+//-------------------------------------------------------------------------
+void cdvdman_search_getstat(struct cdvdman_search_stats *stats)
+{
+    WaitSema(cdvdman_searchfilesema);
+    memcpy(stats, &search_stats, sizeof(search_stats));
+    SignalSema(cdvdman_searchfilesema);
+}
+
 //-------------------------------------------------------------------------
 int sceCdSearchFile(sceCdlFILE *pcd_file, const char *name)
 {
@@ -16,6 +16,9 @@
 
 #include "oplsmb.h"
 #include "smb.h"
+#ifdef SMB2
+#include "smb2.h"
+#endif
 #include "cdvd_config.h"
 
 #include "smsutils.h"
@@ -33,6 +36,12 @@
 #define CLIENT_MAX_XMIT_SIZE   USHRT_MAX //Allow up to 65535 bytes to be transmitted.
 #define CLIENT_MAX_RECV_SIZE   8192      //Allow up to 8192 bytes to be received.
 
+/* Reads larger than CLIENT_MAX_RECV_SIZE are split into smaller READ_ANDX requests, of which up to CLIENT_MAX_MPX_COUNT are outstanding.
+   The server then sends the next reply while the IOP is receiving the previous one, instead of waiting for a round trip.
+   All outstanding replies, with their headers, still fit into the TCP window. Replies are matched to requests with the MID. */
+#define CLIENT_MAX_MPX_COUNT         3
+#define CLIENT_PIPELINED_RECV_SIZE   3072
+
 int smb_io_sema = -1;
 
 #define WAITIOSEMA(x)   WaitSema(x)
@@ -60,8 +69,11 @@ static server_specs_t server_specs;
 #define LM_AUTH   0
 #define NTLM_AUTH 1
 
-static u16 UID, TID;
-static int main_socket = -1;
+static u16 UID, TID, MID;
+int main_socket = -1;
+#ifdef SMB2
+static u8 use_smb2; // The server chose SMB2 over SMB1.
+#endif
 
 static struct
 {
@@ -146,7 +158,7 @@ int OpenTCPSession(struct in_addr dst_IP, u16 dst_port)
 }
 
 //-------------------------------------------------------------------------
-static int SendData(int sock, char *buf, int size)
+int SendData(int sock, char *buf, int size)
 {
     int remaining, result;
     char *ptr;
@@ -165,7 +177,7 @@ static int SendData(int sock, char *buf, int size)
     return size;
 }
 
-static int RecvData(int sock, char *buf, int size)
+int RecvData(int sock, char *buf, int size)
 {
     int remaining, result;
     char *ptr;
@@ -184,6 +196,22 @@ static int RecvData(int sock, char *buf, int size)
     return size;
 }
 
+//Receives and drops the rest of a message. The data is dropped into the SMB1 buffer, which is not used with SMB2.
+int SkipData(int sock, int size)
+{
+    int result, toRecv;
+
+    while (size > 0) {
+        toRecv = size > MAX_SMB_BUF ? MAX_SMB_BUF : size;
+        result = RecvData(sock, (char *)SMB_buf.smb.u8buff, toRecv);
+        if (result <= 0)
+            return result;
+        size -= result;
+    }
+
+    return 1;
+}
+
 //-------------------------------------------------------------------------
 static int GetSMBServerReply(int shdrlen, void *spayload, int rhdrlen)
 {
@@ -264,12 +292,18 @@ static int setStringField(char *out, const char *in)
 //-------------------------------------------------------------------------
 int smb_NegotiateProtocol(char *SMBServerIP, int SMBServerPort, char *Username, char *Password, u32 *capabilities, OplSmbPwHashFunc_t hash_callback)
 {
-    char *dialect = "NT LM 0.12";
+    // Each dialect is a buffer format byte (0x02) followed by a NULL-terminated name. SMB 2.??? lets the server choose SMB2 instead.
+#ifdef SMB2
+    static const char dialects[] = "\002NT LM 0.12\000\002SMB 2.???";
+#else
+    static const char dialects[] = "\002NT LM 0.12";
+#endif
     NegotiateProtocolRequest_t *NPR = &SMB_buf.smb.negotiateProtocolRequest;
     NegotiateProtocolResponse_t *NPRsp = &SMB_buf.smb.negotiateProtocolResponse;
     register int length;
     struct in_addr dst_addr;
     iop_sema_t smp;
+    int smb1_only;
 
     smp.initial = 1;
     smp.max = 1;
@@ -281,6 +315,7 @@ int smb_NegotiateProtocol(char *SMBServerIP, int SMBServerPort, char *Username,
 
     // Opening TCP session
     main_socket = OpenTCPSession(dst_addr, SMBServerPort);
+    smb1_only = 0;
 
 negotiate_retry:
 
@@ -290,14 +325,35 @@ negotiate_retry:
     NPR->smbH.Cmd = SMB_COM_NEGOTIATE;
     NPR->smbH.Flags = SMB_FLAGS_CASELESS_PATHNAMES;
     NPR->smbH.Flags2 = SMB_FLAGS2_KNOWS_LONG_NAMES;
-    length = strlen(dialect);
-    NPR->ByteCount = length + 2;
-    NPR->DialectFormat = 0x02;
-    strcpy(NPR->DialectName, dialect);
+    length = smb1_only ? strlen(&dialects[1]) + 2 : sizeof(dialects);
+    NPR->ByteCount = length;
+    memcpy(&NPR->DialectFormat, dialects, length);
 
-    nb_SetSessionMessage(sizeof(NegotiateProtocolRequest_t) + length + 1);
+    nb_SetSessionMessage(sizeof(NegotiateProtocolRequest_t) + length - 1);
     GetSMBServerReply(0, NULL, 0);
 
+#ifdef SMB2
+    // The server replied with a SMB2 Negotiate Protocol response.
+    if (NPRsp->smbH.Magic == SMB2_MAGIC) {
+        strncpy(server_specs.Username, Username, sizeof(server_specs.Username));
+        server_specs.Username[sizeof(server_specs.Username) - 1] = '\0';
+        strncpy(server_specs.Password, Password, sizeof(server_specs.Password));
+        server_specs.Password[sizeof(server_specs.Password) - 1] = '\0';
+        server_specs.IOPaddr = (void *)&server_specs;
+
+        if (smb2_NegotiateProtocol(&server_specs, hash_callback) > 0) {
+            use_smb2 = 1;
+            return 1;
+        }
+
+        // SMB2 could not be used (i.e. signing is required), so fall back to SMB1 over a new connection.
+        plwip_close(main_socket);
+        main_socket = OpenTCPSession(dst_addr, SMBServerPort);
+        smb1_only = 1;
+        goto negotiate_retry;
+    }
+#endif
+
     // check sanity of SMB header
     if (NPRsp->smbH.Magic != SMB_MAGIC)
         goto negotiate_retry;
@@ -342,6 +398,12 @@ int smb_SessionSetupAndX(u32 capabilities)
     int AuthType = NTLM_AUTH;
     int password_len = 0;
 
+#ifdef SMB2
+    // With SMB2, the session was already set up during the Negotiate Protocol.
+    if (use_smb2)
+        return 1;
+#endif
+
 lbl_session_setup:
     ZERO_PKT_ALIGNED(SSR, sizeof(SessionSetupAndXRequest_t));
 
@@ -356,7 +418,7 @@ lbl_session_setup:
     SSR->smbWordcount = 13;
     SSR->smbAndxCmd = SMB_COM_NONE; // no ANDX command
     SSR->MaxBufferSize = CLIENT_MAX_BUFFER_SIZE;
-    SSR->MaxMpxCount = server_specs.MaxMpxCount >= 2 ? 2 : (u16)server_specs.MaxMpxCount;
+    SSR->MaxMpxCount = server_specs.MaxMpxCount >= CLIENT_MAX_MPX_COUNT ? CLIENT_MAX_MPX_COUNT : (u16)server_specs.MaxMpxCount;
     SSR->VCNumber = 1;
     SSR->SessionKey = server_specs.SessionKey;
     SSR->Capabilities = capabilities;
@@ -437,6 +499,11 @@ int smb_TreeConnectAndX(char *ShareName)
     int AuthType = NTLM_AUTH;
     int password_len = 0;
 
+#ifdef SMB2
+    if (use_smb2)
+        return smb2_TreeConnect(ShareName);
+#endif
+
     ZERO_PKT_ALIGNED(TCR, sizeof(TreeConnectAndXRequest_t));
 
     TCR->smbH.Magic = SMB_MAGIC;
@@ -497,9 +564,22 @@ int smb_OpenAndX(char *filename, u8 *FID, int Write)
     OpenAndXRequest_t *OR = &SMB_buf.smb.openAndXRequest;
     OpenAndXResponse_t *ORsp = &SMB_buf.smb.openAndXResponse;
     register int offset;
+#ifdef SMB2
+    u16 fid;
+    int r;
+#endif
 
     WAITIOSEMA(smb_io_sema);
 
+#ifdef SMB2
+    if (use_smb2) {
+        if ((r = smb2_Open(filename, &fid, Write)) > 0)
+            memcpy(FID, &fid, 2);
+        SIGNALIOSEMA(smb_io_sema);
+        return r;
+    }
+#endif
+
     ZERO_PKT_ALIGNED(OR, sizeof(OpenAndXRequest_t));
 
     OR->smbH.Magic = SMB_MAGIC;
@@ -558,6 +638,11 @@ int smb_Close(int FID)
 
     //  WAITIOSEMA(smb_io_sema);
 
+#ifdef SMB2
+    if (use_smb2)
+        return smb2_Close(FID);
+#endif
+
     ZERO_PKT_ALIGNED(CR, sizeof(CloseRequest_t));
 
     CR->smbH.Magic = SMB_MAGIC;
@@ -594,16 +679,18 @@ int smb_Close(int FID)
 }
 
 //-------------------------------------------------------------------------
-static int smb_ReadAndX(u16 FID, u32 offsetlow, u32 offsethigh, void *readbuf, int nbytes)
+struct smb_read_request
+{
+    u16 MID;
+    u8 pending;
+    int pos;    // Position of the data within the buffer
+    int nbytes; // Size requested
+    int result; // Size received, or a negative error code
+};
+
+static int smb_SendReadAndX(u16 FID, u32 offsetlow, u32 offsethigh, int nbytes, u16 mid)
 {
     ReadAndXRequest_t *RR = &SMB_buf.smb.readAndXRequest;
-    ReadAndXResponse_t *RRsp = &SMB_buf.smb.readAndXResponse;
-    register int r, DataLength;
-#ifdef USE_CUSTOM_RECV
-    int rcv_size, expected_size;
-#else
-    int padding;
-#endif
 
     ZERO_PKT_ALIGNED(RR, sizeof(ReadAndXRequest_t));
 
@@ -612,6 +699,7 @@ static int smb_ReadAndX(u16 FID, u32 offsetlow, u32 offsethigh, void *readbuf, i
     RR->smbH.Cmd = SMB_COM_READ_ANDX;
     RR->smbH.UID = (u16)UID;
     RR->smbH.TID = (u16)TID;
+    RR->smbH.MID = mid;
     RR->smbWordcount = 12;
     RR->smbAndxCmd = SMB_COM_NONE; // no ANDX command
     RR->FID = (u16)FID;
@@ -622,84 +710,152 @@ static int smb_ReadAndX(u16 FID, u32 offsetlow, u32 offsethigh, void *readbuf, i
 
     nb_SetSessionMessage(sizeof(ReadAndXRequest_t));
 
-#ifdef USE_CUSTOM_RECV
     //Send the whole message, including the 4-byte direct transport packet header.
-    r = SendData(main_socket, (char *)&SMB_buf, sizeof(ReadAndXRequest_t) + 4);
-    if (r <= 0)
-        return -1;
+    return SendData(main_socket, (char *)&SMB_buf, sizeof(ReadAndXRequest_t) + 4);
+}
 
-    //offset 49 is the offset of the DataOffset field within the ReadAndXResponse structure.
-    //recvfrom() is a custom function that will receive the reply.
+/* Receives the reply to one of the outstanding READ_ANDX requests. The reply may be for any of them, as the server may complete them out of order.
+   Once several requests are outstanding, a reply no longer starts at the beginning of a TCP segment, so the header is received first.
+   The data is then received straight into the request's part of the buffer. Returns the request, or NULL if the connection failed. */
+static struct smb_read_request *smb_RecvReadAndX(struct smb_read_request *requests, u8 *readbuf)
+{
+    ReadAndXResponse_t *RRsp = &SMB_buf.smb.readAndXResponse;
+    struct smb_read_request *req;
+    int length, size, padding, DataLength, i;
+#ifdef USE_CUSTOM_RECV
+    int r, rcv_size;
+#endif
+
+    //Read NetBIOS session message header. Drop NBSS Session Keep alive messages (type == 0x85, with no body).
     do {
-        rcv_size = plwip_recvfrom(main_socket, &SMB_buf, 49, readbuf, nbytes, 0, NULL, NULL);
-        if (rcv_size <= 0)
-            return -2;
-    } while (nb_GetPacketType() != 0); // dropping NBSS Session Keep alive
+        if (RecvData(main_socket, (char *)&SMB_buf.sessionHeader, sizeof(SMB_buf.sessionHeader)) <= 0)
+            return NULL;
+    } while (nb_GetPacketType() != 0);
 
-    expected_size = nb_GetSessionMessageLength() + 4;
-    DataLength = (int)(((u32)RRsp->DataLengthHigh << 16) | RRsp->DataLengthLow);
+    //Error replies have no parameters, so they are shorter than ReadAndXResponse_t.
+    length = nb_GetSessionMessageLength();
+    size = length < (int)sizeof(ReadAndXResponse_t) ? length : (int)sizeof(ReadAndXResponse_t);
+    if (size < SMB_HDR_SIZE || RecvData(main_socket, (char *)RRsp, size) <= 0)
+        return NULL;
 
-    // Handle fragmented packets
-    while (rcv_size < expected_size) {
-        r = plwip_recvfrom(main_socket, NULL, 0, &((u8 *)readbuf)[rcv_size - RRsp->DataOffset - 4], expected_size - rcv_size, 0, NULL, NULL); // - rcv_size
-        rcv_size += r;
+    for (i = 0, req = NULL; i < CLIENT_MAX_MPX_COUNT; i++) {
+        if (requests[i].pending && requests[i].MID == RRsp->smbH.MID) {
+            req = &requests[i];
+            break;
+        }
     }
-#else
-    r = GetSMBServerReply(0, NULL, sizeof(ReadAndXResponse_t));
-    if (r <= 0)
-        return -EIO;
+    if (req == NULL)
+        return NULL;
+    req->pending = 0;
 
     // check there's no error
-    if ((RRsp->smbH.Eclass | (RRsp->smbH.Ecode << 16)) != STATUS_SUCCESS)
-        return -EIO;
-
-    //Skip any padding bytes.
-    padding = RRsp->DataOffset - sizeof(ReadAndXResponse_t);
-    if (padding > 0) {
-        r = RecvData(main_socket, (char *)(RRsp + 1), padding);
-        if (r <= 0)
-            return -2;
+    if (size < (int)sizeof(ReadAndXResponse_t) || (RRsp->smbH.Eclass | (RRsp->smbH.Ecode << 16)) != STATUS_SUCCESS) {
+        req->result = -EIO;
+        return (SkipData(main_socket, length - size) > 0) ? req : NULL;
     }
 
     DataLength = (int)(((u32)RRsp->DataLengthHigh << 16) | RRsp->DataLengthLow);
-    if (DataLength > 0) {
-        r = RecvData(main_socket, readbuf, DataLength);
+    padding = RRsp->DataOffset - sizeof(ReadAndXResponse_t);
+    if (DataLength > req->nbytes || padding < 0 || RRsp->DataOffset + DataLength > length)
+        return NULL;
+    size = length - RRsp->DataOffset - DataLength;
+
+    //Skip any padding bytes.
+    if (padding > 0 && SkipData(main_socket, padding) <= 0)
+        return NULL;
+
+#ifdef USE_CUSTOM_RECV
+    //recvfrom() copies the data from the received frames into the buffer, without going through a socket buffer.
+    for (rcv_size = 0; rcv_size < DataLength; rcv_size += r) {
+        r = plwip_recvfrom(main_socket, NULL, 0, &readbuf[req->pos + rcv_size], DataLength - rcv_size, 0, NULL, NULL);
         if (r <= 0)
-            return -2;
+            return NULL;
     }
+#else
+    if (DataLength > 0 && RecvData(main_socket, (char *)&readbuf[req->pos], DataLength) <= 0)
+        return NULL;
 #endif
 
-    return DataLength;
+    req->result = DataLength;
+    return (size == 0 || SkipData(main_socket, size) > 0) ? req : NULL;
 }
 
 int smb_ReadFile(u16 FID, u32 offsetlow, u32 offsethigh, void *readbuf, int nbytes)
 {
-    int result, remaining, toRead;
-    char *ptr;
-
-    remaining = nbytes;
-    ptr = readbuf;
+    struct smb_read_request requests[CLIENT_MAX_MPX_COUNT], *req;
+    int result, sent, resume, pending, maxpending, maxsize, toRead, i;
+    u32 low;
 
     WAITIOSEMA(smb_io_sema);
 
-    while (remaining > 0) {
-        toRead = remaining > CLIENT_MAX_RECV_SIZE ? CLIENT_MAX_RECV_SIZE : remaining;
+#ifdef SMB2
+    if (use_smb2) {
+        result = smb2_ReadFile(FID, ((u64)offsethigh << 32) | offsetlow, readbuf, nbytes);
+        SIGNALIOSEMA(smb_io_sema);
+        return result;
+    }
+#endif
 
-        result = smb_ReadAndX(FID, offsetlow, offsethigh, ptr, toRead);
-        if (result <= 0)
-            return result;
+    // Reads that fit into a single request are sent as one.
+    maxpending = server_specs.MaxMpxCount < CLIENT_MAX_MPX_COUNT ? server_specs.MaxMpxCount : CLIENT_MAX_MPX_COUNT;
+    if (maxpending < 1 || nbytes <= CLIENT_MAX_RECV_SIZE)
+        maxpending = 1;
+    maxsize = maxpending > 1 ? CLIENT_PIPELINED_RECV_SIZE : CLIENT_MAX_RECV_SIZE;
+    memset(requests, 0, sizeof(requests));
+
+    result = nbytes;
+    sent = 0;
+    resume = nbytes; // Where to continue from, after a short read.
+    pending = 0;
+    while (sent < nbytes || pending > 0) {
+        // Keep the server busy, by sending the next requests before the replies to the previous ones arrive.
+        while (pending < maxpending && sent < nbytes) {
+            for (i = 0; requests[i].pending; i++)
+                ;
+            req = &requests[i];
+
+            toRead = nbytes - sent > maxsize ? maxsize : nbytes - sent;
+            req->MID = ++MID;
+            req->pending = 1;
+            req->pos = sent;
+            req->nbytes = toRead;
+
+            //Check for and handle overflow.
+            low = offsetlow + sent;
+            if (smb_SendReadAndX(FID, low, offsethigh + (low < offsetlow), toRead, req->MID) <= 0) {
+                SIGNALIOSEMA(smb_io_sema);
+                return -1;
+            }
+            sent += toRead;
+            pending++;
+        }
 
-        //Check for and handle overflow.
-        if (offsetlow + result < offsetlow)
-            offsethigh++;
-        offsetlow += result;
-        ptr += result;
-        remaining -= result;
+        if ((req = smb_RecvReadAndX(requests, readbuf)) == NULL) {
+            SIGNALIOSEMA(smb_io_sema);
+            return -2;
+        }
+        pending--;
+
+        if (req->result <= 0) {
+            // Wait for the other replies, to keep the connection in sync.
+            result = req->result;
+            sent = nbytes;
+        } else if (req->result < req->nbytes) {
+            // The following requests may have been sent from the wrong offsets. Once they complete, continue from the end of this one.
+            if (req->pos + req->result < resume)
+                resume = req->pos + req->result;
+            sent = nbytes;
+        }
+
+        if (pending == 0 && resume < nbytes && result > 0) {
+            sent = resume;
+            resume = nbytes;
+        }
     }
 
     SIGNALIOSEMA(smb_io_sema);
 
-    return nbytes;
+    return result;
 }
 
 //-------------------------------------------------------------------------
@@ -751,6 +907,14 @@ int smb_WriteFile(u16 FID, u32 offsetlow, u32 offsethigh, void *writebuf, int nb
 
     WAITIOSEMA(smb_io_sema);
 
+#ifdef SMB2
+    if (use_smb2) {
+        result = smb2_WriteFile(FID, ((u64)offsethigh << 32) | offsetlow, writebuf, nbytes);
+        SIGNALIOSEMA(smb_io_sema);
+        return result;
+    }
+#endif
+
     while (remaining > 0) {
         toWrite = remaining > CLIENT_MAX_XMIT_SIZE ? CLIENT_MAX_XMIT_SIZE : remaining;
 
@@ -272,6 +272,7 @@
 #define SERVER_USER_SECURITY_LEVEL    1
 #define SERVER_USE_PLAINTEXT_PASSWORD 0
 #define SERVER_USE_ENCRYPTED_PASSWORD 1
+#define SERVER_USE_NTLMV2_PASSWORD    2
 
 typedef struct
 {
@@ -509,6 +510,11 @@ int smb_ReadCD(unsigned int lsn, unsigned int nsectors, void *buf, int part_num)
 void smb_CloseAll(void);
 int smb_Disconnect(void);
 
+// shared with the SMB2 client
+int SendData(int sock, char *buf, int size);
+int RecvData(int sock, char *buf, int size);
+int SkipData(int sock, int size); // receives and drops size bytes
+
 #define MAX_SMB_BUF     896 // must fit on u16 !!!
 #define MAX_SMB_BUF_HDR 128 //Must be at least as large as the largest header structure.
 
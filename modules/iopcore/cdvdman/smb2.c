@@ -0,0 +1,811 @@
+/*
+  Copyright 2026, Open PS2 Loader contributors
+  Licenced under Academic Free License version 3.0
+  Review Open PS2 Loader README & LICENSE files for further details.
+*/
+
+#include <stdio.h>
+#include <errno.h>
+#include <sysclib.h>
+#include "smstcpip.h"
+#include <limits.h>
+#include <thbase.h>
+
+#include "oplsmb.h"
+#include "smb.h"
+#include "smb2.h"
+#include "cdvd_config.h"
+
+#include "smsutils.h"
+
+/*
+  SMB2 client, for servers that no longer accept SMB1. It is only built into smb_cdvdman.irx with SMB2=1.
+  The server is offered SMB2 in the SMB1 Negotiate Protocol request. If it picks SMB2, the SMB1 functions in smb.c call
+  these functions instead. Only what the in-game driver needs is supported: reading and writing existing files.
+  There is no signing, so servers that require it cannot be used. Authentication is done with NTLMSSP, using the
+  LMv2/NTLMv2 responses (computed by smbinit).
+*/
+
+#define SMB2_MAX_BUF 1024
+
+// Dialect 2.1 with large MTU allows requests larger than 64KB, at the cost of one credit per 64KB.
+#define SMB2_CREDIT_SIZE    65536
+#define SMB2_MAX_READ_SIZE  262144
+#define SMB2_MAX_WRITE_SIZE 65536
+#define SMB2_CREDITS_TARGET 32
+
+// Number of READ requests that may be outstanding, so that the server does not wait for a round trip between them.
+#define SMB2_MAX_PENDING_READS 2
+
+// The NTLMv2 blob: RespType, HiRespType, Reserved, TimeStamp, ChallengeFromClient and Reserved, followed by the server's AV pairs.
+#define NTLMV2_BLOB_HDR_SIZE   28
+#define NTLMV2_MAX_TARGET_INFO 256
+
+// Files are opened by the game's driver (all ISO parts) and by MCEMU (2 VMCs).
+#define SMB2_MAX_FILES (ISO_MAX_PARTS + 2)
+
+enum SMB2_HANDLE_STATE {
+    SMB2_HANDLE_FREE = 0,
+    SMB2_HANDLE_PENDING, // The CREATE is sent with the first READ.
+    SMB2_HANDLE_OPEN,
+    SMB2_HANDLE_ERROR,
+};
+
+struct smb2_file
+{
+    u64 FileId[2];
+    u8 state;
+    u8 write;
+};
+
+struct smb2_read_request
+{
+    u64 MessageId;
+    u8 pending;
+    int pos;    // Position of the data within the buffer
+    int nbytes; // Size requested
+    int result; // Size received, or a negative error code
+};
+
+extern int main_socket;
+
+static struct
+{
+    //Direct transport packet header. This is also a NetBIOS session header.
+    u32 sessionHeader;
+    union
+    {
+        u8 u8buff[SMB2_MAX_BUF];
+        SMB2Header_t smb2H;
+        SMB2NegotiateRequest_t negotiateRequest;
+        SMB2NegotiateResponse_t negotiateResponse;
+        SMB2SessionSetupRequest_t sessionSetupRequest;
+        SMB2SessionSetupResponse_t sessionSetupResponse;
+        SMB2TreeConnectRequest_t treeConnectRequest;
+        SMB2CreateRequest_t createRequest;
+        SMB2CreateResponse_t createResponse;
+        SMB2CloseRequest_t closeRequest;
+        SMB2ReadRequest_t readRequest;
+        SMB2WriteRequest_t writeRequest;
+        SMB2WriteResponse_t writeResponse;
+    } smb2;
+} __attribute__((packed, aligned(8))) SMB2_buf;
+
+static u64 SessionId, MessageId;
+static u32 TreeId, Credits;
+static u32 MaxReadSize, MaxWriteSize;
+static u8 LargeMTU;
+static u64 ServerTime; // From the Negotiate response, in case the NTLMSSP challenge has no timestamp
+static u32 MessageLeft;  // Bytes left to be received, of the current NetBIOS session message
+static u32 ResponseLeft; // Bytes left to be received, of the current response within the message
+
+static struct smb2_file files[SMB2_MAX_FILES];
+static char PendingName[256]; // Name of the file that is waiting to be opened
+static int PendingFID = -1;
+
+//-------------------------------------------------------------------------
+static void nb_SetSessionMessage(u32 size)
+{
+    // Byte-swap length into network byte-order.
+    SMB2_buf.sessionHeader = ((size & 0xff0000) >> 8) | ((size & 0xff00) << 8) | ((size & 0xff) << 24);
+}
+
+static int nb_GetSessionMessageLength(void)
+{
+    // Byte-swap length from network byte-order.
+    return (int)(((SMB2_buf.sessionHeader << 8) & 0xff0000) | ((SMB2_buf.sessionHeader >> 8) & 0xff00) | ((SMB2_buf.sessionHeader >> 24) & 0xff));
+}
+
+static int asciiToUtf16(u8 *out, const char *in)
+{
+    int len;
+
+    for (len = 0; *in != '\0'; in++, len += 2) {
+        out[len] = *in;
+        out[len + 1] = '\0';
+    }
+
+    return len;
+}
+
+//-------------------------------------------------------------------------
+// Fills the header of a request, which takes one credit per 64KB transferred.
+static void smb2_SetHeader(SMB2Header_t *hdr, u16 command, u32 size)
+{
+    u16 charge;
+
+    charge = LargeMTU ? (size + SMB2_CREDIT_SIZE - 1) / SMB2_CREDIT_SIZE : 1;
+    if (charge == 0)
+        charge = 1;
+
+    hdr->ProtocolId = SMB2_MAGIC;
+    hdr->StructureSize = SMB2_HDR_SIZE;
+    hdr->CreditCharge = LargeMTU ? charge : 0;
+    hdr->Command = command;
+    hdr->MessageId = MessageId;
+    hdr->SessionId = SessionId;
+    hdr->TreeId = TreeId;
+
+    MessageId += charge;
+    Credits = Credits > charge ? Credits - charge : 0;
+    // Ask for enough credits to keep the reads going.
+    hdr->Credits = Credits < SMB2_CREDITS_TARGET ? SMB2_CREDITS_TARGET - Credits : 1;
+}
+
+/* The connection failed, or what was received can no longer be matched to the requests.
+   Replies to requests in flight cannot be told apart from the next ones, so the connection is closed and all further requests fail. */
+static int smb2_Fail(void)
+{
+    smb_Disconnect();
+    MessageLeft = 0;
+    ResponseLeft = 0;
+    return -2;
+}
+
+static int smb2_Send(int size)
+{
+    nb_SetSessionMessage(size);
+
+    //Send the whole message, including the 4-byte direct transport packet header.
+    if (SendData(main_socket, (char *)&SMB2_buf, size + 4) <= 0)
+        return smb2_Fail();
+
+    return size;
+}
+
+static int smb2_RecvBody(void *buf, int size)
+{
+    if (size > ResponseLeft || (size > 0 && RecvData(main_socket, buf, size) <= 0))
+        return smb2_Fail();
+
+    ResponseLeft -= size;
+    MessageLeft -= size;
+    return size;
+}
+
+// Drops the next size bytes of the current response.
+static int smb2_Skip(int size)
+{
+    if (size > ResponseLeft || SkipData(main_socket, size) <= 0)
+        return smb2_Fail();
+
+    ResponseLeft -= size;
+    MessageLeft -= size;
+    return 0;
+}
+
+// Drops the rest of the current response.
+static int smb2_SkipResponse(void)
+{
+    return smb2_Skip(ResponseLeft);
+}
+
+/* Receives the header of the next response, which may follow the previous one within the same message (compounded).
+   Interim responses, which tell that the server will complete the request later, are dropped. */
+static int smb2_RecvHeader(SMB2Header_t *hdr)
+{
+    while (1) {
+        if (MessageLeft == 0) {
+            //Read NetBIOS session message header. Drop NBSS Session Keep alive messages (type == 0x85, with no body).
+            do {
+                if (RecvData(main_socket, (char *)&SMB2_buf.sessionHeader, sizeof(SMB2_buf.sessionHeader)) <= 0)
+                    return smb2_Fail();
+            } while ((SMB2_buf.sessionHeader & 0xff) != 0);
+            MessageLeft = nb_GetSessionMessageLength();
+        }
+
+        if (MessageLeft < SMB2_HDR_SIZE || RecvData(main_socket, (char *)hdr, SMB2_HDR_SIZE) <= 0)
+            return smb2_Fail();
+        MessageLeft -= SMB2_HDR_SIZE;
+
+        if (hdr->ProtocolId != SMB2_MAGIC)
+            return smb2_Fail();
+        Credits += hdr->Credits;
+
+        ResponseLeft = hdr->NextCommand != 0 ? hdr->NextCommand - SMB2_HDR_SIZE : MessageLeft;
+        if (ResponseLeft > MessageLeft)
+            return smb2_Fail();
+
+        if (hdr->Status != STATUS_PENDING || !(hdr->Flags & SMB2_FLAGS_ASYNC_COMMAND))
+            return 0;
+
+        if (smb2_SkipResponse() < 0)
+            return -2;
+    }
+}
+
+// Receives the next response into buf. Up to size bytes of it are kept. Returns its status, or -2 if the connection failed.
+static int smb2_RecvResponse(void *buf, int size)
+{
+    SMB2Header_t *hdr = (SMB2Header_t *)buf;
+    int r;
+
+    if (smb2_RecvHeader(hdr) < 0)
+        return -2;
+
+    r = size - SMB2_HDR_SIZE;
+    if (r > ResponseLeft)
+        r = ResponseLeft;
+    if (smb2_RecvBody((u8 *)buf + SMB2_HDR_SIZE, r) < 0 || smb2_SkipResponse() < 0)
+        return -2;
+
+    return hdr->Status;
+}
+
+// Sends the request in SMB2_buf, and receives the response into it.
+static int smb2_Transact(int reqsize, int size)
+{
+    if (smb2_Send(reqsize) <= 0)
+        return -2;
+
+    return smb2_RecvResponse(&SMB2_buf.smb2, size);
+}
+
+//-------------------------------------------------------------------------
+static int smb2_SessionSetup(void *token, int length)
+{
+    SMB2SessionSetupRequest_t *SSR = &SMB2_buf.smb2.sessionSetupRequest;
+
+    memset(SSR, 0, sizeof(SMB2SessionSetupRequest_t));
+    smb2_SetHeader(&SSR->smb2H, SMB2_SESSION_SETUP, 0);
+    SSR->StructureSize = 25;
+    SSR->SecurityMode = SMB2_NEGOTIATE_SIGNING_ENABLED;
+    SSR->SecurityBufferOffset = sizeof(SMB2SessionSetupRequest_t);
+    SSR->SecurityBufferLength = length;
+    memcpy(SSR->Buffer, token, length);
+
+    return smb2_Transact(sizeof(SMB2SessionSetupRequest_t) + length, SMB2_MAX_BUF);
+}
+
+// Adds a field to the payload of a NTLMSSP message. If data is NULL, the field is already in place.
+static void ntlmssp_SetField(NTLMSSPField_t *field, u8 *msg, int *offset, const void *data, int length)
+{
+    field->Length = length;
+    field->MaxLength = length;
+    field->Offset = *offset;
+    if (data != NULL)
+        memcpy(&msg[*offset], data, length);
+    *offset += length;
+}
+
+// Copies a field of a NTLMSSP message into an ASCII string, if it is within the message.
+static void ntlmssp_GetString(char *out, int size, const u8 *msg, int msglen, const NTLMSSPField_t *field, int unicode)
+{
+    int i, step;
+
+    step = unicode ? 2 : 1;
+    out[0] = '\0';
+    if (field->Offset + field->Length > msglen)
+        return;
+
+    for (i = 0; i < field->Length / step && i < size - 1; i++)
+        out[i] = msg[field->Offset + i * step];
+    out[i] = '\0';
+}
+
+/* Builds the NTLMv2 blob, which the NTLMv2 response is computed over. It carries the AV pairs from the challenge.
+   Returns its length. */
+static int ntlmv2_SetBlob(u8 *blob, const u8 *info, int infolen)
+{
+    iop_sys_clock_t clock;
+    u64 timestamp;
+    int i, length;
+
+    // Use the server's time, if it sent one.
+    timestamp = ServerTime;
+    for (i = 0; i + 4 <= infolen; i += 4 + length) {
+        length = info[i + 2] | (info[i + 3] << 8);
+        if (info[i] == NTLMSSP_AV_TIMESTAMP && info[i + 1] == 0 && length == 8 && i + 12 <= infolen)
+            memcpy(&timestamp, &info[i + 4], 8);
+    }
+
+    memset(blob, 0, NTLMV2_BLOB_HDR_SIZE);
+    blob[0] = 1; // RespType
+    blob[1] = 1; // HiRespType
+    memcpy(&blob[8], &timestamp, 8);
+
+    // The IOP has no source of random numbers, so the client challenge is taken from the system clock.
+    GetSystemTime(&clock);
+    memcpy(&blob[16], &clock, 8);
+
+    // The AV pairs end with MsvAvEOL, followed by 4 bytes of padding.
+    memcpy(&blob[NTLMV2_BLOB_HDR_SIZE], info, infolen);
+    memset(&blob[NTLMV2_BLOB_HDR_SIZE + infolen], 0, infolen > 0 ? 4 : 8);
+
+    return NTLMV2_BLOB_HDR_SIZE + infolen + (infolen > 0 ? 4 : 8);
+}
+
+// Logs in with NTLMSSP: the server sends a challenge, which is answered with the LMv2/NTLMv2 responses.
+static int smb2_Login(server_specs_t *specs, OplSmbPwHashFunc_t hash_callback)
+{
+    SMB2SessionSetupResponse_t *SSRsp = &SMB2_buf.smb2.sessionSetupResponse;
+    NTLMSSPNegotiate_t negotiate;
+    NTLMSSPChallenge_t *challenge;
+    NTLMSSPAuthenticate_t *auth;
+    u8 token[sizeof(NTLMSSPAuthenticate_t) + 24 + 16 + NTLMV2_BLOB_HDR_SIZE + NTLMV2_MAX_TARGET_INFO + 8 + (sizeof(specs->PrimaryDomainServerName) + sizeof(specs->Username)) * 2];
+    u8 name[sizeof(specs->Username) * 2];
+    int offset, length, bloblen, infolen, flags;
+
+    memset(&negotiate, 0, sizeof(negotiate));
+    memcpy(negotiate.Signature, "NTLMSSP", 8);
+    negotiate.MessageType = NTLMSSP_NEGOTIATE_MESSAGE;
+    negotiate.NegotiateFlags = NTLMSSP_NEGOTIATE_UNICODE | NTLMSSP_NEGOTIATE_OEM | NTLMSSP_REQUEST_TARGET | NTLMSSP_NEGOTIATE_NTLM | NTLMSSP_NEGOTIATE_ALWAYS_SIGN;
+
+    if (smb2_SessionSetup(&negotiate, sizeof(negotiate)) != STATUS_MORE_PROCESSING_REQUIRED)
+        return -1;
+    SessionId = SSRsp->smb2H.SessionId;
+
+    challenge = (NTLMSSPChallenge_t *)&SMB2_buf.smb2.u8buff[SSRsp->SecurityBufferOffset];
+    length = SSRsp->SecurityBufferLength;
+    if (SSRsp->SecurityBufferOffset + length > SMB2_MAX_BUF || length < sizeof(NTLMSSPChallenge_t) ||
+        memcmp(challenge->Signature, "NTLMSSP", 8) != 0 || challenge->MessageType != NTLMSSP_CHALLENGE_MESSAGE)
+        return -1;
+    flags = challenge->NegotiateFlags & negotiate.NegotiateFlags;
+
+    // The NTLMv2 hash is computed over the domain, which is also sent to the server.
+    ntlmssp_GetString(specs->PrimaryDomainServerName, sizeof(specs->PrimaryDomainServerName), (u8 *)challenge, length, &challenge->TargetName, flags & NTLMSSP_NEGOTIATE_UNICODE);
+
+    // Without the AV pairs (i.e. they do not fit), the blob has only MsvAvEOL.
+    infolen = challenge->TargetInfo.Length;
+    if (challenge->TargetInfo.Offset + infolen > length || infolen > NTLMV2_MAX_TARGET_INFO)
+        infolen = 0;
+
+    // The NTLMv2 response is the NTProofStr, followed by the blob.
+    offset = sizeof(NTLMSSPAuthenticate_t) + 24 + 16;
+    bloblen = ntlmv2_SetBlob(&token[offset], (u8 *)challenge + challenge->TargetInfo.Offset, infolen);
+
+    // Get the responses to the challenge.
+    memcpy(specs->EncryptionKey, challenge->ServerChallenge, sizeof(specs->EncryptionKey));
+    specs->SecurityMode = SERVER_USER_SECURITY_LEVEL;
+    specs->PasswordType = SERVER_USE_NTLMV2_PASSWORD;
+    specs->PasswordLen = 0;
+    specs->HashedFlag = 0;
+    specs->Blob = &token[offset];
+    specs->BlobLen = bloblen;
+    hash_callback(specs);
+
+    auth = (NTLMSSPAuthenticate_t *)token;
+    memset(auth, 0, sizeof(NTLMSSPAuthenticate_t));
+    memcpy(auth->Signature, "NTLMSSP", 8);
+    auth->MessageType = NTLMSSP_AUTHENTICATE_MESSAGE;
+    auth->NegotiateFlags = flags;
+
+    offset = sizeof(NTLMSSPAuthenticate_t);
+    if (specs->PasswordLen == 24) {
+        ntlmssp_SetField(&auth->LmChallengeResponse, token, &offset, &specs->Password[0], 24);
+        memcpy(&token[offset], &specs->Password[24], 16);
+        ntlmssp_SetField(&auth->NtChallengeResponse, token, &offset, NULL, 16 + bloblen);
+    } else {
+        // Without a password, log in as a guest.
+        ntlmssp_SetField(&auth->LmChallengeResponse, token, &offset, NULL, 0);
+        ntlmssp_SetField(&auth->NtChallengeResponse, token, &offset, NULL, 0);
+    }
+    if (flags & NTLMSSP_NEGOTIATE_UNICODE) {
+        ntlmssp_SetField(&auth->DomainName, token, &offset, name, asciiToUtf16(name, specs->PrimaryDomainServerName));
+        ntlmssp_SetField(&auth->UserName, token, &offset, name, asciiToUtf16(name, specs->Username));
+    } else {
+        ntlmssp_SetField(&auth->DomainName, token, &offset, specs->PrimaryDomainServerName, strlen(specs->PrimaryDomainServerName));
+        ntlmssp_SetField(&auth->UserName, token, &offset, specs->Username, strlen(specs->Username));
+    }
+    auth->Workstation.Offset = offset;
+    auth->EncryptedRandomSessionKey.Offset = offset;
+
+    return (smb2_SessionSetup(token, offset) == STATUS_SUCCESS) ? 1 : -1000;
+}
+
+int smb2_NegotiateProtocol(server_specs_t *specs, OplSmbPwHashFunc_t hash_callback)
+{
+    SMB2NegotiateRequest_t *NR = &SMB2_buf.smb2.negotiateRequest;
+    SMB2NegotiateResponse_t *NRsp = &SMB2_buf.smb2.negotiateResponse;
+
+    // The server replied to the SMB1 request with message 0, granting one credit.
+    MessageId = 1;
+    Credits = 1;
+    SessionId = 0;
+    TreeId = 0;
+    LargeMTU = 0;
+    MessageLeft = 0;
+
+    memset(NR, 0, sizeof(SMB2NegotiateRequest_t));
+    smb2_SetHeader(&NR->smb2H, SMB2_NEGOTIATE, 0);
+    NR->StructureSize = 36;
+    NR->DialectCount = 2;
+    NR->SecurityMode = SMB2_NEGOTIATE_SIGNING_ENABLED;
+    memcpy(NR->ClientGuid, "PlayStation 2\0\0", 16);
+    NR->Dialects[0] = SMB2_DIALECT_202;
+    NR->Dialects[1] = SMB2_DIALECT_210;
+
+    if (smb2_Transact(sizeof(SMB2NegotiateRequest_t), sizeof(SMB2NegotiateResponse_t)) != STATUS_SUCCESS)
+        return -1;
+
+    // Signing is not supported.
+    if (NRsp->SecurityMode & SMB2_NEGOTIATE_SIGNING_REQUIRED)
+        return -1;
+
+    ServerTime = NRsp->SystemTime;
+    LargeMTU = (NRsp->DialectRevision >= SMB2_DIALECT_210) && (NRsp->Capabilities & SMB2_GLOBAL_CAP_LARGE_MTU);
+    MaxReadSize = LargeMTU ? SMB2_MAX_READ_SIZE : SMB2_CREDIT_SIZE;
+    if (NRsp->MaxReadSize < MaxReadSize)
+        MaxReadSize = NRsp->MaxReadSize;
+    MaxWriteSize = SMB2_MAX_WRITE_SIZE;
+    if (NRsp->MaxWriteSize < MaxWriteSize)
+        MaxWriteSize = NRsp->MaxWriteSize;
+
+    return smb2_Login(specs, hash_callback);
+}
+
+//-------------------------------------------------------------------------
+int smb2_TreeConnect(char *ShareName)
+{
+    SMB2TreeConnectRequest_t *TCR = &SMB2_buf.smb2.treeConnectRequest;
+    int length;
+
+    memset(TCR, 0, sizeof(SMB2TreeConnectRequest_t));
+    smb2_SetHeader(&TCR->smb2H, SMB2_TREE_CONNECT, 0);
+    TCR->StructureSize = 9;
+    TCR->PathOffset = sizeof(SMB2TreeConnectRequest_t);
+    length = asciiToUtf16(TCR->Buffer, ShareName);
+    TCR->PathLength = length;
+
+    if (smb2_Transact(sizeof(SMB2TreeConnectRequest_t) + length, sizeof(SMB2Header_t)) != STATUS_SUCCESS)
+        return -1000;
+
+    // keep TreeId
+    TreeId = SMB2_buf.smb2.smb2H.TreeId;
+
+    return 1;
+}
+
+//-------------------------------------------------------------------------
+// Builds a CREATE request for the pending file at the start of the buffer. Returns its size, aligned for compounding.
+static int smb2_SetCreate(void)
+{
+    SMB2CreateRequest_t *CR = &SMB2_buf.smb2.createRequest;
+    const char *name;
+    int length;
+
+    memset(CR, 0, sizeof(SMB2CreateRequest_t));
+    smb2_SetHeader(&CR->smb2H, SMB2_CREATE, 0);
+    CR->StructureSize = 57;
+    CR->ImpersonationLevel = SMB2_IMPERSONATION_IMPERSONATION;
+    CR->DesiredAccess = files[PendingFID].write ? (SMB2_GENERIC_READ | SMB2_GENERIC_WRITE) : SMB2_GENERIC_READ;
+    CR->ShareAccess = SMB2_FILE_SHARE_READ | SMB2_FILE_SHARE_WRITE;
+    CR->CreateDisposition = SMB2_FILE_OPEN;
+    CR->CreateOptions = SMB2_FILE_NON_DIRECTORY_FILE;
+    CR->NameOffset = sizeof(SMB2CreateRequest_t);
+
+    // SMB2 paths are relative to the share.
+    for (name = PendingName; *name == '\\'; name++)
+        ;
+    length = asciiToUtf16(CR->Buffer, name);
+    CR->NameLength = length;
+    if (length == 0)
+        CR->Buffer[length++] = '\0'; // The buffer cannot be empty.
+
+    return (sizeof(SMB2CreateRequest_t) + length + 7) & ~7;
+}
+
+// Completes the CREATE of the pending file, from its response in SMB2_buf.
+static int smb2_EndCreate(void)
+{
+    SMB2CreateResponse_t *CRsp = &SMB2_buf.smb2.createResponse;
+    struct smb2_file *file = &files[PendingFID];
+
+    PendingFID = -1;
+    if (CRsp->smb2H.Status != STATUS_SUCCESS) {
+        file->state = SMB2_HANDLE_ERROR;
+        return -EIO;
+    }
+
+    file->FileId[0] = CRsp->FileId[0];
+    file->FileId[1] = CRsp->FileId[1];
+    file->state = SMB2_HANDLE_OPEN;
+    return 0;
+}
+
+// Opens the pending file, without reading from it.
+static int smb2_Create(void)
+{
+    if (PendingFID < 0)
+        return 0;
+
+    if (smb2_Transact(smb2_SetCreate(), sizeof(SMB2CreateResponse_t)) == -2) {
+        files[PendingFID].state = SMB2_HANDLE_ERROR;
+        PendingFID = -1;
+        return -2;
+    }
+
+    return smb2_EndCreate();
+}
+
+int smb2_Open(char *filename, u16 *FID, int Write)
+{
+    int i;
+
+    // Only one file is waiting to be opened at a time.
+    if (smb2_Create() == -2)
+        return -1;
+
+    for (i = 0; i < SMB2_MAX_FILES; i++) {
+        if (files[i].state == SMB2_HANDLE_FREE)
+            break;
+    }
+    if (i == SMB2_MAX_FILES)
+        return -1;
+
+    // The CREATE will be sent along with the first READ, which saves a round trip.
+    strncpy(PendingName, filename, sizeof(PendingName));
+    PendingName[sizeof(PendingName) - 1] = '\0';
+    files[i].state = SMB2_HANDLE_PENDING;
+    files[i].write = Write;
+    PendingFID = i;
+    *FID = i;
+
+    return 1;
+}
+
+int smb2_Close(int FID)
+{
+    SMB2CloseRequest_t *CR = &SMB2_buf.smb2.closeRequest;
+    struct smb2_file *file;
+    int r;
+
+    if (FID < 0 || FID >= SMB2_MAX_FILES)
+        return -EIO;
+    file = &files[FID];
+
+    if (PendingFID == FID)
+        PendingFID = -1;
+
+    r = 0;
+    if (file->state == SMB2_HANDLE_OPEN) {
+        memset(CR, 0, sizeof(SMB2CloseRequest_t));
+        smb2_SetHeader(&CR->smb2H, SMB2_CLOSE, 0);
+        CR->StructureSize = 24;
+        CR->FileId[0] = file->FileId[0];
+        CR->FileId[1] = file->FileId[1];
+
+        if (smb2_Transact(sizeof(SMB2CloseRequest_t), sizeof(SMB2Header_t)) != STATUS_SUCCESS)
+            r = -EIO;
+    }
+    file->state = SMB2_HANDLE_FREE;
+
+    return r;
+}
+
+//-------------------------------------------------------------------------
+// Builds a READ request at the specified position within the buffer. A FileId of NULL refers to the file of the previous (compounded) request.
+static int smb2_SetRead(int pos, const u64 *FileId, u64 offset, int nbytes)
+{
+    SMB2ReadRequest_t *RR = (SMB2ReadRequest_t *)&SMB2_buf.smb2.u8buff[pos];
+
+    memset(RR, 0, sizeof(SMB2ReadRequest_t));
+    smb2_SetHeader(&RR->smb2H, SMB2_READ, nbytes);
+    RR->StructureSize = 49;
+    RR->Padding = sizeof(SMB2ReadResponse_t);
+    RR->Length = nbytes;
+    RR->Offset = offset;
+    if (FileId != NULL) {
+        RR->FileId[0] = FileId[0];
+        RR->FileId[1] = FileId[1];
+    } else {
+        RR->smb2H.Flags = SMB2_FLAGS_RELATED_OPERATION;
+        RR->FileId[0] = ~0ull;
+        RR->FileId[1] = ~0ull;
+    }
+
+    return sizeof(SMB2ReadRequest_t);
+}
+
+/* Receives the reply to one of the outstanding READ requests, directly into its part of the buffer.
+   Replies that do not match an outstanding request are dropped. Returns NULL if the connection failed. */
+static struct smb2_read_request *smb2_RecvRead(struct smb2_read_request *requests, u8 *readbuf)
+{
+    SMB2ReadResponse_t RRsp;
+    struct smb2_read_request *req;
+    int padding, i;
+
+    do {
+        if (smb2_RecvHeader(&RRsp.smb2H) < 0)
+            return NULL;
+
+        for (i = 0, req = NULL; i < SMB2_MAX_PENDING_READS; i++) {
+            if (requests[i].pending && requests[i].MessageId == RRsp.smb2H.MessageId) {
+                req = &requests[i];
+                break;
+            }
+        }
+        if (req == NULL && smb2_SkipResponse() < 0)
+            return NULL;
+    } while (req == NULL);
+    req->pending = 0;
+
+    if (RRsp.smb2H.Status != STATUS_SUCCESS || ResponseLeft < sizeof(RRsp) - SMB2_HDR_SIZE) {
+        // Reading beyond the end of the file, or an error.
+        req->result = RRsp.smb2H.Status == STATUS_END_OF_FILE ? 0 : -EIO;
+        return smb2_SkipResponse() == 0 ? req : NULL;
+    }
+
+    if (smb2_RecvBody(&RRsp.StructureSize, sizeof(RRsp) - SMB2_HDR_SIZE) < 0)
+        return NULL;
+
+    padding = RRsp.DataOffset - sizeof(SMB2ReadResponse_t);
+    if (RRsp.DataLength > req->nbytes || padding < 0 || padding + RRsp.DataLength > ResponseLeft) {
+        // The reply does not fit the request.
+        req->result = -EIO;
+        return smb2_SkipResponse() == 0 ? req : NULL;
+    }
+
+    //Skip any padding bytes.
+    if (padding > 0 && smb2_Skip(padding) < 0)
+        return NULL;
+
+    if (RRsp.DataLength > 0 && smb2_RecvBody(&readbuf[req->pos], RRsp.DataLength) < 0)
+        return NULL;
+
+    req->result = RRsp.DataLength;
+    return smb2_SkipResponse() == 0 ? req : NULL;
+}
+
+int smb2_ReadFile(u16 FID, u64 offset, void *readbuf, int nbytes)
+{
+    struct smb2_read_request requests[SMB2_MAX_PENDING_READS], *req;
+    struct smb2_file *file;
+    int result, sent, resume, pending, toRead, size, charge, i;
+
+    if (FID >= SMB2_MAX_FILES || (file = &files[FID])->state == SMB2_HANDLE_FREE || file->state == SMB2_HANDLE_ERROR)
+        return -EIO;
+
+    // If another file is waiting to be opened, it cannot be compounded with this read.
+    if (PendingFID >= 0 && PendingFID != FID && smb2_Create() == -2)
+        return -2;
+
+    // Without a credit for the compounded READ, the CREATE is sent on its own.
+    if (file->state == SMB2_HANDLE_PENDING && Credits < 2) {
+        if (smb2_Create() == -2)
+            return -2;
+        if (file->state != SMB2_HANDLE_OPEN)
+            return -EIO;
+    }
+
+    memset(requests, 0, sizeof(requests));
+
+    result = nbytes;
+    sent = 0;
+    resume = nbytes; // Where to continue from, after a short read.
+    pending = 0;
+    while (sent < nbytes || pending > 0) {
+        // Keep the server busy, by sending the next requests before the replies to the previous ones arrive.
+        while (pending < SMB2_MAX_PENDING_READS && sent < nbytes) {
+            // Only send what the credits held allow. A deferred CREATE is compounded with the READ, and takes a credit of its own.
+            charge = file->state == SMB2_HANDLE_PENDING ? 1 : 0;
+            if (Credits <= charge)
+                break;
+
+            for (i = 0; requests[i].pending; i++)
+                ;
+            req = &requests[i];
+
+            toRead = nbytes - sent > MaxReadSize ? MaxReadSize : nbytes - sent;
+            if (LargeMTU && toRead > (Credits - charge) * SMB2_CREDIT_SIZE)
+                toRead = (Credits - charge) * SMB2_CREDIT_SIZE;
+
+            if (file->state == SMB2_HANDLE_PENDING) {
+                // Open the file and read from it, with a single compounded request.
+                size = smb2_SetCreate();
+                SMB2_buf.smb2.smb2H.NextCommand = size;
+                req->MessageId = MessageId;
+                size += smb2_SetRead(size, NULL, offset + sent, toRead);
+            } else {
+                req->MessageId = MessageId;
+                size = smb2_SetRead(0, file->FileId, offset + sent, toRead);
+            }
+            req->pending = 1;
+            req->pos = sent;
+            req->nbytes = toRead;
+
+            if (smb2_Send(size) <= 0)
+                return -2;
+
+            if (file->state == SMB2_HANDLE_PENDING) {
+                if (smb2_RecvResponse(&SMB2_buf.smb2, sizeof(SMB2CreateResponse_t)) == -2)
+                    return -2;
+                // If the file could not be opened, the READ fails as well.
+                smb2_EndCreate();
+            }
+
+            sent += toRead;
+            pending++;
+        }
+
+        // The server did not grant a credit for the next request.
+        if (pending == 0) {
+            result = -EIO;
+            break;
+        }
+
+        if ((req = smb2_RecvRead(requests, readbuf)) == NULL)
+            return -2;
+        pending--;
+
+        if (req->result <= 0) {
+            // Wait for the other replies, to keep the connection in sync.
+            result = req->result;
+            sent = nbytes;
+        } else if (req->result < req->nbytes) {
+            // The following requests may have been sent from the wrong offsets. Once they complete, continue from the end of this one.
+            if (req->pos + req->result < resume)
+                resume = req->pos + req->result;
+            sent = nbytes;
+        }
+
+        if (pending == 0 && resume < nbytes && result > 0) {
+            sent = resume;
+            resume = nbytes;
+        }
+    }
+
+    return result;
+}
+
+//-------------------------------------------------------------------------
+int smb2_WriteFile(u16 FID, u64 offset, void *writebuf, int nbytes)
+{
+    SMB2WriteRequest_t *WR = &SMB2_buf.smb2.writeRequest;
+    SMB2WriteResponse_t *WRsp = &SMB2_buf.smb2.writeResponse;
+    struct smb2_file *file;
+    int done, toWrite;
+
+    if (FID >= SMB2_MAX_FILES || (file = &files[FID])->state == SMB2_HANDLE_FREE)
+        return -EIO;
+    if (smb2_Create() == -2)
+        return -2;
+    if (file->state != SMB2_HANDLE_OPEN)
+        return -EIO;
+
+    for (done = 0; done < nbytes; done += WRsp->Count) {
+        toWrite = nbytes - done > MaxWriteSize ? MaxWriteSize : nbytes - done;
+
+        memset(WR, 0, sizeof(SMB2WriteRequest_t));
+        smb2_SetHeader(&WR->smb2H, SMB2_WRITE, toWrite);
+        WR->StructureSize = 49;
+        WR->DataOffset = sizeof(SMB2WriteRequest_t);
+        WR->Length = toWrite;
+        WR->Offset = offset + done;
+        WR->FileId[0] = file->FileId[0];
+        WR->FileId[1] = file->FileId[1];
+
+        //Send the headers, followed by the payload.
+        nb_SetSessionMessage(sizeof(SMB2WriteRequest_t) + toWrite);
+        if (SendData(main_socket, (char *)&SMB2_buf, sizeof(SMB2WriteRequest_t) + 4) <= 0 ||
+            SendData(main_socket, (char *)writebuf + done, toWrite) <= 0) {
+            smb2_Fail();
+            return -EIO;
+        }
+
+        if (smb2_RecvResponse(WRsp, sizeof(SMB2WriteResponse_t)) != STATUS_SUCCESS || WRsp->Count == 0)
+            return -EIO;
+    }
+
+    return nbytes;
+}
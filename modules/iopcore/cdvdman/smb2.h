@@ -0,0 +1,307 @@
+/*
+  Copyright 2026, Open PS2 Loader contributors
+  Licenced under Academic Free License version 3.0
+  Review Open PS2 Loader README & LICENSE files for further details.
+*/
+
+#ifndef __SMB2_H__
+#define __SMB2_H__
+
+#define SMB2_MAGIC 0x424d53fe
+
+// SMB2 Headers are always 64 bytes long
+#define SMB2_HDR_SIZE 64
+
+// Dialects
+#define SMB2_DIALECT_202      0x0202
+#define SMB2_DIALECT_210      0x0210
+#define SMB2_DIALECT_WILDCARD 0x02ff
+
+// Header flags
+#define SMB2_FLAGS_SERVER_TO_REDIR   0x00000001
+#define SMB2_FLAGS_ASYNC_COMMAND     0x00000002
+#define SMB2_FLAGS_RELATED_OPERATION 0x00000004
+#define SMB2_FLAGS_SIGNED            0x00000008
+
+// Commands
+#define SMB2_NEGOTIATE       0x0000
+#define SMB2_SESSION_SETUP   0x0001
+#define SMB2_LOGOFF          0x0002
+#define SMB2_TREE_CONNECT    0x0003
+#define SMB2_TREE_DISCONNECT 0x0004
+#define SMB2_CREATE          0x0005
+#define SMB2_CLOSE           0x0006
+#define SMB2_READ            0x0008
+#define SMB2_WRITE           0x0009
+
+// Negotiate security modes
+#define SMB2_NEGOTIATE_SIGNING_ENABLED  0x0001
+#define SMB2_NEGOTIATE_SIGNING_REQUIRED 0x0002
+
+// Capabilities
+#define SMB2_GLOBAL_CAP_DFS       0x00000001
+#define SMB2_GLOBAL_CAP_LEASING   0x00000002
+#define SMB2_GLOBAL_CAP_LARGE_MTU 0x00000004
+
+// Create
+#define SMB2_IMPERSONATION_IMPERSONATION 0x00000002
+#define SMB2_FILE_SHARE_READ             0x00000001
+#define SMB2_FILE_SHARE_WRITE            0x00000002
+#define SMB2_FILE_OPEN                   0x00000001
+#define SMB2_FILE_NON_DIRECTORY_FILE     0x00000040
+#define SMB2_GENERIC_READ                0x80000000
+#define SMB2_GENERIC_WRITE               0x40000000
+
+// NT Status
+#define STATUS_PENDING                  0x00000103
+#define STATUS_END_OF_FILE              0xc0000011
+#define STATUS_MORE_PROCESSING_REQUIRED 0xc0000016
+
+// NTLMSSP
+#define NTLMSSP_NEGOTIATE_UNICODE     0x00000001
+#define NTLMSSP_NEGOTIATE_OEM         0x00000002
+#define NTLMSSP_REQUEST_TARGET        0x00000004
+#define NTLMSSP_NEGOTIATE_NTLM        0x00000200
+#define NTLMSSP_NEGOTIATE_ALWAYS_SIGN 0x00008000
+#define NTLMSSP_NEGOTIATE_MESSAGE     1
+#define NTLMSSP_CHALLENGE_MESSAGE     2
+#define NTLMSSP_AUTHENTICATE_MESSAGE  3
+#define NTLMSSP_AV_TIMESTAMP          7
+
+typedef struct
+{
+    u32 ProtocolId;
+    u16 StructureSize;
+    u16 CreditCharge;
+    u32 Status;
+    u16 Command;
+    u16 Credits; // CreditRequest or CreditResponse
+    u32 Flags;
+    u32 NextCommand;
+    u64 MessageId;
+    u32 ProcessId;
+    u32 TreeId;
+    u64 SessionId;
+    u8 Signature[16];
+} __attribute__((packed)) SMB2Header_t;
+
+typedef struct
+{
+    SMB2Header_t smb2H;
+    u16 StructureSize; // 36
+    u16 DialectCount;
+    u16 SecurityMode;
+    u16 Reserved;
+    u32 Capabilities;
+    u8 ClientGuid[16];
+    u64 ClientStartTime;
+    u16 Dialects[2];
+} __attribute__((packed)) SMB2NegotiateRequest_t;
+
+typedef struct
+{
+    SMB2Header_t smb2H;
+    u16 StructureSize; // 65
+    u16 SecurityMode;
+    u16 DialectRevision;
+    u16 Reserved;
+    u8 ServerGuid[16];
+    u32 Capabilities;
+    u32 MaxTransactSize;
+    u32 MaxReadSize;
+    u32 MaxWriteSize;
+    u64 SystemTime;
+    u64 ServerStartTime;
+    u16 SecurityBufferOffset;
+    u16 SecurityBufferLength;
+    u32 Reserved2;
+} __attribute__((packed)) SMB2NegotiateResponse_t;
+
+typedef struct
+{
+    SMB2Header_t smb2H;
+    u16 StructureSize; // 25
+    u8 Flags;
+    u8 SecurityMode;
+    u32 Capabilities;
+    u32 Channel;
+    u16 SecurityBufferOffset;
+    u16 SecurityBufferLength;
+    u64 PreviousSessionId;
+    u8 Buffer[0];
+} __attribute__((packed)) SMB2SessionSetupRequest_t;
+
+typedef struct
+{
+    SMB2Header_t smb2H;
+    u16 StructureSize; // 9
+    u16 SessionFlags;
+    u16 SecurityBufferOffset;
+    u16 SecurityBufferLength;
+} __attribute__((packed)) SMB2SessionSetupResponse_t;
+
+typedef struct
+{
+    SMB2Header_t smb2H;
+    u16 StructureSize; // 9
+    u16 Flags;
+    u16 PathOffset;
+    u16 PathLength;
+    u8 Buffer[0];
+} __attribute__((packed)) SMB2TreeConnectRequest_t;
+
+typedef struct
+{
+    SMB2Header_t smb2H;
+    u16 StructureSize; // 57
+    u8 SecurityFlags;
+    u8 RequestedOplockLevel;
+    u32 ImpersonationLevel;
+    u64 SmbCreateFlags;
+    u64 Reserved;
+    u32 DesiredAccess;
+    u32 FileAttributes;
+    u32 ShareAccess;
+    u32 CreateDisposition;
+    u32 CreateOptions;
+    u16 NameOffset;
+    u16 NameLength;
+    u32 CreateContextsOffset;
+    u32 CreateContextsLength;
+    u8 Buffer[0];
+} __attribute__((packed)) SMB2CreateRequest_t;
+
+typedef struct
+{
+    SMB2Header_t smb2H;
+    u16 StructureSize; // 89
+    u8 OplockLevel;
+    u8 Flags;
+    u32 CreateAction;
+    u64 CreationTime;
+    u64 LastAccessTime;
+    u64 LastWriteTime;
+    u64 ChangeTime;
+    u64 AllocationSize;
+    u64 EndofFile;
+    u32 FileAttributes;
+    u32 Reserved2;
+    u64 FileId[2];
+    u32 CreateContextsOffset;
+    u32 CreateContextsLength;
+} __attribute__((packed)) SMB2CreateResponse_t;
+
+typedef struct
+{
+    SMB2Header_t smb2H;
+    u16 StructureSize; // 24
+    u16 Flags;
+    u32 Reserved;
+    u64 FileId[2];
+} __attribute__((packed)) SMB2CloseRequest_t;
+
+typedef struct
+{
+    SMB2Header_t smb2H;
+    u16 StructureSize; // 49
+    u8 Padding;
+    u8 Flags;
+    u32 Length;
+    u64 Offset;
+    u64 FileId[2];
+    u32 MinimumCount;
+    u32 Channel;
+    u32 RemainingBytes;
+    u16 ReadChannelInfoOffset;
+    u16 ReadChannelInfoLength;
+    u8 Buffer[1];
+} __attribute__((packed)) SMB2ReadRequest_t;
+
+typedef struct
+{
+    SMB2Header_t smb2H;
+    u16 StructureSize; // 17
+    u8 DataOffset;
+    u8 Reserved;
+    u32 DataLength;
+    u32 DataRemaining;
+    u32 Reserved2;
+} __attribute__((packed)) SMB2ReadResponse_t;
+
+typedef struct
+{
+    SMB2Header_t smb2H;
+    u16 StructureSize; // 49
+    u16 DataOffset;
+    u32 Length;
+    u64 Offset;
+    u64 FileId[2];
+    u32 Channel;
+    u32 RemainingBytes;
+    u16 WriteChannelInfoOffset;
+    u16 WriteChannelInfoLength;
+    u32 Flags;
+} __attribute__((packed)) SMB2WriteRequest_t;
+
+typedef struct
+{
+    SMB2Header_t smb2H;
+    u16 StructureSize; // 17
+    u16 Reserved;
+    u32 Count;
+    u32 Remaining;
+    u16 WriteChannelInfoOffset;
+    u16 WriteChannelInfoLength;
+} __attribute__((packed)) SMB2WriteResponse_t;
+
+// The length and offset of a field in a NTLMSSP message.
+typedef struct
+{
+    u16 Length;
+    u16 MaxLength;
+    u32 Offset;
+} __attribute__((packed)) NTLMSSPField_t;
+
+typedef struct
+{
+    char Signature[8];
+    u32 MessageType;
+    u32 NegotiateFlags;
+    NTLMSSPField_t DomainName;
+    NTLMSSPField_t Workstation;
+} __attribute__((packed)) NTLMSSPNegotiate_t;
+
+typedef struct
+{
+    char Signature[8];
+    u32 MessageType;
+    NTLMSSPField_t TargetName;
+    u32 NegotiateFlags;
+    u8 ServerChallenge[8];
+    u8 Reserved[8];
+    NTLMSSPField_t TargetInfo;
+} __attribute__((packed)) NTLMSSPChallenge_t;
+
+typedef struct
+{
+    char Signature[8];
+    u32 MessageType;
+    NTLMSSPField_t LmChallengeResponse;
+    NTLMSSPField_t NtChallengeResponse;
+    NTLMSSPField_t DomainName;
+    NTLMSSPField_t UserName;
+    NTLMSSPField_t Workstation;
+    NTLMSSPField_t EncryptedRandomSessionKey;
+    u32 NegotiateFlags;
+    u8 Payload[0];
+} __attribute__((packed)) NTLMSSPAuthenticate_t;
+
+// function prototypes
+int smb2_NegotiateProtocol(server_specs_t *specs, OplSmbPwHashFunc_t hash_callback); // continues a SMB1 Negotiate Protocol, which the server answered with SMB2
+int smb2_TreeConnect(char *ShareName);
+int smb2_Open(char *filename, u16 *FID, int Write);
+int smb2_Close(int FID);
+int smb2_ReadFile(u16 FID, u64 offset, void *readbuf, int nbytes);
+int smb2_WriteFile(u16 FID, u64 offset, void *writebuf, int nbytes);
+
+#endif
@@ -6,6 +6,23 @@
 
 #include "internal.h"
 
+#ifdef STREAM_BANKS
+/*  Bank-based engine: the state of the banks is tracked with bitmaps, as in SCEI's design.
+    Several free banks are refilled with a single read, and statistics are kept for CIOCSTREAMSTAT. */
+#define STREAM_MAX_BANKS    32 // Bits in StFilled
+#define STREAM_REFILL_BANKS 4  // Most banks read at once
+
+static struct cdvdman_stream_stats st_stats;
+
+static u32 StGetTicks(void)
+{
+    iop_sys_clock_t clock;
+
+    GetSystemTime(&clock);
+    return clock.lo;
+}
+#endif
+
 static int AllocBank(void **pointer);
 static int ReadSectors(int maxcount, void *buffer);
 static int StFillStreamBuffer(void);
@@ -19,17 +36,35 @@ static unsigned int StmScheduleCb(void *arg)
 static void StmCallback(void)
 {
     int OldState;
+    unsigned short int sectors;
 
     // Only update parameters if the streaming system was reading. Otherwise, this callback might have been triggered by the game reading data (BUG!)
     if (cdvdman_stat.StreamingData.StIsReading) {
         CpuSuspendIntr(&OldState);
-        cdvdman_stat.StreamingData.Stlsn += cdvdman_stat.StreamingData.StBanksize;
-        cdvdman_stat.StreamingData.StStreamed += cdvdman_stat.StreamingData.StBanksize;
-        cdvdman_stat.StreamingData.StWritePtr += cdvdman_stat.StreamingData.StBanksize;
+#ifdef STREAM_BANKS
+        sectors = cdvdman_stat.StreamingData.StReadingCount * cdvdman_stat.StreamingData.StBanksize;
+        cdvdman_stat.StreamingData.StFilled |= cdvdman_stat.StreamingData.StReading;
+        cdvdman_stat.StreamingData.StReading = 0;
+#else
+        sectors = cdvdman_stat.StreamingData.StBanksize;
+#endif
+        cdvdman_stat.StreamingData.Stlsn += sectors;
+        cdvdman_stat.StreamingData.StStreamed += sectors;
+        cdvdman_stat.StreamingData.StWritePtr += sectors;
         if (cdvdman_stat.StreamingData.StWritePtr >= cdvdman_stat.StreamingData.StBufmax)
             cdvdman_stat.StreamingData.StWritePtr = 0;
         cdvdman_stat.StreamingData.StIsReading = 0;
         CpuResumeIntr(OldState);
+
+#ifdef STREAM_BANKS
+        u32 latency = StGetTicks() - cdvdman_stat.StreamingData.StRefillStart;
+
+        st_stats.refills++;
+        st_stats.banks_read += cdvdman_stat.StreamingData.StReadingCount;
+        st_stats.latency_avg = (st_stats.refills == 1) ? latency : (st_stats.latency_avg * 3 + latency) / 4;
+        if (latency > st_stats.latency_max)
+            st_stats.latency_max = latency;
+#endif
     }
 
     DPRINTF("StmCallback: %08lx, wr: %u, rd: %u, streamed: %u\n", cdvdman_stat.StreamingData.Stlsn, cdvdman_stat.StreamingData.StWritePtr, cdvdman_stat.StreamingData.StReadPtr, cdvdman_stat.StreamingData.StStreamed);
@@ -43,16 +78,44 @@ static void StReset(void)
     cdvdman_stat.StreamingData.StReadPtr = 0;
     cdvdman_stat.StreamingData.StStreamed = 0;
     cdvdman_stat.StreamingData.StIsReading = 0;
+#ifdef STREAM_BANKS
+    cdvdman_stat.StreamingData.StFilled = 0;
+    cdvdman_stat.StreamingData.StReading = 0;
+    cdvdman_stat.StreamingData.StReadBank = 0;
+#endif
 }
 
+#ifdef STREAM_BANKS
+// Must be called from an interrupt-disabled state, after StReadPtr was advanced. Frees the banks that were read.
+static void StReleaseBanks(void)
+{
+    unsigned char bank = cdvdman_stat.StreamingData.StReadPtr / cdvdman_stat.StreamingData.StBanksize;
+
+    // Once emptied, the read pointer may be back in the bank that it started from.
+    if (cdvdman_stat.StreamingData.StStreamed == 0) {
+        cdvdman_stat.StreamingData.StFilled = 0;
+        cdvdman_stat.StreamingData.StReadBank = bank;
+        return;
+    }
+
+    while (cdvdman_stat.StreamingData.StReadBank != bank) {
+        cdvdman_stat.StreamingData.StFilled &= ~(1 << cdvdman_stat.StreamingData.StReadBank);
+        if (++cdvdman_stat.StreamingData.StReadBank >= cdvdman_stat.StreamingData.StBankmax)
+            cdvdman_stat.StreamingData.StReadBank = 0;
+    }
+}
+#endif
+
 // 0 = OK. <0 = error in sceCdRead. >0 = full buffer.
 static int StFillStreamBuffer(void)
 {
     int result, OldState;
+    unsigned short int sectors;
     void *ptr;
 
     /* SCEI used a similar design, but their implementation uses a bitmap to mark the filled/empty banks instead
-    (which is probably immune to race conditions, but we are interested in saving memory).	*/
+    (which is probably immune to race conditions, but we are interested in saving memory).
+    Building with STREAM_BANKS selects such an engine. */
     CpuSuspendIntr(&OldState);
 
     if (cdvdman_stat.StreamingData.StIsReading) {
@@ -69,9 +132,18 @@ static int StFillStreamBuffer(void)
     CpuResumeIntr(OldState);
 
     if (result == 0) {
-        // iDPRINTF("Stream fill buffer: Stream lsn 0x%08x - %u sectors:%p\n", cdvdman_stat.StreamingData.Stlsn, cdvdman_stat.StreamingData.StBanksize, ptr);
-        if (cdvdman_AsyncRead(cdvdman_stat.StreamingData.Stlsn, cdvdman_stat.StreamingData.StBanksize, 2048, ptr) == 0) {
+#ifdef STREAM_BANKS
+        sectors = cdvdman_stat.StreamingData.StReadingCount * cdvdman_stat.StreamingData.StBanksize;
+        cdvdman_stat.StreamingData.StRefillStart = StGetTicks();
+#else
+        sectors = cdvdman_stat.StreamingData.StBanksize;
+#endif
+        // iDPRINTF("Stream fill buffer: Stream lsn 0x%08x - %u sectors:%p\n", cdvdman_stat.StreamingData.Stlsn, sectors, ptr);
+        if (cdvdman_AsyncRead(cdvdman_stat.StreamingData.Stlsn, sectors, 2048, ptr) == 0) {
             // Failed to start reading.
+#ifdef STREAM_BANKS
+            cdvdman_stat.StreamingData.StReading = 0;
+#endif
             cdvdman_stat.StreamingData.StIsReading = 0;
             result = -1;
         } else {
@@ -108,6 +180,10 @@ int sceCdStInit(u32 bufmax, u32 bankmax, void *iop_bufaddr)
     CancelAlarm(&StmScheduleCb, &cdvdman_stat.StreamingData);
 
     CpuSuspendIntr(&OldState);
+#ifdef STREAM_BANKS
+    if (bankmax > STREAM_MAX_BANKS)
+        bankmax = STREAM_MAX_BANKS;
+#endif
     cdvdman_stat.StreamingData.StBankmax = bankmax;
     cdvdman_stat.StreamingData.StBanksize = bufmax / bankmax;
     cdvdman_stat.StreamingData.StBufmax = cdvdman_stat.StreamingData.StBanksize * cdvdman_stat.StreamingData.StBankmax;
@@ -121,6 +197,32 @@ int sceCdStInit(u32 bufmax, u32 bankmax, void *iop_bufaddr)
     return 1;
 }
 
+#ifdef STREAM_BANKS
+// Must be called from an interrupt-disabled state. Marks the free banks that follow the filled ones as being read, up to the end of the buffer.
+static int AllocBank(void **pointer)
+{
+    unsigned char bank, count, max;
+
+    bank = cdvdman_stat.StreamingData.StWritePtr / cdvdman_stat.StreamingData.StBanksize;
+    // If the buffer is empty, the game may be waiting: return the first bank as soon as possible.
+    max = (cdvdman_stat.StreamingData.StStreamed == 0) ? 1 : STREAM_REFILL_BANKS;
+    for (count = 0; count < max && bank + count < cdvdman_stat.StreamingData.StBankmax; count++) {
+        if (cdvdman_stat.StreamingData.StFilled & (1 << (bank + count)))
+            break;
+        cdvdman_stat.StreamingData.StReading |= 1 << (bank + count);
+    }
+
+    if (count == 0) {
+        *pointer = NULL;
+        return -ENOMEM;
+    }
+
+    cdvdman_stat.StreamingData.StReadingCount = count;
+    *pointer = cdvdman_stat.StreamingData.StIOP_bufaddr + cdvdman_stat.StreamingData.StWritePtr * 2048;
+
+    return 0;
+}
+#else
 // Must be called from an interrupt-disabled state.
 static int AllocBank(void **pointer)
 {
@@ -138,6 +240,7 @@ static int AllocBank(void **pointer)
 
     return result;
 }
+#endif
 
 static int ReadSectorsEE(int maxcount, void *buffer)
 {
@@ -207,6 +310,9 @@ static int ReadSectorsEE(int maxcount, void *buffer)
         CpuSuspendIntr(&OldState);
         cdvdman_stat.StreamingData.StReadPtr = rdptr;
         cdvdman_stat.StreamingData.StStreamed -= result;
+#ifdef STREAM_BANKS
+        StReleaseBanks();
+#endif
         CpuResumeIntr(OldState);
     }
 
@@ -255,6 +361,10 @@ static int ReadSectors(int maxcount, void *buffer)
         }
     }
 
+#ifdef STREAM_BANKS
+    if (result > 0)
+        StReleaseBanks();
+#endif
     CpuResumeIntr(OldState);
 
     return result;
@@ -273,6 +383,10 @@ int sceCdStStart(u32 lsn, sceCdRMode *mode)
     cdvdman_stat.StreamingData.Stlsn = lsn;
     cdvdman_stat.StreamingData.StStat = 1;
     StReset();
+#ifdef STREAM_BANKS
+    memset(&st_stats, 0, sizeof(st_stats));
+    st_stats.occupancy_min = 0xFFFF;
+#endif
     SetStm0Callback(&StmCallback);
     CpuResumeIntr(OldState);
 
@@ -332,6 +446,9 @@ int sceCdStPause(void)
         // Pause.
         SetStm0Callback(NULL);
         cdvdman_stat.StreamingData.StIsReading = 0;
+#ifdef STREAM_BANKS
+        cdvdman_stat.StreamingData.StReading = 0;
+#endif
         CpuResumeIntr(OldState);
 
         sceCdSync(0);
@@ -381,6 +498,10 @@ int sceCdStRead(u32 sectors, u32 *buffer, u32 mode, u32 *error)
 {
     int SectorsRead, SectorsToRead, result;
     void *ptr;
+#ifdef READ_TRACE
+    u32 trace_start = cdvdman_trace_ticks();
+    u32 trace_lsn = cdvdman_stat.StreamingData.Stlsn - cdvdman_stat.StreamingData.StStreamed;
+#endif
 
     DPRINTF("StRead called: sectors %lu:%p, mode: %lu, stat: %u,%u\n", sectors, buffer, mode, cdvdman_stat.StreamingData.StStat, cdvdman_stat.StreamingData.StIsReading);
 
@@ -391,6 +512,11 @@ int sceCdStRead(u32 sectors, u32 *buffer, u32 mode, u32 *error)
             WaitEventFlag(cdvdman_stat.intr_ef, 8, WEF_AND, NULL);
             ClearEventFlag(cdvdman_stat.intr_ef, ~8);
 
+#ifdef STREAM_BANKS
+            if (cdvdman_stat.StreamingData.StStreamed < st_stats.occupancy_min)
+                st_stats.occupancy_min = cdvdman_stat.StreamingData.StStreamed;
+#endif
+
             //		DPRINTF("Sectors: %u:%p, mode: %lu", SectorsToRead, ptr, mode);
             if ((u32)buffer & 0x80000000)
                 SectorsRead = ReadSectorsEE(SectorsToRead, ptr);
@@ -400,6 +526,10 @@ int sceCdStRead(u32 sectors, u32 *buffer, u32 mode, u32 *error)
 
             if (SectorsRead == 0)
                 DPRINTF("StRead: buffer underrun. %u/%lu read.\n", result, sectors);
+#ifdef STREAM_BANKS
+            if (SectorsRead < SectorsToRead)
+                st_stats.underruns++;
+#endif
 
             result += SectorsRead;
             // if(mode == STMNBLK) break;
@@ -408,6 +538,10 @@ int sceCdStRead(u32 sectors, u32 *buffer, u32 mode, u32 *error)
         }
         *error = sceCdGetError();
 
+#ifdef READ_TRACE
+        cdvdman_trace_record(trace_start, trace_lsn, result, 2048, buffer, CDVDMAN_TRACE_STREAD | (*error != SCECdErNO ? CDVDMAN_TRACE_ERROR : 0));
+#endif
+
         StStartFillStreamBuffer();
     } else {
         result = 0;
@@ -415,3 +549,17 @@ int sceCdStRead(u32 sectors, u32 *buffer, u32 mode, u32 *error)
 
     return result;
 }
+
+#ifdef STREAM_BANKS
+void cdvdman_stream_getstat(struct cdvdman_stream_stats *stats)
+{
+    int OldState;
+
+    CpuSuspendIntr(&OldState);
+    memcpy(stats, &st_stats, sizeof(st_stats));
+    stats->occupancy = cdvdman_stat.StreamingData.StStreamed;
+    stats->banks = cdvdman_stat.StreamingData.StBankmax;
+    stats->banksize = cdvdman_stat.StreamingData.StBanksize;
+    CpuResumeIntr(OldState);
+}
+#endif
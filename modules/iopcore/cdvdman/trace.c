@@ -0,0 +1,74 @@
+/*
+  Copyright 2026, Open PS2 Loader contributors
+  Licenced under Academic Free License version 3.0
+  Review Open PS2 Loader README & LICENSE files for further details.
+*/
+
+#include "internal.h"
+
+/*
+  Read trace.
+  The last CDVDMAN_TRACE_EVENTS reads are kept in a ring, to be retrieved with the CDIOC_OPL_TRACE devctl
+  and turned into latency histograms and seek maps by pc/cdvdtrace.
+*/
+
+static struct cdvdman_read_event trace_ring[CDVDMAN_TRACE_EVENTS];
+static u32 trace_next; // Number of the next event. The ring holds the events before it.
+
+u32 cdvdman_trace_ticks(void)
+{
+    iop_sys_clock_t clock;
+
+    GetSystemTime(&clock);
+    return clock.lo;
+}
+
+void cdvdman_trace_record(u32 start, u32 lsn, u32 sectors, u16 sector_size, const void *buf, u8 flags)
+{
+    struct cdvdman_read_event *ev;
+    u32 now = cdvdman_trace_ticks();
+    int OldState;
+
+    CpuSuspendIntr(&OldState);
+    ev = &trace_ring[trace_next++ % CDVDMAN_TRACE_EVENTS];
+    ev->time = start;
+    ev->latency = now - start;
+    ev->lsn = lsn;
+    ev->sectors = sectors;
+    ev->sector_size = sector_size;
+    ev->flags = flags;
+    ev->align = (u32)buf & 0xFF;
+    ev->reserved = 0;
+    CpuResumeIntr(OldState);
+}
+
+int cdvdman_trace_get(u32 first, struct cdvdman_trace *trace, u32 size)
+{
+    u32 count, i;
+    int OldState;
+
+    if (size < sizeof(struct cdvdman_trace))
+        return -EINVAL;
+
+    CpuSuspendIntr(&OldState);
+
+    // Events that were overwritten are skipped.
+    if (trace_next - first > CDVDMAN_TRACE_EVENTS)
+        first = trace_next > CDVDMAN_TRACE_EVENTS ? trace_next - CDVDMAN_TRACE_EVENTS : 0;
+    if (first > trace_next)
+        first = trace_next;
+
+    count = trace_next - first;
+    if (count > (size - sizeof(struct cdvdman_trace)) / sizeof(struct cdvdman_read_event))
+        count = (size - sizeof(struct cdvdman_trace)) / sizeof(struct cdvdman_read_event);
+
+    trace->next = trace_next;
+    trace->first = first;
+    trace->count = count;
+    for (i = 0; i < count; i++)
+        trace->events[i] = trace_ring[(first + i) % CDVDMAN_TRACE_EVENTS];
+
+    CpuResumeIntr(OldState);
+
+    return count;
+}
@@ -61,13 +61,13 @@ struct cdvdman_settings_smb
     };
 } __attribute__((packed));
 
-#define BDM_MAX_FILES 1  // ISO
-#define BDM_MAX_FRAGS 64 // 64 * 8bytes = 512bytes
+#define BDM_MAX_FILES    1   // ISO
+#define BDM_FRAGMAP_SIZE 512 // Encoded fragment map, see fragmap.h. Typically holds 150-250 fragments.
 
 struct cdvdman_fragfile
 {
-    u8 frag_start; /// First fragment in the fragment table
-    u8 frag_count; /// Munber of fragments in the fragment table
+    u16 map_start;  /// Offset of the file's fragments in the fragment map
+    u16 frag_count; /// Number of fragments
 } __attribute__((packed));
 
 struct cdvdman_settings_bdm
@@ -84,8 +84,8 @@ struct cdvdman_settings_bdm
     // Indicates the supported LBA size of the HDD (1 for LBA48, 0 for LBA28).
     u32 hddIsLBA48;
 
-    // Fragment table, containing the fragments of all files
-    bd_fragment_t frags[BDM_MAX_FRAGS];
+    // Fragment map, containing the fragments of all files
+    u8 fragmap[BDM_FRAGMAP_SIZE];
 } __attribute__((packed));
 
 #define CDVDMAN_SETTINGS_DEFAULT_COMMON                    \
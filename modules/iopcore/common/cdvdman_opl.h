@@ -60,6 +60,74 @@ enum CDIOC_CODE {
     CDIOC_INIT,
 
     CDIOC_GETINTREVENTFLG = CDIOC_FNUM(0x91),
+
+    CDIOC_OPL_RASTAT = CDIOC_FNUM(0xA0), // Get the read-ahead statistics (struct cdvdman_readahead_stats).
+    CDIOC_OPL_TRACE,                     // Get events from the read trace (struct cdvdman_trace). Takes the number of the first event wanted (u32).
+    CDIOC_OPL_SEARCHSTAT,                // Get the file lookup cache statistics (struct cdvdman_search_stats).
+};
+
+struct cdvdman_readahead_stats
+{
+    u32 hits;       // Sectors served from the read-ahead buffer.
+    u32 misses;     // Sectors read from the device by the game.
+    u32 prefetched; // Sectors read ahead.
+    u32 wasted;     // Sectors read ahead, but discarded before being used.
+    u32 underruns;  // Sequential reads that had to wait for the device.
+    u16 window;     // Current prefetch window, in sectors.
+    u16 size;       // Read-ahead buffer size, in sectors. 0 if not allocated.
+};
+
+struct cdvdman_search_stats
+{
+    u32 path_hits;   // sceCdSearchFile() and cdrom0: lookups answered from the path cache.
+    u32 path_misses; // Lookups that had to walk the directories.
+    u32 dir_hits;    // Directory sectors found in the cache by these walks.
+    u32 dir_misses;  // Directory sectors read from the disc.
+};
+
+// Read trace, kept by CDVDMAN if it was built with READ_TRACE=1: a ring of the last CDVDMAN_TRACE_EVENTS reads.
+#define CDVDMAN_TRACE_EVENTS 256
+
+#define CDVDMAN_TRACE_HIT     0x01 // All sectors came from the read-ahead buffer.
+#define CDVDMAN_TRACE_PARTIAL 0x02 // Some sectors came from the read-ahead buffer.
+#define CDVDMAN_TRACE_STREAM  0x04 // Read made to fill the streaming buffer.
+#define CDVDMAN_TRACE_STREAD  0x08 // sceCdStRead(): sectors taken from the streaming buffer by the game.
+#define CDVDMAN_TRACE_ERROR   0x10 // The read failed.
+
+struct cdvdman_read_event
+{
+    u32 time;        // Start of the read, in IOP clock ticks (36.864MHz).
+    u32 latency;     // Duration of the read, in IOP clock ticks.
+    u32 lsn;
+    u16 sectors;
+    u16 sector_size;
+    u8 flags;        // CDVDMAN_TRACE_*
+    u8 align;        // Low 8 bits of the buffer address.
+    u16 reserved;
+};
+
+// Returned by CDIOC_OPL_TRACE: as many events as fit into the buffer, from the one requested (or the oldest one still held).
+struct cdvdman_trace
+{
+    u32 next;  // Number of the next event to be recorded.
+    u32 first; // Number of events[0].
+    u32 count; // Number of events returned.
+    struct cdvdman_read_event events[0];
+};
+
+// Returned by the CIOCSTREAMSTAT ioctl2 of cdrom0 in the buffer provided, if CDVDMAN was built with STREAM_BANKS=1.
+// Times are in IOP clock ticks (36.864MHz). The counters are reset by sceCdStStart().
+struct cdvdman_stream_stats
+{
+    u32 refills;       // Device reads made to refill the buffer.
+    u32 banks_read;    // Banks filled by these reads.
+    u32 underruns;     // Times sceCdStRead() found too few sectors in the buffer (and had to wait, in blocking mode).
+    u32 latency_avg;   // Recent average duration of a refill.
+    u32 latency_max;   // Longest refill.
+    u16 occupancy;     // Sectors in the buffer.
+    u16 occupancy_min; // Fewest sectors found in the buffer by sceCdStRead().
+    u16 banks;         // Number of banks.
+    u16 banksize;      // Bank size, in sectors.
 };
 
 // DMA/reading alignment correction buffer. Used by CDVDMAN and CDVDFSV.
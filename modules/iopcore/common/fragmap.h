@@ -0,0 +1,40 @@
+#ifndef __FRAGMAP_H__
+#define __FRAGMAP_H__
+
+#include <tamtypes.h>
+#include <usbhdfsd-common.h>
+
+/*
+  Compact fragment map, stored in the patch zone of the BDM CDVDMAN module.
+  A file's fragments are encoded as:
+    u8 unit shift: all sector numbers and counts below are in units of (1 << shift) device sectors
+    for each fragment:
+      varint: length of the fragment, in units
+      zigzag varint: distance from the end of the previous fragment (or from sector 0) to its start, in units
+  Varints hold 7 bits per byte, least significant first, with bit 7 set if more bytes follow.
+  As files are allocated in clusters and their fragments tend to be close to each other,
+  most fragments take 2 to 4 bytes, instead of the 8 of a bd_fragment_t.
+*/
+
+// Decoded fragment: the first sector of the fragment within the file, and on the device.
+struct fragmap_extent
+{
+    u32 file_sector;
+    u32 dev_sector;
+};
+
+struct fragmap
+{
+    struct fragmap_extent *extents; // count + 1 entries. The last one holds the size of the file.
+    u32 count;
+    u32 cursor; // Extent of the last lookup
+};
+
+// Encodes the fragments into map. Returns the size of the encoded map, or -1 if it does not fit.
+int fragmap_encode(u8 *map, unsigned int size, const bd_fragment_t *frags, unsigned int count);
+// Decodes count fragments into extents, which must have room for count + 1 entries. Returns 0, or -1 if the map is invalid.
+int fragmap_decode(struct fragmap *fm, struct fragmap_extent *extents, const u8 *map, unsigned int size, unsigned int count);
+// Returns the device sector of the file sector, and the number of contiguous sectors that follow it in *run (0 if beyond the end of the file).
+u32 fragmap_lookup(struct fragmap *fm, u32 sector, u32 *run);
+
+#endif
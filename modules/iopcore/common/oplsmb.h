@@ -11,12 +11,14 @@ typedef struct
     u32 Capabilities;
     u16 MaxMpxCount;
     u8 SecurityMode; // 0 = share level, 1 = user level
-    u8 PasswordType; // 0 = PlainText passwords, 1 = use challenge/response
+    u8 PasswordType; // 0 = PlainText passwords, 1 = use challenge/response, 2 = use NTLMv2 challenge/response
     char Username[36];
     char Password[48]; // either PlainText, either hashed
     int PasswordLen;
     int HashedFlag;
     void *IOPaddr;
+    u8 *Blob; // NTLMv2 only: the blob which the response is computed over. The client challenge is at offset 16.
+    int BlobLen;
 } server_specs_t;
 
 typedef void (*OplSmbPwHashFunc_t)(server_specs_t *ss);
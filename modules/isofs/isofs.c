@@ -159,10 +159,15 @@ void *ziso_alloc(u32 size)
     return AllocSysMemory(0, size, NULL);
 }
 
-int read_raw_data(u8 *addr, u32 size, u32 offset, u32 shift)
+void ziso_free(void *ptr)
 {
-    u32 lba = offset / (2048 >> shift);  // avoid overflow by shifting sector size instead of offset
-    u32 pos = (offset << shift) & 2047;  // doesn't matter if it overflows since we only care about the 11 LSB anyways
+    FreeSysMemory(ptr);
+}
+
+int read_raw_data(u8 *addr, u32 size, u64 offset)
+{
+    u32 lba = offset >> 11;
+    u32 pos = (u32)offset & 2047;
     longLseek(MountPoint.fd, lba);       // seek to sector
     lseek(MountPoint.fd, pos, SEEK_CUR); // seek within sector
     return read(MountPoint.fd, addr, size);
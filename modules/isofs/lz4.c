@@ -375,7 +375,7 @@ FORCE_INLINE int LZ4_decompress_generic(
 )
 {
     /* Local Variables */
-    const BYTE *restrict ip = (const BYTE *)source;
+    const BYTE *ip = (const BYTE *)source; /* not restrict: the ZSO reader decodes blocks in place */
     const BYTE *ref;
     const BYTE *const iend = ip + inputSize;
 
@@ -504,4 +504,9 @@ int LZ4_decompress_fast(const char *source, char *dest, int outputSize)
 #else
     return LZ4_decompress_generic(source, dest, 0, outputSize, endOnOutputSize, withPrefix, full, 0);
 #endif
-}
\ No newline at end of file
+}
+
+int LZ4_decompress_safe_partial(const char *source, char *dest, int inputSize, int targetOutputSize, int maxOutputSize)
+{
+    return LZ4_decompress_generic(source, dest, inputSize, maxOutputSize, endOnInputSize, noPrefix, partial, targetOutputSize);
+}
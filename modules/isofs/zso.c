@@ -6,45 +6,392 @@
 #endif
 
 // block offset cache, reduces IO access
-u32 *ziso_idx_cache = NULL;
-int ziso_idx_start_block = -1;
+struct ziso_idx_page
+{
+    u32 page; // page number, or -1 if unused
+    u32 age;  // LRU counter value when last used
+    u32 *entries;
+};
+
+static struct ziso_idx_page ziso_idx_pages[ZISO_IDX_PAGES];
+static u32 ziso_idx_clock;
+static u32 ziso_idx_shift; // log2 of the number of words per index entry
+
+// whole index, if it was small enough to be loaded by ziso_init()
+u32 ziso_idx_full_max = 0;
+static u32 *ziso_idx_full = NULL;
+static u32 ziso_idx_full_size = 0; // allocated size, kept for the next images
+static u8 ziso_idx_full_loaded = 0;
+
+// background reads, if the frontend supports them
+u8 *(*ziso_read_async)(u8 *buf, u32 bufsize, u32 size, u64 offset) = NULL;
+int (*ziso_read_wait)(void) = NULL;
 
 // header data that we need for the reader
 u32 ziso_align;
 u32 ziso_total_block;
+u32 ziso_block_shift;
+static u32 ziso_block_count;
+static u8 ziso_ver;
 
 // block buffers
 u8 *ziso_tmp_buf = NULL;
 
+// decoded block cache, used for blocks larger than a sector and for shared blocks
+struct ziso_blk
+{
+    u64 offset; // position of the block's data in the image, or -1 if unused
+    u32 age;    // LRU counter value when last used
+    u8 *data;
+};
+
+static struct ziso_blk ziso_blks[ZISO_BLK_CACHE_MAX];
+static u32 ziso_blk_count = 0;
+static u32 ziso_blk_clock;
+static u32 ziso_blk_size; // size of each buffer, with room for decoding in place
+static u8 *ziso_blk_mem = NULL;
+static u32 ziso_blk_mem_size = 0; // allocated size, kept for the next images
+
+// location of a block's data
+struct ziso_block
+{
+    u64 offset;
+    u32 size; // including padding, if any
+    u8 raw;
+    u8 shared; // also used by other blocks
+};
+
 void ziso_init(ZISO_header *header, u32 first_block)
 {
     // read header information
-    ziso_align = header->align;
-    ziso_idx_start_block = -1;
-    // calculate number of blocks without using 64bit division library
+    ziso_ver = header->ver;
+    // v2 index entries hold byte offsets, so alignment is not used
+    ziso_align = (ziso_ver < 2) ? header->align : 0;
+    ziso_idx_shift = (ziso_ver < 2) ? 0 : 1;
+    // calculate number of sectors without using 64bit division library
     u32 *total_bytes_p = (u32 *)&(header->total_bytes);
     ziso_total_block = (total_bytes_p[0] >> 11) | ((total_bytes_p[1] & 0x7ff) << 21);
+    // blocks may hold several sectors
+    ziso_block_shift = 0;
+    while ((2048 << ziso_block_shift) < header->block_size && ziso_block_shift < ZISO_MAX_BLOCK_SHIFT)
+        ziso_block_shift++;
+    if ((2048 << ziso_block_shift) != header->block_size || ziso_ver > 2)
+        ziso_total_block = 0; // unsupported image, fail all reads
+    ziso_block_count = (ziso_total_block + (1 << ziso_block_shift) - 1) >> ziso_block_shift;
     // allocate memory
     if (ziso_tmp_buf == NULL) {
-        ziso_tmp_buf = ziso_alloc(2048 + sizeof(u32) * ZISO_IDX_MAX_ENTRIES + 64);
+        ziso_tmp_buf = ziso_alloc(2048 + sizeof(u32) * (ZISO_IDX_PAGE_ENTRIES + 1) * ZISO_IDX_PAGES + 64);
         if ((u32)ziso_tmp_buf & 63) // align 64
             ziso_tmp_buf = (void *)(((u32)ziso_tmp_buf & (~63)) + 64);
         if (ziso_tmp_buf) {
-            ziso_idx_cache = (u32 *)(ziso_tmp_buf + 2048);
+            for (int i = 0; i < ZISO_IDX_PAGES; i++)
+                ziso_idx_pages[i].entries = (u32 *)(ziso_tmp_buf + 2048) + i * (ZISO_IDX_PAGE_ENTRIES + 1);
+        }
+    }
+
+    // blocks larger than a sector and shared blocks are decoded into the block cache.
+    // blocks are decoded in place, so each buffer also has room for the margin and the alignment padding
+    ziso_blk_count = 0;
+    if (ziso_block_shift > 0 || ziso_ver >= 2) {
+        u32 count = ZISO_BLK_CACHE_SIZE >> (ziso_block_shift + 11);
+        if (count == 0)
+            count = 1;
+        if (count > ZISO_BLK_CACHE_MAX)
+            count = ZISO_BLK_CACHE_MAX;
+        ziso_blk_size = ((2048 << ziso_block_shift) + ZISO_INPLACE_MARGIN(2048 << ziso_block_shift) + (1 << ziso_align) + 63) & ~63;
+        if (count * ziso_blk_size > ziso_blk_mem_size) {
+            if (ziso_blk_mem != NULL)
+                ziso_free(ziso_blk_mem);
+            ziso_blk_mem = ziso_alloc(count * ziso_blk_size);
+            ziso_blk_mem_size = (ziso_blk_mem != NULL) ? count * ziso_blk_size : 0;
+        }
+        if (ziso_blk_mem != NULL) {
+            for (u32 i = 0; i < count; i++) {
+                ziso_blks[i].offset = -1;
+                ziso_blks[i].age = 0;
+                ziso_blks[i].data = ziso_blk_mem + i * ziso_blk_size;
+            }
+            ziso_blk_count = count;
+        } else
+            ziso_total_block = 0;
+    }
+
+    // forget the index of the previous image
+    for (int i = 0; i < ZISO_IDX_PAGES; i++)
+        ziso_idx_pages[i].page = -1;
+
+    // load the whole index at once if it is small enough, reusing the buffer of the previous image if possible
+    // v1 indexes have an extra entry, which gives the size of the last block
+    u32 idx_size = (ziso_ver < 2) ? (ziso_block_count + 1) * sizeof(u32) : ziso_block_count * sizeof(u64);
+    ziso_idx_full_loaded = 0;
+    if (idx_size <= ziso_idx_full_max) {
+        if (idx_size > ziso_idx_full_size) {
+            if (ziso_idx_full != NULL)
+                ziso_free(ziso_idx_full);
+            ziso_idx_full = ziso_alloc(idx_size);
+            ziso_idx_full_size = (ziso_idx_full != NULL) ? idx_size : 0;
+        }
+        if (ziso_idx_full != NULL)
+            ziso_idx_full_loaded = (read_raw_data((u8 *)ziso_idx_full, idx_size, sizeof(ZISO_header)) == idx_size);
+    }
+}
+
+// returns the index entry of the specified block. For v1 indexes, the entry of the next block always follows it.
+static u32 *ziso_idx_get(u32 block)
+{
+    struct ziso_idx_page *page, *victim;
+    u32 n = block >> (ZISO_IDX_PAGE_SHIFT - ziso_idx_shift);
+    u32 entry = (block << ziso_idx_shift) & (ZISO_IDX_PAGE_ENTRIES - 1);
+
+    if (ziso_idx_full_loaded)
+        return &ziso_idx_full[block << ziso_idx_shift];
+
+    victim = &ziso_idx_pages[0];
+    for (int i = 0; i < ZISO_IDX_PAGES; i++) {
+        page = &ziso_idx_pages[i];
+        if (page->page == n) {
+            page->age = ++ziso_idx_clock;
+            return &page->entries[entry];
+        }
+        if (page->page == -1 || page->age < victim->age)
+            victim = page;
+    }
+
+    // load the page, including the first entry of the next page for v1 indexes
+    read_raw_data((u8 *)victim->entries, (ZISO_IDX_PAGE_ENTRIES + 1 - ziso_idx_shift) * sizeof(u32), ((u64)n << ZISO_IDX_PAGE_SHIFT) * sizeof(u32) + sizeof(ZISO_header));
+    victim->page = n;
+    victim->age = ++ziso_idx_clock;
+
+    return &victim->entries[entry];
+}
+
+static void ziso_block_info(u32 block, struct ziso_block *info)
+{
+    u32 *idx = ziso_idx_get(block);
+
+    if (ziso_ver < 2) {
+        // offset of the block, with the raw flag in the top bit. The size comes from the offset of the next block.
+        u32 b_offset = idx[0] & 0x7FFFFFFF;
+        info->offset = (u64)b_offset << ziso_align;
+        info->size = ((idx[1] & 0x7FFFFFFF) - b_offset) << ziso_align;
+        info->raw = idx[0] >> 31;
+        info->shared = 0;
+    } else {
+        // 48-bit offset, size - 1 in bits 48-61, shared flag in bit 62 and raw flag in bit 63
+        info->offset = ((u64)(idx[1] & 0xFFFF) << 32) | idx[0];
+        info->size = ((idx[1] >> 16) & 0x3FFF) + 1;
+        info->shared = (idx[1] >> 30) & 1;
+        info->raw = idx[1] >> 31;
+    }
+}
+
+// returns the block cache buffer that holds the block at the specified offset, or the least recently used one (emptied) if none.
+static struct ziso_blk *ziso_blk_get(u64 offset)
+{
+    struct ziso_blk *blk, *victim = &ziso_blks[0];
+
+    for (u32 i = 0; i < ziso_blk_count; i++) {
+        blk = &ziso_blks[i];
+        if (blk->offset == offset) {
+            blk->age = ++ziso_blk_clock;
+            return blk;
+        }
+        if (blk->age < victim->age)
+            victim = blk;
+    }
+
+    victim->offset = -1;
+    victim->age = ++ziso_blk_clock;
+    return victim;
+}
+
+// returns the specified block, decoding it into the block cache if needed. The last block of the image may be shorter.
+static u8 *ziso_block_get(u32 block, struct ziso_block *info)
+{
+    struct ziso_blk *blk = ziso_blk_get(info->offset);
+    if (blk->offset == info->offset)
+        return blk->data;
+
+    u32 size = MIN(ziso_total_block - (block << ziso_block_shift), 1 << ziso_block_shift) * 2048;
+    int r = MIN(info->size, size);
+
+    if (info->raw) {
+        if (read_raw_data(blk->data, r, info->offset) != size)
+            return NULL;
+    } else {
+        // read the compressed data to the end of the buffer, which leaves enough room to decode it in place
+        u8 *c_buff = blk->data + ziso_blk_size - r;
+        read_raw_data(c_buff, r, info->offset);
+        if (LZ4_decompress_safe_partial((char *)c_buff, (char *)blk->data, r, size, size) != size)
+            return NULL;
+    }
+    blk->offset = info->offset;
+
+    return blk->data;
+}
+
+// finds the blocks whose data follows that of the first one, to read them all at once. Returns their number.
+// shared blocks whose data is stored elsewhere don't end the run, they are taken from the block cache.
+static unsigned int ziso_find_run(u32 block, unsigned int count, u64 *o_start, u64 *o_end)
+{
+    struct ziso_block info;
+    unsigned int n;
+
+    ziso_block_info(block, &info);
+    *o_start = info.offset;
+    *o_end = info.offset + info.size;
+
+    // v1 blocks are always stored in order
+    if (ziso_ver < 2) {
+        *o_end = (u64)(ziso_idx_get(block + count - 1)[1] & 0x7FFFFFFF) << ziso_align;
+        return count;
+    }
+
+    for (n = 1; n < count; n++) {
+        ziso_block_info(block + n, &info);
+        if (info.offset == *o_end)
+            *o_end += info.size;
+        else if (!info.shared)
+            break;
+    }
+    return n;
+}
+
+// moves data to a higher address, the areas may overlap
+static void ziso_move_up(u8 *dst, const u8 *src, u32 size)
+{
+    while (size-- > 0)
+        dst[size] = src[size];
+}
+
+// decodes a run of blocks, whose compressed data (starting at o_start in the image) was read into c_buff, up to c_end.
+// Returns the number of blocks decoded.
+static unsigned int ziso_decode_run(u8 *addr, u32 block, unsigned int n, u8 *c_buff, u8 *c_end, u64 o_start)
+{
+    struct ziso_block info;
+    u32 block_bytes = 2048 << ziso_block_shift;
+    u8 *end = addr + n * block_bytes;
+    u8 *c_next;
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        ziso_block_info(block + i, &info);
+
+        // the data of shared blocks stored elsewhere isn't in the buffer
+        c_next = (info.offset != o_start) ? c_buff : c_buff + info.size;
+
+        // background reads are made in whole sectors, so the data may end before the end of the buffer.
+        // if this block would overwrite the data of the next ones, that data is moved up to the end first.
+        if (c_next < addr + block_bytes && c_next < c_end) {
+            ziso_move_up(end - (c_end - c_next), c_next, c_end - c_next);
+            c_next = end - (c_end - c_next);
+            c_end = end;
+        }
+
+        if (info.offset != o_start) {
+            // shared block, stored elsewhere
+            u8 *data = ziso_block_get(block + i, &info);
+            if (data == NULL)
+                return i;
+            memcpy(addr, data, block_bytes);
+            addr += block_bytes;
+            c_buff = c_next;
+            continue;
+        }
+        o_start += info.size;
+
+        // prevent reading more than a block (eliminates padding if any)
+        int r = MIN(info.size, block_bytes);
+
+        if (!info.raw) { // block is compressed
+            // the data of the following blocks is smaller than their sectors, which leaves a gap between this block and its compressed data.
+            // if the gap is wide enough, the block can be decoded in place, as the decoder will never catch up with its input.
+            // otherwise (usually only for the last block), it is moved out of the way first.
+            if ((int)((c_buff + r - ((1 << ziso_align) - 1)) - (addr + block_bytes)) >= ZISO_INPLACE_MARGIN(r)) {
+                if (LZ4_decompress_safe_partial((char *)c_buff, (char *)addr, r, block_bytes, block_bytes) != block_bytes)
+                    return i; // corrupted block
+            } else if (ziso_blk_count == 0) {
+                memcpy(ziso_tmp_buf, c_buff, r);
+                if (LZ4_decompress_safe_partial((char *)ziso_tmp_buf, (char *)addr, r, block_bytes, block_bytes) != block_bytes)
+                    return i;
+            } else {
+                // decode into the block cache instead, which keeps a copy for later partial reads
+                struct ziso_blk *blk = ziso_blk_get(info.offset);
+                if (blk->offset != info.offset) {
+                    if (LZ4_decompress_safe_partial((char *)c_buff, (char *)blk->data, r, block_bytes, block_bytes) != block_bytes)
+                        return i;
+                    blk->offset = info.offset;
+                }
+                memcpy(addr, blk->data, block_bytes);
+            }
+        } else if (addr != c_buff) {
+            // move block to its correct position in the buffer
+            memcpy(addr, c_buff, r);
         }
+
+        addr += block_bytes;
+        c_buff = c_next;
     }
+    return n;
 }
 
 /*
   The meat of the compressed sector reader.
   Taken from ARK-4's Inferno 2 ISO Driver.
   Tailored for OPL.
-  It's made to work with 2048 block size (matching DVD sector size) and LZ4 compression (ZSO).
+  It reads whole blocks straight into the destination buffer, with LZ4 compression (ZSO).
 */
-int ziso_read_sector(u8 *addr, u32 lsn, unsigned int count)
+static int ziso_read_blocks(u8 *addr, u32 block, unsigned int count)
 {
+    u32 block_bytes = 2048 << ziso_block_shift;
+    unsigned int done, n, next_n = 0, max = count;
+    u64 o_start, o_end, next_start = 0, next_end;
+    u8 *c_buff = NULL, *c_end, *next;
+
+    // with background reads, the blocks are read in smaller runs, so that each run is read while the previous one is decoded
+    if (ziso_read_async != NULL)
+        max = ZISO_PIPELINE_SECTORS >> ziso_block_shift;
+
+    for (done = 0; done < count;) {
+        if (c_buff == NULL) {
+            // read all compressed data to the end of provided buffer to reduce IO
+            // there should be no overflow or overrun, as long as compressed data is smaller, and it should be
+            n = ziso_find_run(block + done, MIN(count - done, max), &o_start, &o_end);
+            c_buff = addr + (n * block_bytes) - (u32)(o_end - o_start);
+            read_raw_data(c_buff, o_end - o_start, o_start);
+            c_end = c_buff + (u32)(o_end - o_start);
+        }
+
+        // start reading the next run into the end of its part of the buffer, which the current run doesn't use
+        next = NULL;
+        if (ziso_read_async != NULL && done + n < count) {
+            next_n = ziso_find_run(block + done + n, MIN(count - done - n, max), &next_start, &next_end);
+            next = ziso_read_async(addr + n * block_bytes, next_n * block_bytes, next_end - next_start, next_start);
+        }
 
-    u32 cur_block = lsn;
+        unsigned int decoded = ziso_decode_run(addr, block + done, n, c_buff, c_end, o_start);
+
+        // the next run is read again if its background read couldn't be started or failed
+        if (next != NULL && ziso_read_wait() != 0)
+            next = NULL;
+        if (decoded < n)
+            return done + decoded;
+
+        done += n;
+        addr += n * block_bytes;
+        n = next_n;
+        o_start = next_start;
+        c_buff = next;
+        c_end = next + (u32)(next_end - next_start);
+    }
+    return done;
+}
+
+int ziso_read_sector(u8 *addr, u32 lsn, unsigned int count)
+{
+    struct ziso_block info;
+    u32 block_sectors = 1 << ziso_block_shift;
+    unsigned int done, n;
 
     if (lsn >= ziso_total_block) {
         return 0; // can't seek beyond file
@@ -54,47 +401,24 @@ int ziso_read_sector(u8 *addr, u32 lsn, unsigned int count)
         count = ziso_total_block - lsn; // adjust oob reads
     }
 
-    // refresh index table if needed
-    if (ziso_idx_start_block < 0 || lsn < ziso_idx_start_block || lsn + count >= ziso_idx_start_block + ZISO_IDX_MAX_ENTRIES - 1) {
-        read_raw_data((u8 *)ziso_idx_cache, ZISO_IDX_MAX_ENTRIES * sizeof(u32), lsn * 4 + sizeof(ZISO_header), 0);
-        ziso_idx_start_block = lsn;
-    }
+    for (done = 0; done < count; done += n, lsn += n, addr += n * 2048) {
+        u32 offset = lsn & (block_sectors - 1);
 
-    u32 o_start = (ziso_idx_cache[cur_block - ziso_idx_start_block] & 0x7FFFFFFF);
-    u32 o_end = (ziso_idx_cache[cur_block + count - ziso_idx_start_block] & 0x7FFFFFFF);
-    u32 compressed_size = (o_end - o_start) << ziso_align;
-
-    // read all compressed data to the end of provided buffer to reduce IO
-    // there should be no overflow or overrun, as long as compressed data is smaller, and it should be
-    u8 *c_buff = addr + (count * 2048) - compressed_size;
-    read_raw_data(c_buff, compressed_size, o_start, ziso_align);
-
-    // process each sector
-    for (unsigned int i = 0; i < count; i++) {
-
-        // read block offset and size from cache
-        u32 b_offset = ziso_idx_cache[cur_block - ziso_idx_start_block];
-        u32 b_size = ziso_idx_cache[cur_block - ziso_idx_start_block + 1];
-        u32 topbit = b_offset & 0x80000000;         // extract top bit
-        b_offset = (b_offset & 0x7FFFFFFF);         // remove top bit
-        b_size = (b_size & 0x7FFFFFFF);             // remove top bit
-        b_size = (b_size - b_offset) << ziso_align; // calculate size of compressed block
-
-        // prevent reading more than a sector (eliminates padding if any)
-        int r = MIN(b_size, 2048);
-
-        // check top bit to determine if block is compressed or raw
-        if (topbit == 0) {                                                 // block is compressed
-            memcpy(ziso_tmp_buf, c_buff, r);                               // read compressed block into temp buffer
-            LZ4_decompress_fast((char *)ziso_tmp_buf, (char *)addr, 2048); // decompress block
+        n = count - done;
+        if (offset == 0 && n >= block_sectors) {
+            // whole blocks are decoded straight into the buffer
+            n = ziso_read_blocks(addr, lsn >> ziso_block_shift, n >> ziso_block_shift) << ziso_block_shift;
+            if (n == 0)
+                break;
         } else {
-            // move block to its correct position in the buffer
-            memcpy(addr, c_buff, r);
+            // parts of a block are copied from the block cache
+            ziso_block_info(lsn >> ziso_block_shift, &info);
+            u8 *data = ziso_block_get(lsn >> ziso_block_shift, &info);
+            if (data == NULL)
+                break;
+            n = MIN(n, block_sectors - offset);
+            memcpy(addr, data + offset * 2048, n * 2048);
         }
-
-        cur_block++;
-        addr += 2048;
-        c_buff += b_size;
     }
-    return cur_block - lsn;
+    return done;
 }
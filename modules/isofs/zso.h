@@ -8,9 +8,35 @@
 
 #define ZSO_MAGIC 0x4F53495A // ZISO
 
-// no game should request more than 256 sectors per read (512KB of data)
-// should allow us to decompress all data with only 2 IO calls at most.
-#define ZISO_IDX_MAX_ENTRIES 257
+/*
+  v1 images have one 32-bit index entry per block, plus one for the end of the data: the offset of the block
+  (shifted right by align), with bit 31 set if the block is stored uncompressed. Blocks are stored in order.
+  v2 images have one 64-bit index entry per block, without an extra entry at the end:
+    bits 0-47: offset of the block, in bytes
+    bits 48-61: size of the block - 1, in bytes
+    bit 62: set if other blocks use the same data (i.e. identical blocks are stored once)
+    bit 63: set if the block is stored uncompressed
+*/
+
+// the block index is loaded in pages of 1KB (256 v1 or 128 v2 entries), kept in a small LRU cache.
+// v1 pages also hold the offset of the next block, which gives the size of the last block.
+#define ZISO_IDX_PAGE_SHIFT   8
+#define ZISO_IDX_PAGE_ENTRIES (1 << ZISO_IDX_PAGE_SHIFT)
+#define ZISO_IDX_PAGES        4
+
+// blocks larger than a sector and shared (v2) blocks are kept decoded, in up to 4 buffers of this total size.
+#define ZISO_BLK_CACHE_SIZE 8192
+#define ZISO_BLK_CACHE_MAX  4
+
+// space needed between the end of a decoded sector and the end of its compressed block, to decode it in place.
+// the decoder's output may get ahead of its input by 1 byte per 255 literals, and it copies in 8-byte steps.
+#define ZISO_INPLACE_MARGIN(size) (((size) >> 8) + 32)
+
+// blocks may hold up to 8 sectors (16KB). Larger blocks compress better and have a smaller index.
+#define ZISO_MAX_BLOCK_SHIFT 3
+
+// with background reads, whole blocks are read in runs of about this many sectors, so that decoding overlaps with reading.
+#define ZISO_PIPELINE_SECTORS 16
 
 #define MIN(x, y) ((x < y) ? x : y)
 
@@ -27,13 +53,20 @@ typedef struct
 } ZISO_header;
 
 
-// block offset cache, reduces IO access
-extern u32 *ziso_idx_cache;
-extern int ziso_idx_start_block;
+// indexes up to this size (in bytes) are loaded whole by ziso_init(), instead of page by page.
+// 0 by default, may be set by the frontend before calling ziso_init().
+extern u32 ziso_idx_full_max;
+
+// background reads, NULL by default. May be set by the frontend, if the device can read while the data is decoded.
+// ziso_read_async() starts reading size bytes at offset into the end of buf (bufsize bytes long), and returns where the data will be,
+// or NULL if it can't. ziso_read_wait() waits for that read to complete, and returns 0 if it succeeded.
+extern u8 *(*ziso_read_async)(u8 *buf, u32 bufsize, u32 size, u64 offset);
+extern int (*ziso_read_wait)(void);
 
 // header data that we need for the reader
 extern u32 ziso_align;
-extern u32 ziso_total_block;
+extern u32 ziso_total_block; // in sectors
+extern u32 ziso_block_shift; // log2 of the number of sectors per block
 
 // temp block buffer (2048 bytes)
 extern u8 *ziso_tmp_buf;
@@ -43,6 +76,7 @@ int ziso_read_sector(u8 *buf, u32 sector, unsigned int count);
 
 // This must be implemented by isofs/cdvdman/frontend
 extern void *ziso_alloc(u32 size);
-extern int read_raw_data(u8 *addr, u32 size, u32 offset, u32 shift);
+extern void ziso_free(void *ptr);
+extern int read_raw_data(u8 *addr, u32 size, u64 offset);
 
 #endif
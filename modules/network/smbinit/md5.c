@@ -0,0 +1,120 @@
+/*
+  Copyright 2026, Open PS2 Loader contributors
+  Licenced under Academic Free License version 3.0
+  Review Open PS2 Loader README & LICENSE files for further details.
+*/
+
+/*
+ * The MD5 message digest algorithm, as per RFC-1321. Used by the NTLMv2 responses (HMAC-MD5).
+ */
+
+#include <string.h>
+
+#include "md5.h"
+
+// sines of the round number, as per RFC-1321
+static const unsigned int K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+
+// rotation amounts, for each round
+static const unsigned char S[16] = {7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21};
+
+/*
+ * MD5 basic transformation: transforms the state based on 512 bits from the input block
+ */
+static void transform(unsigned int *state, const unsigned char *block)
+{
+    unsigned int X[16], A, B, C, D, F, t;
+    int i, g;
+
+    for (i = 0; i < 16; i++)
+        X[i] = (block[i * 4 + 3] << 24) | (block[i * 4 + 2] << 16) | (block[i * 4 + 1] << 8) | block[i * 4];
+
+    A = state[0];
+    B = state[1];
+    C = state[2];
+    D = state[3];
+
+    for (i = 0; i < 64; i++) {
+        switch (i >> 4) {
+            case 0:
+                F = (B & C) | (~B & D);
+                g = i;
+                break;
+            case 1:
+                F = (D & B) | (~D & C);
+                g = (5 * i + 1) & 15;
+                break;
+            case 2:
+                F = B ^ C ^ D;
+                g = (3 * i + 5) & 15;
+                break;
+            default:
+                F = C ^ (B | ~D);
+                g = (7 * i) & 15;
+        }
+
+        t = A + F + K[i] + X[g];
+        A = D;
+        D = C;
+        C = B;
+        B += (t << S[(i >> 4) * 4 + (i & 3)]) | (t >> (32 - S[(i >> 4) * 4 + (i & 3)]));
+    }
+
+    state[0] += A;
+    state[1] += B;
+    state[2] += C;
+    state[3] += D;
+}
+
+void MD5Init(MD5_CTX *ctx)
+{
+    // initial values, as per RFC-1321
+    ctx->state[0] = 0x67452301;
+    ctx->state[1] = 0xefcdab89;
+    ctx->state[2] = 0x98badcfe;
+    ctx->state[3] = 0x10325476;
+    ctx->count = 0;
+}
+
+void MD5Update(MD5_CTX *ctx, const unsigned char *data, int len)
+{
+    int used, n;
+
+    while (len > 0) {
+        used = ctx->count & 63;
+        n = 64 - used < len ? 64 - used : len;
+        memcpy(&ctx->buffer[used], data, n);
+        ctx->count += n;
+        data += n;
+        len -= n;
+
+        if ((ctx->count & 63) == 0)
+            transform(ctx->state, ctx->buffer);
+    }
+}
+
+void MD5Final(unsigned char *digest, MD5_CTX *ctx)
+{
+    unsigned char padding[72];
+    unsigned int bits = ctx->count * 8;
+    int i, n;
+
+    // pad to 56 bytes (mod 64), then append the length in bits
+    n = ((ctx->count & 63) < 56 ? 56 : 120) - (ctx->count & 63);
+    memset(padding, 0, sizeof(padding));
+    padding[0] = 0x80;
+    for (i = 0; i < 4; i++)
+        padding[n + i] = bits >> (i * 8);
+    MD5Update(ctx, padding, n + 8);
+
+    for (i = 0; i < 16; i++)
+        digest[i] = ctx->state[i / 4] >> ((i & 3) * 8);
+}
@@ -0,0 +1,21 @@
+/*
+  Copyright 2026, Open PS2 Loader contributors
+  Licenced under Academic Free License version 3.0
+  Review Open PS2 Loader README & LICENSE files for further details.
+*/
+
+#ifndef MD5_H
+#define MD5_H
+
+typedef struct
+{
+    unsigned int state[4];
+    unsigned int count; // Length of the message, in bytes
+    unsigned char buffer[64];
+} MD5_CTX;
+
+void MD5Init(MD5_CTX *ctx);
+void MD5Update(MD5_CTX *ctx, const unsigned char *data, int len);
+void MD5Final(unsigned char *digest, MD5_CTX *ctx);
+
+#endif /* MD5 */
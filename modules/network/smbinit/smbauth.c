@@ -11,9 +11,11 @@
 #include "smbauth.h"
 #include "des.h"
 #include "md4.h"
+#include "md5.h"
 
 #define SERVER_USE_PLAINTEXT_PASSWORD 0
 #define SERVER_USE_ENCRYPTED_PASSWORD 1
+#define SERVER_USE_NTLMV2_PASSWORD    2
 
 /*
  * LM_Password_Hash: this function create a LM password hash from a given password
@@ -64,6 +66,58 @@ static unsigned char *NTLM_Password_Hash(const char *password, unsigned char *ci
     return (unsigned char *)cipher;
 }
 
+/*
+ * HMAC_MD5: this function create the HMAC-MD5 of 2 concatenated messages, with a key of up to 64 bytes
+ */
+static unsigned char *HMAC_MD5(const unsigned char *key, int keylen, const unsigned char *msg1, int len1, const unsigned char *msg2, int len2, unsigned char *cipher)
+{
+    unsigned char pad[64];
+    MD5_CTX ctx;
+    int i;
+
+    /* inner hash, of the key XORed with the inner pad & the messages */
+    memset(pad, 0x36, sizeof(pad));
+    for (i = 0; i < keylen; i++)
+        pad[i] ^= key[i];
+    MD5Init(&ctx);
+    MD5Update(&ctx, pad, sizeof(pad));
+    MD5Update(&ctx, msg1, len1);
+    MD5Update(&ctx, msg2, len2);
+    MD5Final(cipher, &ctx);
+
+    /* outer hash, of the key XORed with the outer pad & the inner hash */
+    memset(pad, 0x5c, sizeof(pad));
+    for (i = 0; i < keylen; i++)
+        pad[i] ^= key[i];
+    MD5Init(&ctx);
+    MD5Update(&ctx, pad, sizeof(pad));
+    MD5Update(&ctx, cipher, 16);
+    MD5Final(cipher, &ctx);
+
+    return (unsigned char *)cipher;
+}
+
+/*
+ * NTLMv2_Password_Hash: this function create a NTLMv2 hash from a given NTLM hash, user & domain
+ */
+static unsigned char *NTLMv2_Password_Hash(const unsigned char *NTLMpasswordhash, const char *user, const char *domain, unsigned char *cipher)
+{
+    unsigned char buf[(36 + 32) * 2];
+    int i, j;
+
+    /* the user name turned to uppercase, followed by the domain name, in unicode */
+    for (i = 0, j = 0; user[i] != '\0' && j < sizeof(buf); i++, j += 2) {
+        buf[j] = toupper(user[i]);
+        buf[j + 1] = 0;
+    }
+    for (i = 0; domain[i] != '\0' && j < sizeof(buf); i++, j += 2) {
+        buf[j] = domain[i];
+        buf[j + 1] = 0;
+    }
+
+    return HMAC_MD5(NTLMpasswordhash, 16, buf, j, NULL, 0, cipher);
+}
+
 /*
  * LM_Response: this function create a LM response from a given LM hash & challenge
  */
@@ -120,12 +174,36 @@ static void GenerateLMHashes(char *Password, int PasswordType, u8 *EncryptionKey
     }
 }
 
+/*
+ * GenerateNTLMv2Responses: function used to generate LMv2/NTLMv2 responses, to the server challenge & the blob
+ */
+static void GenerateNTLMv2Responses(server_specs_t *ss)
+{
+    u8 NTLMpasswordhash[16];
+    u8 NTLMv2passwordhash[16];
+
+    NTLM_Password_Hash(ss->Password, NTLMpasswordhash);
+    NTLMv2_Password_Hash(NTLMpasswordhash, ss->Username, ss->PrimaryDomainServerName, NTLMv2passwordhash);
+
+    /* LMv2 response: HMAC-MD5 of the server & client challenges, followed by the client challenge */
+    HMAC_MD5(NTLMv2passwordhash, 16, ss->EncryptionKey, 8, &ss->Blob[16], 8, (u8 *)&ss->Password[0]);
+    memcpy(&ss->Password[16], &ss->Blob[16], 8);
+
+    /* NTProofStr: HMAC-MD5 of the server challenge & the blob, which is sent after it as the rest of the NTLMv2 response */
+    HMAC_MD5(NTLMv2passwordhash, 16, ss->EncryptionKey, 8, ss->Blob, ss->BlobLen, (u8 *)&ss->Password[24]);
+    ss->PasswordLen = 24;
+}
+
 void SmbInitHashPassword(server_specs_t *ss)
 {
     if (ss->HashedFlag == 0) {
-        /* generate the LM and NTLM hash then fill Password buffer with both hashes */
-        if (strlen(ss->Password) > 0)
-            GenerateLMHashes(ss->Password, ss->PasswordType, ss->EncryptionKey, &ss->PasswordLen, ss->Password);
+        /* generate the LM and NTLM hash (or the NTLMv2 responses) then fill Password buffer with both */
+        if (strlen(ss->Password) > 0) {
+            if (ss->PasswordType == SERVER_USE_NTLMV2_PASSWORD)
+                GenerateNTLMv2Responses(ss);
+            else
+                GenerateLMHashes(ss->Password, ss->PasswordType, ss->EncryptionKey, &ss->PasswordLen, ss->Password);
+        }
     }
 
     /* used to notify cdvdman that password are now hashed */
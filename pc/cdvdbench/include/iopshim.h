@@ -0,0 +1,386 @@
+/*
+  Copyright 2026, Open PS2 Loader contributors
+  Licenced under Academic Free License version 3.0
+  Review Open PS2 Loader README & LICENSE files for further details.
+
+  Host-side stand-ins for the IOP kernel and PS2SDK library interfaces used by the in-game CDVDMAN.
+  Every IOP header that the CDVDMAN sources include resolves to this file when building cdvdbench.
+*/
+
+#ifndef __IOPSHIM_H__
+#define __IOPSHIM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/* The IOP memcpy() implementations (SYSCLIB and SMSUTILS) copy forwards.
+   The ZSO reader relies on this when it moves a raw block down within the same buffer.
+   Copies are counted, as they are a large part of the IOP's time spent on reads. */
+void *shim_memcpy(void *dst, const void *src, size_t n);
+#define memcpy shim_memcpy
+
+// tamtypes.h
+typedef unsigned char u8;
+typedef unsigned short u16;
+typedef unsigned int u32;
+typedef unsigned long long u64;
+typedef signed char s8;
+typedef signed short s16;
+typedef signed int s32;
+typedef signed long long s64;
+
+// The IOP has a 32-bit address space. All buffers handed to the CDVDMAN code are allocated below 2GB, so these casts are safe.
+#define PHYSADDR(a) ((uintptr_t)(a))
+
+// irx.h / loadcore.h
+struct irx_export_table
+{
+    int dummy;
+};
+
+#define IRX_ID(name, major, minor)
+#define DECLARE_IMPORT_TABLE(lib, major, minor)
+#define DECLARE_IMPORT(ord, name)
+#define END_IMPORT_TABLE
+#define MODULE_RESIDENT_END 0
+#define MODULE_NO_RESIDENT_END 1
+
+int RegisterLibraryEntries(struct irx_export_table *exports);
+void FlushDcache(void);
+void FlushIcache(void);
+
+// intrman.h
+#define IOP_IRQ_CDVD 2
+
+int CpuSuspendIntr(int *state);
+int CpuResumeIntr(int state);
+int QueryIntrContext(void);
+int RegisterIntrHandler(int irq, int mode, int (*handler)(void *), void *arg);
+int EnableIntr(int irq);
+
+// sysmem.h
+#define ALLOC_FIRST 0
+#define ALLOC_LAST  1
+
+void *AllocSysMemory(int mode, int size, void *ptr);
+int FreeSysMemory(void *ptr);
+u32 QueryTotalFreeMemSize(void);
+#define Kprintf printf
+
+// thbase.h
+typedef struct
+{
+    u32 lo, hi;
+} iop_sys_clock_t;
+
+typedef struct _iop_thread
+{
+    u32 attr;
+    u32 option;
+    void (*thread)(void *);
+    u32 stacksize;
+    u32 priority;
+} iop_thread_t;
+
+#define TH_C 0x02000000
+
+int CreateThread(iop_thread_t *thread);
+int StartThread(int thid, void *arg);
+int GetThreadId(void);
+int DelayThread(int usec);
+int SleepThread(void);
+int WakeupThread(int thid);
+int iWakeupThread(int thid);
+int SetAlarm(iop_sys_clock_t *sys_clock, unsigned int (*alarm_cb)(void *), void *arg);
+int iSetAlarm(iop_sys_clock_t *sys_clock, unsigned int (*alarm_cb)(void *), void *arg);
+int CancelAlarm(unsigned int (*alarm_cb)(void *), void *arg);
+int iCancelAlarm(unsigned int (*alarm_cb)(void *), void *arg);
+void USec2SysClock(u32 usec, iop_sys_clock_t *sys_clock);
+void SysClock2USec(iop_sys_clock_t *sys_clock, u32 *sec, u32 *usec);
+int GetSystemTime(iop_sys_clock_t *sys_clock);
+
+// thsemap.h
+typedef struct
+{
+    u32 attr;
+    u32 option;
+    int initial;
+    int max;
+} iop_sema_t;
+
+#define SA_THFIFO 0
+#define SA_THPRI  1
+
+int CreateSema(iop_sema_t *sema);
+int DeleteSema(int semid);
+int SignalSema(int semid);
+int iSignalSema(int semid);
+int WaitSema(int semid);
+int PollSema(int semid);
+
+// thevent.h
+typedef struct
+{
+    u32 attr;
+    u32 option;
+    u32 bits;
+} iop_event_t;
+
+#define EA_SINGLE 0
+#define EA_MULTI  2
+#define WEF_AND   0
+#define WEF_OR    1
+#define WEF_CLEAR 0x10
+
+int CreateEventFlag(iop_event_t *event);
+int DeleteEventFlag(int evfid);
+int SetEventFlag(int evfid, u32 bits);
+int iSetEventFlag(int evfid, u32 bits);
+int ClearEventFlag(int evfid, u32 bits);
+int iClearEventFlag(int evfid, u32 bits);
+int WaitEventFlag(int evfid, u32 bits, int mode, u32 *resbits);
+int PollEventFlag(int evfid, u32 bits, int mode, u32 *resbits);
+
+// sifman.h
+typedef struct
+{
+    void *src;
+    void *dest;
+    int size;
+    int attr;
+} SifDmaTransfer_t;
+
+int sceSifSetDma(SifDmaTransfer_t *dmat, int count);
+int sceSifDmaStat(int trid);
+
+// ioman.h / io_common.h / iox_stat.h
+#define O_RDONLY 0x0001
+#define O_WRONLY 0x0002
+#define O_RDWR   0x0003
+
+#define IOP_DT_CHAR 0x01
+#define IOP_DT_CONS 0x02
+#define IOP_DT_BLOCK 0x04
+#define IOP_DT_RAW  0x08
+#define IOP_DT_FS   0x10
+
+typedef struct _iop_file
+{
+    int mode;
+    int unit;
+    struct _iop_device *device;
+    void *privdata;
+} iop_file_t;
+
+typedef struct _iop_device
+{
+    const char *name;
+    unsigned int type;
+    unsigned int version;
+    const char *desc;
+    struct _iop_device_ops *ops;
+} iop_device_t;
+
+typedef struct _iop_device_ops
+{
+    int (*init)(iop_device_t *);
+    int (*deinit)(iop_device_t *);
+} iop_device_ops_t;
+
+typedef struct
+{
+    unsigned int mode;
+    unsigned int attr;
+    unsigned int size;
+    unsigned char ctime[8];
+    unsigned char atime[8];
+    unsigned char mtime[8];
+    unsigned int hisize;
+    unsigned int private_0;
+    unsigned int private_1;
+    unsigned int private_2;
+    unsigned int private_3;
+    unsigned int private_4;
+    unsigned int private_5;
+} iox_stat_t;
+
+typedef struct
+{
+    iox_stat_t stat;
+    char name[256];
+    void *unknown;
+} iox_dirent_t;
+
+int AddDrv(iop_device_t *device);
+int DelDrv(const char *name);
+
+// usbhdfsd-common.h
+typedef struct
+{
+    u32 sector;
+    u32 count;
+} bd_fragment_t;
+
+// cdvdman.h (libcdvd)
+typedef struct
+{
+    u8 stat;
+    u8 second;
+    u8 minute;
+    u8 hour;
+    u8 pad;
+    u8 day;
+    u8 month;
+    u8 year;
+} sceCdCLOCK;
+
+typedef struct
+{
+    u32 lsn;
+    u32 size;
+    char name[16];
+    u8 date[8];
+} sceCdlFILE;
+
+typedef struct
+{
+    u8 minute;
+    u8 second;
+    u8 sector;
+    u8 track;
+} sceCdlLOCCD;
+
+typedef struct
+{
+    u8 trycount;
+    u8 spindlctrl;
+    u8 datapattern;
+    u8 pad;
+} sceCdRMode;
+
+typedef void (*sceCdCBFunc)(int reason);
+
+enum SCECdvdSectorType {
+    SCECdSecS2048 = 0,
+    SCECdSecS2328,
+    SCECdSecS2340,
+};
+
+enum SCECdvdErrorCode {
+    SCECdErFAIL = -1,
+    SCECdErNO = 0x00,
+    SCECdErABRT,
+    SCECdErCMD = 0x10,
+    SCECdErOPENS,
+    SCECdErNODISC,
+    SCECdErNORDY,
+    SCECdErCUD,
+    SCECdErIPI = 0x20,
+    SCECdErILI,
+    SCECdErPRM,
+    SCECdErREAD = 0x30,
+    SCECdErTRMOPN,
+    SCECdErEOM,
+    SCECdErSFRMTNG = 0x38,
+    SCECdErREADCF = 0xFD,
+    SCECdErREADCFR,
+};
+
+enum SCECdvdMediaType {
+    SCECdGDTFUNCFAIL = -1,
+    SCECdNODISC = 0x00,
+    SCECdDETCT,
+    SCECdDETCTCD,
+    SCECdDETCTDVDS,
+    SCECdDETCTDVDD,
+    SCECdUNKNOWN,
+    SCECdPSCD = 0x10,
+    SCECdPSCDDA,
+    SCECdPS2CD,
+    SCECdPS2CDDA,
+    SCECdPS2DVD,
+    SCECdCDDA = 0xFD,
+    SCECdDVDV,
+    SCECdIllegalMedia,
+};
+
+enum SCECdvdDriveState {
+    SCECdStatStop = 0x00,
+    SCECdStatShellOpen = 0x01,
+    SCECdStatSpin = 0x02,
+    SCECdStatRead = 0x06,
+    SCECdStatPause = 0x0A,
+    SCECdStatSeek = 0x12,
+    SCECdStatEmg = 0x20,
+};
+
+enum SCECdvdCallbackReason {
+    SCECdFuncRead = 1,
+    SCECdFuncReadCDDA,
+    SCECdFuncGetToc,
+    SCECdFuncSeek,
+    SCECdFuncStandby,
+    SCECdFuncStop,
+    SCECdFuncPause,
+    SCECdFuncBreak,
+};
+
+enum SCECdvdTrayReqMode {
+    SCECdTrayOpen = 0,
+    SCECdTrayClose,
+    SCECdTrayCheck,
+};
+
+enum SCECdvdReadyState {
+    SCECdComplete = 0x02,
+    SCECdNotReady = 0x06,
+};
+
+int sceCdInit(int mode);
+int sceCdStandby(void);
+int sceCdRead(u32 lsn, u32 sectors, void *buf, sceCdRMode *mode);
+int sceCdSeek(u32 lsn);
+int sceCdGetError(void);
+int sceCdGetToc(u8 *toc);
+int sceCdSearchFile(sceCdlFILE *fp, const char *name);
+int sceCdSync(int mode);
+int sceCdGetDiskType(void);
+int sceCdDiskReady(int mode);
+int sceCdTrayReq(int mode, u32 *traycnt);
+int sceCdStop(void);
+u32 sceCdPosToInt(sceCdlLOCCD *p);
+sceCdlLOCCD *sceCdIntToPos(u32 i, sceCdlLOCCD *p);
+int sceCdRI(u8 *buf, u32 *stat);
+int sceCdReadClock(sceCdCLOCK *clock);
+int sceCdStatus(void);
+int sceCdApplySCmd(u8 cmd, const void *in, u16 in_size, void *out);
+sceCdCBFunc sceCdCallback(sceCdCBFunc function);
+int sceCdPause(void);
+int sceCdBreak(void);
+int sceCdReadCdda(u32 lsn, u32 sectors, void *buf, sceCdRMode *mode);
+u32 sceCdGetReadPos(void);
+void *sceGetFsvRbuf(void);
+int sceCdSC(int code, int *param);
+int sceCdStInit(u32 bufmax, u32 bankmax, void *buffer);
+int sceCdStRead(u32 sectors, u32 *buffer, u32 mode, u32 *error);
+int sceCdStSeek(u32 lsn);
+int sceCdStStart(u32 lsn, sceCdRMode *mode);
+int sceCdStStat(void);
+int sceCdStStop(void);
+int sceCdStPause(void);
+int sceCdStResume(void);
+int sceCdRM(char *m, u32 *stat);
+int sceCdReadDvdDualInfo(int *on_dual, unsigned int *layer1_start);
+int sceCdLayerSearchFile(sceCdlFILE *fp, const char *name, int layer);
+int sceCdPowerOff(u32 *stat);
+int sceCdReadGUID(u64 *GUID);
+int sceCdReadDiskID(unsigned int *DiskID);
+int sceCdReadModelID(unsigned int *ModelID);
+
+// hdd-ioctl.h / usbd.h: nothing from these is used by the files built into cdvdbench.
+
+#endif
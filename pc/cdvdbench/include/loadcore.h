@@ -0,0 +1,2 @@
+// cdvdbench: see iopshim.h
+#include "iopshim.h"
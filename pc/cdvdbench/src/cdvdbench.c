@@ -0,0 +1,394 @@
+/*
+  Copyright 2026, Open PS2 Loader contributors
+  Licenced under Academic Free License version 3.0
+  Review Open PS2 Loader README & LICENSE files for further details.
+
+  Replays sceCdRead/sceCdStRead traces against the in-game CDVDMAN read path,
+  which is built from modules/iopcore/cdvdman and backed by a local ISO/ZSO image.
+
+  Trace format, one request per line (numbers may be decimal or 0x-prefixed hex, '#' starts a comment):
+    read <lsn> <sectors> [sector size] [buffer offset]
+                                         sceCdRead() + sceCdSync(0)
+    stinit <bufmax> <bankmax>            sceCdStInit()
+    ststart <lsn>                        sceCdStStart()
+    stread <sectors>                     sceCdStRead(), blocking mode
+    ststop                               sceCdStStop()
+    sleep <usec>                         time spent by the game between requests
+    search <path> [lsn]                  sceCdSearchFile(), with the LSN expected (0 if the file must not be found)
+*/
+
+#include "cdvdbench.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cdvd_config.h"
+#include "cdvdman_opl.h"
+
+#define MAX_REQUEST_SECTORS 512
+#define STREAM_BUFFER_SIZE  (512 * 2048)
+
+// Rough cost of memcpy() on the IOP, which has no data cache: a load and a store to RAM for every word.
+#define IOP_COPY_CYCLES_PER_WORD 4
+
+extern struct cdvdman_settings_bdm cdvdman_settings;
+extern int _start(int argc, char **argv); // Renamed to cdvdman_start() by the Makefile
+extern void cdvdman_readahead_getstat(struct cdvdman_readahead_stats *stats);
+extern void cdvdman_search_getstat(struct cdvdman_search_stats *stats);
+#ifdef STREAM_BANKS
+extern void cdvdman_stream_getstat(struct cdvdman_stream_stats *stats);
+#endif
+#ifdef READ_TRACE
+extern int cdvdman_trace_get(u32 first, struct cdvdman_trace *trace, u32 size);
+#endif
+
+struct irx_export_table _exp_cdvdman, _exp_cdvdstm, _exp_smsutils, _exp_oplutils;
+
+static const char *trace_path;
+static int verify_fd = -1;
+static int verbose = 0;
+#ifdef READ_TRACE
+static FILE *trace_dump;
+static u32 trace_next;
+#endif
+
+// Results
+static u64 *latencies;
+static unsigned int latency_count, latency_max;
+static unsigned int reads, stream_reads, searches, mismatches, errors;
+static u64 sectors_read, elapsed_ns, copied;
+static struct cdvdman_readahead_stats ra_stats;
+static struct cdvdman_search_stats search_stats;
+#ifdef STREAM_BANKS
+static struct cdvdman_stream_stats st_stats;
+#endif
+
+static void printUsage(void)
+{
+    printf("%s version %s\n", PROGRAM_EXTNAME, PROGRAM_VER);
+    printf("Usage: %s [options] <image.iso|image.zso> <trace|->\n", PROGRAM_NAME);
+    printf("Options:\n");
+    printf("  -l <usec>  Simulated device latency per call (default: 0)\n");
+    printf("  -b <KB/s>  Simulated device bandwidth (default: unlimited)\n");
+    printf("  -F <n>     Scatter the image into n fragments, read through the BDM fragment map\n");
+    printf("  -c <n>     ZSO sector cache size, in sectors (default: 16)\n");
+    printf("  -a         Enable the accurate reads compatibility mode\n");
+    printf("  -C         Emulate a CD instead of a DVD\n");
+    printf("  -V <iso>   Verify the data read against an uncompressed reference image\n");
+    printf("  -v         Print every request\n");
+#ifdef READ_TRACE
+    printf("  -T <file>  Write the CDVDMAN read trace to file, for cdvdtrace\n");
+#endif
+}
+
+static void record_latency(u64 ns)
+{
+    if (latency_count == latency_max) {
+        latency_max = latency_max ? latency_max * 2 : 1024;
+        latencies = realloc(latencies, latency_max * sizeof(u64));
+    }
+    latencies[latency_count++] = ns;
+}
+
+// The user data of each sector is at offset within sector_size bytes.
+static void verify(u32 lsn, u32 sectors, const u8 *data, u32 sector_size, u32 offset)
+{
+    static u8 ref[MAX_REQUEST_SECTORS * 2048];
+    ssize_t size;
+    u32 i;
+
+    if (verify_fd < 0)
+        return;
+
+    size = pread(verify_fd, ref, sectors * 2048, (off_t)lsn * 2048);
+    for (i = 0; i < sectors; i++) {
+        if (size < (ssize_t)(i + 1) * 2048 || memcmp(&ref[i * 2048], &data[i * sector_size + offset], 2048) != 0)
+            break;
+    }
+    if (i < sectors && mismatches++ < 10)
+        fprintf(stderr, "mismatch: lsn %u, %u sectors (first bad sector: %u)\n", lsn, sectors, lsn + i);
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+    return (x > y) - (x < y);
+}
+
+static double percentile_us(double p)
+{
+    unsigned int i;
+
+    if (latency_count == 0)
+        return 0;
+
+    i = (unsigned int)(p * (latency_count - 1) + 0.5);
+    return latencies[i] / 1000.0;
+}
+
+#ifdef READ_TRACE
+// Saves the events recorded since the last call, as OPL would by polling CDIOC_OPL_TRACE.
+static void dump_trace(void)
+{
+    static u8 buf[sizeof(struct cdvdman_trace) + CDVDMAN_TRACE_EVENTS * sizeof(struct cdvdman_read_event)];
+    struct cdvdman_trace *trace = (struct cdvdman_trace *)buf;
+
+    if (trace_dump == NULL)
+        return;
+
+    cdvdman_trace_get(trace_next, trace, sizeof(buf));
+    if (trace->first != trace_next)
+        fprintf(stderr, "trace: %u events lost\n", trace->first - trace_next);
+    fwrite(trace->events, sizeof(struct cdvdman_read_event), trace->count, trace_dump);
+    trace_next = trace->first + trace->count;
+}
+#endif
+
+static void replay(void *arg)
+{
+    FILE *trace = arg;
+    char line[256], cmd[16];
+    unsigned long a, b, c, d;
+    u8 *buffer, *stbuf;
+    u32 stlsn = 0;
+    u64 start, t;
+    int n, result;
+
+    buffer = shim_alloc_low(MAX_REQUEST_SECTORS * 2352 + 64);
+    stbuf = shim_alloc_low(STREAM_BUFFER_SIZE);
+
+    _start(0, NULL);
+    sceCdInit(1);
+
+    // Don't count the volume descriptor reads done during initialization.
+    bench_device_reset_stats();
+    shim_copied = 0;
+#ifdef READ_TRACE
+    {
+        struct cdvdman_trace trace;
+
+        cdvdman_trace_get(~0, &trace, sizeof(trace));
+        trace_next = trace.next;
+    }
+#endif
+
+    start = shim_now_ns();
+    while (fgets(line, sizeof(line), trace) != NULL) {
+        char *comment = strchr(line, '#');
+        if (comment != NULL)
+            *comment = '\0';
+
+        a = b = d = 0;
+        c = 2048;
+        if ((n = sscanf(line, "%15s %li %li %li %li", cmd, &a, &b, &c, &d)) < 1)
+            continue;
+
+        if (!strcmp(cmd, "read") && n >= 3) {
+            sceCdRMode mode = {0, 0, SCECdSecS2048, 0};
+
+            if (b > MAX_REQUEST_SECTORS)
+                b = MAX_REQUEST_SECTORS;
+            d &= 63;
+            if (c == 2328)
+                mode.datapattern = SCECdSecS2328;
+            else if (c == 2340)
+                mode.datapattern = SCECdSecS2340;
+
+            t = shim_now_ns();
+            while (sceCdRead(a, b, buffer + d, &mode) == 0)
+                DelayThread(10000);
+            sceCdSync(0);
+            t = shim_now_ns() - t;
+
+            if (sceCdGetError() != SCECdErNO)
+                errors++;
+            record_latency(t);
+            reads++;
+            sectors_read += b;
+            verify(a, b, buffer + d, mode.datapattern == SCECdSecS2048 ? 2048 : c, mode.datapattern == SCECdSecS2340 ? 12 : 0);
+            if (verbose)
+                printf("read   %8lu %4lu %8.1fus\n", a, b, t / 1000.0);
+        } else if (!strcmp(cmd, "stinit") && n >= 3) {
+            if (a * 2048 > STREAM_BUFFER_SIZE)
+                a = STREAM_BUFFER_SIZE / 2048;
+            sceCdStInit(a, b, stbuf);
+        } else if (!strcmp(cmd, "ststart") && n >= 2) {
+            sceCdStStart(a, NULL);
+            stlsn = a;
+        } else if (!strcmp(cmd, "stread") && n >= 2) {
+            u32 error;
+
+            if (a > MAX_REQUEST_SECTORS)
+                a = MAX_REQUEST_SECTORS;
+
+            t = shim_now_ns();
+            result = sceCdStRead(a, (u32 *)buffer, 1, &error);
+            t = shim_now_ns() - t;
+
+            if (error != SCECdErNO || result != a)
+                errors++;
+            record_latency(t);
+            stream_reads++;
+            sectors_read += result;
+            verify(stlsn, result, buffer, 2048, 0);
+            stlsn += result;
+            if (verbose)
+                printf("stread %8u %4d %8.1fus\n", stlsn - result, result, t / 1000.0);
+        } else if (!strcmp(cmd, "search")) {
+            char path[256];
+            sceCdlFILE file;
+
+            if ((n = sscanf(line, "%*s %255s %li", path, &a)) < 1) {
+                fprintf(stderr, "bad search command: %s", line);
+                continue;
+            }
+
+            t = shim_now_ns();
+            result = sceCdSearchFile(&file, path);
+            t = shim_now_ns() - t;
+
+            // A mismatch is counted as an error, as no data was read.
+            if (n >= 2 && (result ? file.lsn : 0) != a) {
+                if (errors++ < 10)
+                    fprintf(stderr, "search: %s found at %u, expected %lu\n", path, result ? file.lsn : 0, a);
+            }
+            searches++;
+            if (verbose)
+                printf("search %s %8.1fus\n", path, t / 1000.0);
+        } else if (!strcmp(cmd, "ststop")) {
+            sceCdStStop();
+        } else if (!strcmp(cmd, "sleep") && n >= 2) {
+            DelayThread(a);
+        } else {
+            fprintf(stderr, "unknown trace command: %s", line);
+        }
+#ifdef READ_TRACE
+        dump_trace();
+#endif
+    }
+    elapsed_ns = shim_now_ns() - start;
+    copied = shim_copied;
+
+    cdvdman_readahead_getstat(&ra_stats);
+    cdvdman_search_getstat(&search_stats);
+#ifdef STREAM_BANKS
+    cdvdman_stream_getstat(&st_stats);
+#endif
+}
+
+static void printReport(void)
+{
+    unsigned int requests = reads + stream_reads;
+    double secs = elapsed_ns / 1e9;
+
+    qsort(latencies, latency_count, sizeof(u64), &compare_u64);
+
+    printf("requests:      %u (%u reads, %u stream reads)\n", requests, reads, stream_reads);
+    printf("sectors:       %llu (%.2f MiB)\n", sectors_read, sectors_read * 2048 / 1048576.0);
+    printf("elapsed:       %.3f s\n", secs);
+    printf("throughput:    %.0f sectors/s (%.0f KiB/s)\n", secs > 0 ? sectors_read / secs : 0, secs > 0 ? sectors_read * 2 / secs : 0);
+    printf("latency (us):  p50 %.1f, p90 %.1f, p99 %.1f, max %.1f\n", percentile_us(0.5), percentile_us(0.9), percentile_us(0.99), percentile_us(1.0));
+    printf("device calls:  %llu (%.2f per request), %llu sectors, %.3f s busy\n", bench_dev.calls, requests ? (double)bench_dev.calls / requests : 0, bench_dev.sectors, bench_dev.busy_ns / 1e9);
+    printf("copied:        %.2f MiB (%.0f bytes, ~%.0f IOP cycles per sector)\n", copied / 1048576.0, sectors_read ? (double)copied / sectors_read : 0,
+           sectors_read ? (double)copied / 4 * IOP_COPY_CYCLES_PER_WORD / sectors_read : 0);
+    if (ra_stats.size != 0)
+        printf("read-ahead:    %u hits, %u misses, %u prefetched, %u wasted, %u underruns, window %u/%u\n", ra_stats.hits, ra_stats.misses, ra_stats.prefetched, ra_stats.wasted, ra_stats.underruns, ra_stats.window, ra_stats.size);
+    if (searches != 0)
+        printf("searches:      %u, %u path cache hits, %u misses, %u directory sectors cached, %u read\n", searches, search_stats.path_hits, search_stats.path_misses, search_stats.dir_hits, search_stats.dir_misses);
+#ifdef STREAM_BANKS
+    if (st_stats.refills != 0)
+        printf("streaming:     %u refills, %u banks of %u/%u, %u underruns, refill %.1fus avg %.1fus max, occupancy %u min %u sectors\n", st_stats.refills, st_stats.banks_read, st_stats.banksize, st_stats.banks,
+               st_stats.underruns, st_stats.latency_avg / 36.864, st_stats.latency_max / 36.864, st_stats.occupancy, st_stats.occupancy_min);
+#endif
+    if (errors)
+        printf("errors:        %u\n", errors);
+    if (verify_fd >= 0)
+        printf("verify:        %u mismatches\n", mismatches);
+}
+
+int main(int argc, char **argv)
+{
+    struct stat st;
+    FILE *trace;
+    int opt;
+
+    // Patch zone defaults, as OPL would set them for a plain DVD image.
+    cdvdman_settings.common.NumParts = 1;
+    cdvdman_settings.common.media = SCECdPS2DVD;
+    cdvdman_settings.common.flags = 0;
+    cdvdman_settings.common.layer1_start = 0;
+    cdvdman_settings.common.zso_cache = 16;
+
+    while ((opt = getopt(argc, argv, "l:b:F:c:aCV:vT:")) != -1) {
+        switch (opt) {
+            case 'l':
+                bench_dev.latency_us = strtoul(optarg, NULL, 0);
+                break;
+            case 'b':
+                bench_dev.bandwidth_kb = strtoul(optarg, NULL, 0);
+                break;
+            case 'F':
+                bench_dev.fragments = strtoul(optarg, NULL, 0);
+                break;
+            case 'c':
+                cdvdman_settings.common.zso_cache = strtoul(optarg, NULL, 0);
+                break;
+            case 'a':
+                cdvdman_settings.common.flags |= IOPCORE_COMPAT_ACCU_READS;
+                break;
+            case 'C':
+                cdvdman_settings.common.media = SCECdPS2CD;
+                break;
+            case 'V':
+                if ((verify_fd = open(optarg, O_RDONLY)) < 0) {
+                    perror(optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'v':
+                verbose = 1;
+                break;
+#ifdef READ_TRACE
+            case 'T':
+                if ((trace_dump = fopen(optarg, "wb")) == NULL) {
+                    perror(optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+#endif
+            default:
+                printUsage();
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (argc - optind != 2) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    if ((bench_dev.fd = open(argv[optind], O_RDONLY)) < 0 || fstat(bench_dev.fd, &st) != 0) {
+        perror(argv[optind]);
+        return EXIT_FAILURE;
+    }
+    bench_dev.size = st.st_size;
+
+    trace_path = argv[optind + 1];
+    trace = strcmp(trace_path, "-") ? fopen(trace_path, "r") : stdin;
+    if (trace == NULL) {
+        perror(trace_path);
+        return EXIT_FAILURE;
+    }
+
+    shim_init();
+    shim_run(&replay, trace);
+    printReport();
+#ifdef READ_TRACE
+    if (trace_dump != NULL)
+        fclose(trace_dump);
+#endif
+
+    return (errors || mismatches) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
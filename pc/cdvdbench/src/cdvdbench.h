@@ -0,0 +1,44 @@
+/*
+  Copyright 2026, Open PS2 Loader contributors
+  Licenced under Academic Free License version 3.0
+  Review Open PS2 Loader README & LICENSE files for further details.
+*/
+
+#ifndef __CDVDBENCH_H__
+#define __CDVDBENCH_H__
+
+#include "iopshim.h"
+
+#define PROGRAM_NAME    "cdvdbench"
+#define PROGRAM_EXTNAME "CDVDMAN read path replay benchmark for Open PS2 Loader"
+#define PROGRAM_VER     "0.1.0"
+
+// iopshim.c
+void shim_init(void);
+void shim_run(void (*entry)(void *), void *arg);
+void shim_block(u64 ns);
+void *shim_alloc_low(size_t size);
+u64 shim_now_ns(void);
+
+extern u64 shim_copied; // Bytes copied with memcpy() by the IOP code
+
+// device-file.c
+struct bench_device
+{
+    int fd;
+    u64 size;
+    u32 latency_us;   // Fixed cost of every device call
+    u32 bandwidth_kb; // Transfer rate in KB/s, 0 = unlimited
+    u32 fragments;    // Number of fragments to scatter the image into, as on a BDM device. 0 = contiguous.
+
+    // Statistics
+    u64 calls;
+    u64 sectors;
+    u64 busy_ns;
+};
+
+extern struct bench_device bench_dev;
+
+void bench_device_reset_stats(void);
+
+#endif
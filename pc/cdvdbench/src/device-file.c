@@ -0,0 +1,289 @@
+/*
+  Copyright 2026, Open PS2 Loader contributors
+  Licenced under Academic Free License version 3.0
+  Review Open PS2 Loader README & LICENSE files for further details.
+
+  cdvdman "Device" backend for cdvdbench: a local ISO/ZSO file, with optional simulated latency and bandwidth.
+*/
+
+#include "cdvdbench.h"
+
+#include <unistd.h>
+
+#include "cdvd_config.h"
+#include "fragmap.h"
+
+#define FRAG_CLUSTER    64 // Device sectors per cluster (32KB)
+#define FRAG_SECTOR     512
+#define FRAG_LOOKUPS    4000000
+
+// Also declared by modules/iopcore/cdvdman/device.h
+void DeviceInit(void);
+void DeviceDeinit(void);
+int DeviceReady(void);
+void DeviceFSInit(void);
+void DeviceLock(void);
+void DeviceUnmount(void);
+void DeviceStop(void);
+int DeviceReadSectors(u64 lsn, void *buffer, unsigned int sectors);
+#ifdef DEVICE_ASYNC_READS
+int DeviceReadSectorsAsync(u64 lsn, void *buffer, unsigned int sectors);
+int DeviceReadSectorsWait(void);
+#endif
+
+struct bench_device bench_dev = {-1};
+
+extern struct cdvdman_settings_bdm cdvdman_settings;
+
+static bd_fragment_t *frags;
+static struct fragmap iso_map;
+
+#ifdef DEVICE_ASYNC_READS
+// Background reads are carried out by a device thread, as by the ATA driver. The device serves one read at a time.
+static int dev_sema, async_start_sema, async_done_sema;
+static u64 async_lsn;
+static void *async_buffer;
+static unsigned int async_sectors;
+static int async_result;
+#endif
+
+void bench_device_reset_stats(void)
+{
+    bench_dev.calls = 0;
+    bench_dev.sectors = 0;
+    bench_dev.busy_ns = 0;
+}
+
+// The lookup done by bd_defrag(), for comparison.
+static u32 frag_walk(u32 sector, u32 *run)
+{
+    unsigned int i;
+
+    for (i = 0; i < bench_dev.fragments; i++) {
+        if (sector < frags[i].count) {
+            *run = frags[i].count - sector;
+            return frags[i].sector + sector;
+        }
+        sector -= frags[i].count;
+    }
+
+    *run = 0;
+    return 0;
+}
+
+static u32 frag_random(u32 *seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return *seed >> 8;
+}
+
+static void frag_benchmark(u32 total)
+{
+    u32 seed, sector, run, sum;
+    u64 start, map_ns[2], walk_ns[2];
+    unsigned int i, pass;
+
+    // Sequential 16KB reads, then random reads.
+    for (pass = 0; pass < 2; pass++) {
+        start = shim_now_ns();
+        for (seed = 1, sector = 0, sum = 0, i = 0; i < FRAG_LOOKUPS; i++) {
+            sector = pass ? frag_random(&seed) % total : (sector + 32) % total;
+            sum += fragmap_lookup(&iso_map, sector, &run);
+        }
+        map_ns[pass] = shim_now_ns() - start;
+
+        start = shim_now_ns();
+        for (seed = 1, sector = 0, i = 0; i < FRAG_LOOKUPS; i++) {
+            sector = pass ? frag_random(&seed) % total : (sector + 32) % total;
+            sum -= frag_walk(sector, &run);
+        }
+        walk_ns[pass] = shim_now_ns() - start;
+
+        if (sum != 0) {
+            printf("fragmap: lookup mismatch\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    printf("fragmap:       %u fragments in %u bytes, lookup (ns) sequential %.1f, random %.1f; linear walk %.1f, %.1f\n",
+           bench_dev.fragments, (unsigned int)fragmap_encode(cdvdman_settings.fragmap, BDM_FRAGMAP_SIZE, frags, bench_dev.fragments),
+           (double)map_ns[0] / FRAG_LOOKUPS, (double)map_ns[1] / FRAG_LOOKUPS, (double)walk_ns[0] / FRAG_LOOKUPS, (double)walk_ns[1] / FRAG_LOOKUPS);
+}
+
+// Scatters the image into fragments of random sizes, as OPL would find them on a FAT/exFAT device.
+static void frag_init(void)
+{
+    u32 total, clusters, left, seed, dev_sector;
+    unsigned int i;
+
+    total = (bench_dev.size + FRAG_SECTOR - 1) / FRAG_SECTOR;
+    clusters = (total + FRAG_CLUSTER - 1) / FRAG_CLUSTER;
+    if (bench_dev.fragments > clusters)
+        bench_dev.fragments = clusters;
+    frags = malloc(bench_dev.fragments * sizeof(bd_fragment_t));
+
+    // Fragments usually follow each other closely, with a few that are far away.
+    for (seed = 1, left = clusters, dev_sector = 0x100000, i = 0; i < bench_dev.fragments; i++) {
+        frags[i].count = (i + 1 == bench_dev.fragments) ? left : 1 + frag_random(&seed) % (2 * left / (bench_dev.fragments - i) - 1);
+        left -= frags[i].count;
+        frags[i].count *= FRAG_CLUSTER;
+
+        if (frag_random(&seed) % 8 == 0)
+            dev_sector = (frag_random(&seed) % 0x1000000) * FRAG_CLUSTER;
+        else
+            dev_sector += (frag_random(&seed) % 64) * FRAG_CLUSTER;
+        frags[i].sector = dev_sector;
+        dev_sector += frags[i].count;
+    }
+
+    cdvdman_settings.fragfile[0].map_start = 0;
+    cdvdman_settings.fragfile[0].frag_count = bench_dev.fragments;
+    if (fragmap_encode(cdvdman_settings.fragmap, BDM_FRAGMAP_SIZE, frags, bench_dev.fragments) < 0) {
+        printf("fragmap: %u fragments do not fit into %u bytes\n", bench_dev.fragments, BDM_FRAGMAP_SIZE);
+        exit(EXIT_FAILURE);
+    }
+
+    if (fragmap_decode(&iso_map, malloc((bench_dev.fragments + 1) * sizeof(struct fragmap_extent)), cdvdman_settings.fragmap, BDM_FRAGMAP_SIZE, bench_dev.fragments) != 0) {
+        printf("fragmap: invalid map\n");
+        exit(EXIT_FAILURE);
+    }
+
+    frag_benchmark(clusters * FRAG_CLUSTER);
+}
+
+// Checks that the sectors are mapped to the same place as bd_defrag() would.
+static int frag_check(u64 lsn, unsigned int sectors)
+{
+    u32 sector, count, dev_sector, run, walk_run;
+
+    for (sector = lsn * 4, count = sectors * 4; count > 0; sector += run, count -= run) {
+        dev_sector = fragmap_lookup(&iso_map, sector, &run);
+        if (run == 0 || dev_sector != frag_walk(sector, &walk_run) || run != walk_run)
+            return 0;
+        if (run > count)
+            run = count;
+    }
+
+    return 1;
+}
+
+#ifdef DEVICE_ASYNC_READS
+static void async_thread(void *arg)
+{
+    while (1) {
+        WaitSema(async_start_sema);
+        async_result = DeviceReadSectors(async_lsn, async_buffer, async_sectors);
+        SignalSema(async_done_sema);
+    }
+}
+#endif
+
+void DeviceInit(void)
+{
+    if (bench_dev.fragments != 0)
+        frag_init();
+
+#ifdef DEVICE_ASYNC_READS
+    iop_sema_t smp;
+    iop_thread_t thread;
+
+    smp.initial = 1;
+    smp.max = 1;
+    smp.attr = 0;
+    smp.option = 0;
+    dev_sema = CreateSema(&smp);
+    smp.initial = 0;
+    async_start_sema = CreateSema(&smp);
+    async_done_sema = CreateSema(&smp);
+
+    thread.attr = TH_C;
+    thread.option = 0;
+    thread.thread = &async_thread;
+    thread.stacksize = 0x600;
+    thread.priority = 0x0e;
+    StartThread(CreateThread(&thread), NULL);
+#endif
+}
+
+void DeviceDeinit(void)
+{
+}
+
+int DeviceReady(void)
+{
+    return SCECdComplete;
+}
+
+void DeviceFSInit(void)
+{
+}
+
+void DeviceLock(void)
+{
+}
+
+void DeviceUnmount(void)
+{
+}
+
+void DeviceStop(void)
+{
+}
+
+int DeviceReadSectors(u64 lsn, void *buffer, unsigned int sectors)
+{
+    u64 start, delay;
+    ssize_t size, result;
+
+    if (bench_dev.fragments != 0 && !frag_check(lsn, sectors))
+        return SCECdErREAD;
+
+#ifdef DEVICE_ASYNC_READS
+    WaitSema(dev_sema);
+#endif
+    start = shim_now_ns();
+    size = (ssize_t)sectors * 2048;
+    result = pread(bench_dev.fd, buffer, size, (off_t)(lsn * 2048));
+    if (result <= 0) {
+#ifdef DEVICE_ASYNC_READS
+        SignalSema(dev_sema);
+#endif
+        return SCECdErREAD;
+    }
+    // The final sector of an image may be incomplete (i.e. ZSO files). Block devices would return padding.
+    if (result < size)
+        memset((u8 *)buffer + result, 0, size - result);
+
+    delay = (u64)bench_dev.latency_us * 1000;
+    if (bench_dev.bandwidth_kb != 0)
+        delay += (u64)size * 1000000000ull / ((u64)bench_dev.bandwidth_kb * 1024);
+    shim_block(delay);
+
+    bench_dev.calls++;
+    bench_dev.sectors += sectors;
+    bench_dev.busy_ns += shim_now_ns() - start;
+#ifdef DEVICE_ASYNC_READS
+    SignalSema(dev_sema);
+#endif
+
+    return SCECdErNO;
+}
+
+#ifdef DEVICE_ASYNC_READS
+int DeviceReadSectorsAsync(u64 lsn, void *buffer, unsigned int sectors)
+{
+    async_lsn = lsn;
+    async_buffer = buffer;
+    async_sectors = sectors;
+    SignalSema(async_start_sema);
+
+    return SCECdErNO;
+}
+
+int DeviceReadSectorsWait(void)
+{
+    WaitSema(async_done_sema);
+
+    return async_result;
+}
+#endif
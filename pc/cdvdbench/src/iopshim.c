@@ -0,0 +1,635 @@
+/*
+  Copyright 2026, Open PS2 Loader contributors
+  Licenced under Academic Free License version 3.0
+  Review Open PS2 Loader README & LICENSE files for further details.
+
+  Minimal IOP kernel emulation for cdvdbench.
+  The IOP has a single CPU, so only one IOP thread may run at a time. This is modelled with one
+  global lock that is held by whichever thread (or alarm handler) is currently running.
+  Blocking kernel calls release the lock while they wait, just like a context switch would.
+*/
+
+#include "cdvdbench.h"
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#define IOP_CLOCK_HZ   36864000
+#define CDVD_REGS_BASE 0xBF402000
+
+#define MAX_SEMAS  16
+#define MAX_EVENTS 8
+#define MAX_THREAD 8
+#define MAX_ALARMS 16
+
+static pthread_mutex_t giant = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeup = PTHREAD_COND_INITIALIZER;
+static __thread int in_intr = 0;
+
+struct shim_sema
+{
+    int used;
+    int count;
+    int max;
+    // Like the IOP kernel, a signal is given directly to the first waiting thread, so the signalling thread cannot take it back.
+    unsigned int tickets, granted;
+};
+
+struct shim_event
+{
+    int used;
+    u32 bits;
+};
+
+struct shim_thread
+{
+    iop_thread_t param;
+    pthread_t handle;
+    void *arg;
+    int wakeups;
+};
+
+struct shim_alarm
+{
+    int used;
+    u64 deadline; // In nanoseconds
+    unsigned int (*cb)(void *);
+    void *arg;
+};
+
+static struct shim_sema semas[MAX_SEMAS];
+static struct shim_event events[MAX_EVENTS];
+static struct shim_thread threads[MAX_THREAD];
+static int thread_count = 0;
+static __thread int cur_thread = -1;
+
+static struct shim_alarm alarms[MAX_ALARMS];
+static pthread_t alarm_thread;
+static pthread_cond_t alarm_cond;
+
+u64 shim_copied = 0;
+
+u64 shim_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void shim_enter(void)
+{
+    pthread_mutex_lock(&giant);
+}
+
+void shim_leave(void)
+{
+    pthread_mutex_unlock(&giant);
+}
+
+/* Blocking device I/O yields the CPU on the real IOP (USB, SMB and ATA all wait on semaphores or event flags),
+   so simulated device time is spent with the lock released. */
+void shim_block(u64 ns)
+{
+    struct timespec ts;
+
+    if (ns == 0)
+        return;
+
+    ts.tv_sec = ns / 1000000000ull;
+    ts.tv_nsec = ns % 1000000000ull;
+    pthread_mutex_unlock(&giant);
+    nanosleep(&ts, NULL);
+    pthread_mutex_lock(&giant);
+}
+
+// Memory handed to the IOP code must live below 2GB, as the IOP code freely casts pointers to u32.
+void *shim_alloc_low(size_t size)
+{
+    void *ptr;
+
+    ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (ptr == MAP_FAILED) {
+        fprintf(stderr, "cdvdbench: out of low memory (%zu bytes)\n", size);
+        exit(EXIT_FAILURE);
+    }
+
+    return ptr;
+}
+
+//
+// loadcore / intrman / sysmem
+//
+
+int RegisterLibraryEntries(struct irx_export_table *exports)
+{
+    return 0;
+}
+
+void FlushDcache(void)
+{
+}
+
+void FlushIcache(void)
+{
+}
+
+int CpuSuspendIntr(int *state)
+{
+    // Interrupt handlers (alarms) also take the global lock, so they cannot run while an IOP thread is running.
+    if (state != NULL)
+        *state = 0;
+    return 0;
+}
+
+int CpuResumeIntr(int state)
+{
+    return 0;
+}
+
+int QueryIntrContext(void)
+{
+    return in_intr;
+}
+
+int RegisterIntrHandler(int irq, int mode, int (*handler)(void *), void *arg)
+{
+    return 0;
+}
+
+int EnableIntr(int irq)
+{
+    return 0;
+}
+
+void *AllocSysMemory(int mode, int size, void *ptr)
+{
+    return shim_alloc_low(size);
+}
+
+int FreeSysMemory(void *ptr)
+{
+    // Not tracked; cdvdman never frees what it allocates.
+    return 0;
+}
+
+u32 QueryTotalFreeMemSize(void)
+{
+    return 2 * 1024 * 1024;
+}
+
+//
+// thbase
+//
+
+static void *shim_thread_entry(void *arg)
+{
+    struct shim_thread *th = arg;
+
+    cur_thread = th - threads;
+    pthread_mutex_lock(&giant);
+    th->param.thread(th->arg);
+    pthread_mutex_unlock(&giant);
+
+    return NULL;
+}
+
+int CreateThread(iop_thread_t *thread)
+{
+    if (thread_count >= MAX_THREAD)
+        return -1;
+
+    threads[thread_count].param = *thread;
+    return thread_count++ + 1;
+}
+
+int StartThread(int thid, void *arg)
+{
+    struct shim_thread *th = &threads[thid - 1];
+    pthread_attr_t attr;
+    size_t stacksize = 256 * 1024;
+
+    th->arg = arg;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, shim_alloc_low(stacksize), stacksize);
+    pthread_create(&th->handle, &attr, &shim_thread_entry, th);
+    pthread_attr_destroy(&attr);
+
+    return 0;
+}
+
+int GetThreadId(void)
+{
+    return cur_thread + 1;
+}
+
+int DelayThread(int usec)
+{
+    shim_block((u64)usec * 1000);
+    return 0;
+}
+
+int SleepThread(void)
+{
+    struct shim_thread *th = &threads[cur_thread];
+
+    while (th->wakeups == 0)
+        pthread_cond_wait(&wakeup, &giant);
+    th->wakeups--;
+
+    return 0;
+}
+
+int WakeupThread(int thid)
+{
+    threads[thid - 1].wakeups++;
+    pthread_cond_broadcast(&wakeup);
+    return 0;
+}
+
+int iWakeupThread(int thid)
+{
+    return WakeupThread(thid);
+}
+
+void USec2SysClock(u32 usec, iop_sys_clock_t *sys_clock)
+{
+    u64 ticks = (u64)usec * IOP_CLOCK_HZ / 1000000;
+
+    sys_clock->lo = (u32)ticks;
+    sys_clock->hi = (u32)(ticks >> 32);
+}
+
+void SysClock2USec(iop_sys_clock_t *sys_clock, u32 *sec, u32 *usec)
+{
+    u64 us = (((u64)sys_clock->hi << 32) | sys_clock->lo) * 1000000 / IOP_CLOCK_HZ;
+
+    *sec = (u32)(us / 1000000);
+    *usec = (u32)(us % 1000000);
+}
+
+int GetSystemTime(iop_sys_clock_t *sys_clock)
+{
+    u64 ticks = shim_now_ns() * (IOP_CLOCK_HZ / 1000000) / 1000;
+
+    sys_clock->lo = (u32)ticks;
+    sys_clock->hi = (u32)(ticks >> 32);
+    return 0;
+}
+
+static u64 ticks_to_ns(u64 ticks)
+{
+    return ticks * 1000 / (IOP_CLOCK_HZ / 1000000);
+}
+
+static void *shim_alarm_entry(void *arg)
+{
+    struct timespec ts;
+    u64 now, next;
+    int i, fired;
+
+    pthread_mutex_lock(&giant);
+    in_intr = 1;
+    while (1) {
+        now = shim_now_ns();
+        next = 0;
+        fired = 0;
+        for (i = 0; i < MAX_ALARMS; i++) {
+            if (!alarms[i].used)
+                continue;
+
+            if (alarms[i].deadline <= now) {
+                struct shim_alarm alarm = alarms[i];
+                iop_sys_clock_t clock;
+                unsigned int ticks;
+
+                // Like the IOP kernel, a non-zero return value re-arms the alarm with that many ticks.
+                alarms[i].used = 0;
+                if ((ticks = alarm.cb(alarm.arg)) != 0) {
+                    clock.lo = ticks;
+                    clock.hi = 0;
+                    SetAlarm(&clock, alarm.cb, alarm.arg);
+                }
+                fired = 1;
+            } else if (next == 0 || alarms[i].deadline < next)
+                next = alarms[i].deadline;
+        }
+
+        if (fired)
+            continue;
+
+        if (next == 0) {
+            pthread_cond_wait(&alarm_cond, &giant);
+        } else {
+            ts.tv_sec = next / 1000000000ull;
+            ts.tv_nsec = next % 1000000000ull;
+            pthread_cond_timedwait(&alarm_cond, &giant, &ts);
+        }
+    }
+
+    return NULL;
+}
+
+int SetAlarm(iop_sys_clock_t *sys_clock, unsigned int (*alarm_cb)(void *), void *arg)
+{
+    int i;
+
+    for (i = 0; i < MAX_ALARMS; i++) {
+        if (!alarms[i].used) {
+            alarms[i].used = 1;
+            alarms[i].deadline = shim_now_ns() + ticks_to_ns(((u64)sys_clock->hi << 32) | sys_clock->lo);
+            alarms[i].cb = alarm_cb;
+            alarms[i].arg = arg;
+            pthread_cond_signal(&alarm_cond);
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+int iSetAlarm(iop_sys_clock_t *sys_clock, unsigned int (*alarm_cb)(void *), void *arg)
+{
+    return SetAlarm(sys_clock, alarm_cb, arg);
+}
+
+int CancelAlarm(unsigned int (*alarm_cb)(void *), void *arg)
+{
+    int i;
+
+    for (i = 0; i < MAX_ALARMS; i++) {
+        if (alarms[i].used && alarms[i].cb == alarm_cb && alarms[i].arg == arg) {
+            alarms[i].used = 0;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+int iCancelAlarm(unsigned int (*alarm_cb)(void *), void *arg)
+{
+    return CancelAlarm(alarm_cb, arg);
+}
+
+//
+// thsemap
+//
+
+int CreateSema(iop_sema_t *sema)
+{
+    int i;
+
+    for (i = 0; i < MAX_SEMAS; i++) {
+        if (!semas[i].used) {
+            semas[i].used = 1;
+            semas[i].count = sema->initial;
+            semas[i].max = sema->max;
+            semas[i].tickets = 0;
+            semas[i].granted = 0;
+            return i + 1;
+        }
+    }
+
+    return -1;
+}
+
+int DeleteSema(int semid)
+{
+    semas[semid - 1].used = 0;
+    return 0;
+}
+
+int SignalSema(int semid)
+{
+    struct shim_sema *s = &semas[semid - 1];
+
+    if (s->tickets != s->granted)
+        s->granted++;
+    else if (s->count < s->max)
+        s->count++;
+    pthread_cond_broadcast(&wakeup);
+
+    return 0;
+}
+
+int iSignalSema(int semid)
+{
+    return SignalSema(semid);
+}
+
+int WaitSema(int semid)
+{
+    struct shim_sema *s = &semas[semid - 1];
+    unsigned int ticket;
+
+    if (s->count > 0) {
+        s->count--;
+        return 0;
+    }
+
+    ticket = s->tickets++;
+    while ((int)(s->granted - ticket) <= 0)
+        pthread_cond_wait(&wakeup, &giant);
+
+    return 0;
+}
+
+int PollSema(int semid)
+{
+    struct shim_sema *s = &semas[semid - 1];
+
+    if (s->count == 0)
+        return -419; // KE_SEMA_ZERO
+    s->count--;
+
+    return 0;
+}
+
+//
+// thevent
+//
+
+int CreateEventFlag(iop_event_t *event)
+{
+    int i;
+
+    for (i = 0; i < MAX_EVENTS; i++) {
+        if (!events[i].used) {
+            events[i].used = 1;
+            events[i].bits = event->bits;
+            return i + 1;
+        }
+    }
+
+    return -1;
+}
+
+int DeleteEventFlag(int evfid)
+{
+    events[evfid - 1].used = 0;
+    return 0;
+}
+
+int SetEventFlag(int evfid, u32 bits)
+{
+    events[evfid - 1].bits |= bits;
+    pthread_cond_broadcast(&wakeup);
+    return 0;
+}
+
+int iSetEventFlag(int evfid, u32 bits)
+{
+    return SetEventFlag(evfid, bits);
+}
+
+int ClearEventFlag(int evfid, u32 bits)
+{
+    events[evfid - 1].bits &= bits;
+    return 0;
+}
+
+int iClearEventFlag(int evfid, u32 bits)
+{
+    return ClearEventFlag(evfid, bits);
+}
+
+static int shim_event_match(struct shim_event *ev, u32 bits, int mode)
+{
+    return (mode & WEF_OR) ? ((ev->bits & bits) != 0) : ((ev->bits & bits) == bits);
+}
+
+int WaitEventFlag(int evfid, u32 bits, int mode, u32 *resbits)
+{
+    struct shim_event *ev = &events[evfid - 1];
+
+    while (!shim_event_match(ev, bits, mode))
+        pthread_cond_wait(&wakeup, &giant);
+
+    if (resbits != NULL)
+        *resbits = ev->bits;
+    if (mode & WEF_CLEAR)
+        ev->bits &= ~bits;
+
+    return 0;
+}
+
+int PollEventFlag(int evfid, u32 bits, int mode, u32 *resbits)
+{
+    struct shim_event *ev = &events[evfid - 1];
+
+    if (!shim_event_match(ev, bits, mode))
+        return -421; // KE_EVF_COND
+
+    if (resbits != NULL)
+        *resbits = ev->bits;
+    if (mode & WEF_CLEAR)
+        ev->bits &= ~bits;
+
+    return 0;
+}
+
+//
+// sifman: there is no EE, so "EE" transfers are plain copies that complete immediately.
+//
+
+int sceSifSetDma(SifDmaTransfer_t *dmat, int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+        memmove(dmat[i].dest, dmat[i].src, dmat[i].size);
+
+    return 1;
+}
+
+int sceSifDmaStat(int trid)
+{
+    return -1;
+}
+
+//
+// ioman
+//
+
+int AddDrv(iop_device_t *device)
+{
+    return device->ops->init(device);
+}
+
+int DelDrv(const char *name)
+{
+    return 0;
+}
+
+//
+// smsutils / ioplib_util
+//
+
+void *shim_memcpy(void *dst, const void *src, size_t n)
+{
+    shim_copied += n;
+    return memmove(dst, src, n);
+}
+
+void *mips_memcpy(void *dst, const void *src, size_t n)
+{
+    return shim_memcpy(dst, src, n);
+}
+
+void *mips_memset(void *dst, int c, size_t n)
+{
+    return memset(dst, c, n);
+}
+
+void hookMODLOAD(void)
+{
+}
+
+int getModInfo(char *modname, void *info)
+{
+    return 0;
+}
+
+void shim_init(void)
+{
+    pthread_condattr_t attr;
+
+    // Back the CDVD hardware registers (see cdvdman_opl.h) with RAM, so that their accesses are harmless.
+    if (mmap((void *)CDVD_REGS_BASE, 4096, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0) == MAP_FAILED) {
+        perror("cdvdbench: cannot map the CDVD registers");
+        exit(EXIT_FAILURE);
+    }
+
+    // Alarm deadlines are kept in CLOCK_MONOTONIC time.
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&alarm_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_mutex_lock(&giant);
+    pthread_create(&alarm_thread, NULL, &shim_alarm_entry, NULL);
+    pthread_mutex_unlock(&giant);
+}
+
+// Runs entry() as an IOP thread and waits for it to return.
+void shim_run(void (*entry)(void *), void *arg)
+{
+    iop_thread_t param;
+    int thid;
+
+    param.attr = TH_C;
+    param.option = 0;
+    param.thread = entry;
+    param.stacksize = 0x1000;
+    param.priority = 0x40;
+
+    pthread_mutex_lock(&giant);
+    thid = CreateThread(&param);
+    StartThread(thid, arg);
+    pthread_mutex_unlock(&giant);
+
+    pthread_join(threads[thid - 1].handle, NULL);
+}
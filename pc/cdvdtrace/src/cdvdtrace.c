@@ -0,0 +1,393 @@
+/*
+  Copyright 2026, Open PS2 Loader contributors
+  Licenced under Academic Free License version 3.0
+  Review Open PS2 Loader README & LICENSE files for further details.
+
+  Analyses read traces recorded by CDVDMAN (READ_TRACE=1, CDIOC_OPL_TRACE), as saved by cdvdbench -T:
+  latency histograms, seek distances and a map of the LSNs read over time.
+  The trace can also be turned back into a cdvdbench trace, to replay what a game did.
+*/
+
+#include "cdvdtrace.h"
+
+// Latency buckets: < 1us, then powers of two up to >= 2^(LATENCY_BUCKETS - 2)us.
+#define LATENCY_BUCKETS 22
+// Seek distance buckets: powers of two up to >= 2^(SEEK_BUCKETS - 1) sectors, in each direction.
+#define SEEK_BUCKETS 24
+
+enum EVENT_CLASS {
+    CLASS_MISS = 0,
+    CLASS_PARTIAL,
+    CLASS_HIT,
+    CLASS_REFILL,
+    CLASS_STREAD,
+
+    CLASS_COUNT
+};
+
+static const char *class_names[CLASS_COUNT] = {"miss", "partial", "hit", "refill", "stread"};
+static const char class_marks[CLASS_COUNT] = {'#', 'p', '+', 's', '.'};
+
+static struct cdvdman_read_event *events;
+static u64 *times; // Event start times in ticks, unwrapped
+static unsigned int event_count;
+
+static void printUsage(void)
+{
+    printf("%s version %s\n", PROGRAM_EXTNAME, PROGRAM_VER);
+    printf("Usage: %s [options] <trace dump>\n", PROGRAM_NAME);
+    printf("Options:\n");
+    printf("  -r <n>     Rows of the seek map (default: 32, 0 = no map)\n");
+    printf("  -w <n>     Columns of the seek map (default: 64)\n");
+    printf("  -t <file>  Write the game's requests as a cdvdbench trace\n");
+}
+
+static int event_class(const struct cdvdman_read_event *ev)
+{
+    if (ev->flags & CDVDMAN_TRACE_STREAD)
+        return CLASS_STREAD;
+    if (ev->flags & CDVDMAN_TRACE_STREAM)
+        return CLASS_REFILL;
+    if (ev->flags & CDVDMAN_TRACE_HIT)
+        return CLASS_HIT;
+    if (ev->flags & CDVDMAN_TRACE_PARTIAL)
+        return CLASS_PARTIAL;
+    return CLASS_MISS;
+}
+
+static double ticks_to_us(u64 ticks)
+{
+    return ticks / (IOP_CLOCK_HZ / 1000000.0);
+}
+
+static unsigned int log2_bucket(u64 value, unsigned int buckets)
+{
+    unsigned int i;
+
+    for (i = 0; value > 1 && i < buckets - 1; i++)
+        value >>= 1;
+    return i;
+}
+
+// Sorts by start time, relative to the first event of the dump. Reads never overlap for long, unlike the clock's period.
+static u32 time_base;
+
+static int compare_events(const void *a, const void *b)
+{
+    s32 x = ((const struct cdvdman_read_event *)a)->time - time_base, y = ((const struct cdvdman_read_event *)b)->time - time_base;
+
+    return (x > y) - (x < y);
+}
+
+static int load(const char *path)
+{
+    FILE *file;
+    long size;
+    unsigned int i;
+
+    if ((file = fopen(path, "rb")) == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    rewind(file);
+
+    event_count = size / sizeof(struct cdvdman_read_event);
+    events = malloc(event_count * sizeof(struct cdvdman_read_event) + 1);
+    times = malloc(event_count * sizeof(u64) + 1);
+    if (events == NULL || times == NULL || fread(events, sizeof(struct cdvdman_read_event), event_count, file) != event_count) {
+        fprintf(stderr, "%s: cannot read the trace\n", path);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    if (event_count > 0)
+        time_base = events[0].time;
+
+    // Events are recorded when the reads complete, so overlapping reads are not in order.
+    qsort(events, event_count, sizeof(struct cdvdman_read_event), &compare_events);
+
+    // The IOP clock wraps around every two minutes.
+    for (i = 0; i < event_count; i++)
+        times[i] = i == 0 ? 0 : times[i - 1] + (u32)(events[i].time - events[i - 1].time);
+
+    return 0;
+}
+
+static void printSummary(void)
+{
+    unsigned int count[CLASS_COUNT] = {0}, errors = 0, unaligned = 0, odd_size = 0, i, c;
+    u64 sectors[CLASS_COUNT] = {0}, busy[CLASS_COUNT] = {0};
+    u64 span;
+
+    for (i = 0; i < event_count; i++) {
+        c = event_class(&events[i]);
+        count[c]++;
+        sectors[c] += events[i].sectors;
+        busy[c] += events[i].latency;
+        if (events[i].flags & CDVDMAN_TRACE_ERROR)
+            errors++;
+        if (events[i].align & 3)
+            unaligned++;
+        if (events[i].sector_size != 2048)
+            odd_size++;
+    }
+    span = event_count ? times[event_count - 1] + events[event_count - 1].latency : 0;
+
+    printf("events:        %u over %.3f s\n", event_count, ticks_to_us(span) / 1e6);
+    for (c = 0; c < CLASS_COUNT; c++) {
+        if (count[c] != 0)
+            printf("  %-8s     %6u, %8llu sectors, avg %9.1fus, %.3f s busy\n", class_names[c], count[c], sectors[c], ticks_to_us(busy[c]) / count[c], ticks_to_us(busy[c]) / 1e6);
+    }
+    printf("unaligned:     %u\n", unaligned);
+    printf("sector size:   %u not 2048\n", odd_size);
+    if (errors)
+        printf("errors:        %u\n", errors);
+}
+
+static void printBar(unsigned int value, unsigned int max)
+{
+    unsigned int i, n = max ? (value * 30 + max - 1) / max : 0;
+
+    for (i = 0; i < n; i++)
+        putchar('*');
+}
+
+static void printLatencyHistogram(void)
+{
+    unsigned int hist[LATENCY_BUCKETS][CLASS_COUNT], total[LATENCY_BUCKETS], first, last, max, i, c;
+
+    memset(hist, 0, sizeof(hist));
+    memset(total, 0, sizeof(total));
+    for (i = 0; i < event_count; i++) {
+        u64 us = (u64)ticks_to_us(events[i].latency);
+        unsigned int b = us == 0 ? 0 : 1 + log2_bucket(us, LATENCY_BUCKETS - 1);
+
+        hist[b][event_class(&events[i])]++;
+        total[b]++;
+    }
+
+    for (first = 0; first < LATENCY_BUCKETS - 1 && total[first] == 0; first++)
+        ;
+    for (last = LATENCY_BUCKETS - 1; last > first && total[last] == 0; last--)
+        ;
+    for (max = 0, i = first; i <= last; i++)
+        if (total[i] > max)
+            max = total[i];
+
+    printf("\nlatency (us)   ");
+    for (c = 0; c < CLASS_COUNT; c++)
+        printf("%8s", class_names[c]);
+    printf("\n");
+    for (i = first; i <= last; i++) {
+        if (i == 0)
+            printf("         < 1   ");
+        else
+            printf("%7u-%-7u", 1 << (i - 1), (1 << i) - 1);
+        for (c = 0; c < CLASS_COUNT; c++)
+            printf("%8u", hist[i][c]);
+        printf("  ");
+        printBar(total[i], max);
+        printf("\n");
+    }
+}
+
+static void printSeekHistogram(void)
+{
+    unsigned int forward[SEEK_BUCKETS], backward[SEEK_BUCKETS], sequential = 0, seeks = 0, max, i;
+    u32 next = 0;
+    int valid = 0;
+
+    memset(forward, 0, sizeof(forward));
+    memset(backward, 0, sizeof(backward));
+
+    // Only the requests that reached the device: the game's sceCdStRead() calls are served from the streaming buffer.
+    for (i = 0; i < event_count; i++) {
+        const struct cdvdman_read_event *ev = &events[i];
+
+        if (ev->flags & (CDVDMAN_TRACE_STREAD | CDVDMAN_TRACE_HIT))
+            continue;
+
+        if (valid) {
+            if (ev->lsn == next)
+                sequential++;
+            else if (ev->lsn > next)
+                forward[log2_bucket(ev->lsn - next, SEEK_BUCKETS)]++;
+            else
+                backward[log2_bucket(next - ev->lsn, SEEK_BUCKETS)]++;
+            seeks++;
+        }
+        next = ev->lsn + ev->sectors;
+        valid = 1;
+    }
+
+    if (seeks == 0)
+        return;
+
+    for (max = sequential, i = 0; i < SEEK_BUCKETS; i++) {
+        if (forward[i] > max)
+            max = forward[i];
+        if (backward[i] > max)
+            max = backward[i];
+    }
+
+    printf("\nseek (sectors)  reads\n");
+    for (i = SEEK_BUCKETS; i-- > 0;) {
+        if (backward[i] != 0) {
+            printf("  -%-12u %6u  ", 1 << i, backward[i]);
+            printBar(backward[i], max);
+            printf("\n");
+        }
+    }
+    printf("  sequential   %6u  ", sequential);
+    printBar(sequential, max);
+    printf("\n");
+    for (i = 0; i < SEEK_BUCKETS; i++) {
+        if (forward[i] != 0) {
+            printf("  +%-12u %6u  ", 1 << i, forward[i]);
+            printBar(forward[i], max);
+            printf("\n");
+        }
+    }
+}
+
+// One row per slice of time, one column per range of LSNs.
+static void printSeekMap(unsigned int rows, unsigned int cols)
+{
+    char *map, *cell;
+    u32 lsn_min = ~0, lsn_max = 0;
+    u64 span, lsn_span;
+    unsigned int i, row, col, col_end;
+
+    if (event_count == 0 || rows == 0 || cols == 0)
+        return;
+
+    for (i = 0; i < event_count; i++) {
+        if (events[i].lsn < lsn_min)
+            lsn_min = events[i].lsn;
+        if (events[i].lsn + events[i].sectors > lsn_max)
+            lsn_max = events[i].lsn + events[i].sectors;
+    }
+    span = times[event_count - 1] + 1;
+    lsn_span = lsn_max > lsn_min ? lsn_max - lsn_min : 1;
+
+    map = malloc(rows * cols);
+    memset(map, ' ', rows * cols);
+    for (i = 0; i < event_count; i++) {
+        const struct cdvdman_read_event *ev = &events[i];
+        int c = event_class(ev);
+        char mark = (ev->flags & CDVDMAN_TRACE_ERROR) ? 'X' : class_marks[c];
+
+        row = times[i] * rows / span;
+        col = (u64)(ev->lsn - lsn_min) * cols / lsn_span;
+        col_end = (u64)(ev->lsn + ev->sectors - lsn_min) * cols / lsn_span;
+        if (col_end >= cols)
+            col_end = cols - 1;
+        for (; col <= col_end; col++) {
+            cell = &map[row * cols + col];
+            // Misses and errors are the most interesting, so they are not hidden by the other marks.
+            if (*cell == ' ' || *cell == '.' || (*cell == '+' && mark != '.') || mark == '#' || mark == 'X')
+                *cell = mark;
+        }
+    }
+
+    printf("\nseek map: LSN %u-%u, %.1f ms per row ('#' miss, 'p' partial, '+' hit, 's' refill, '.' stread, 'X' error)\n", lsn_min, lsn_max - 1, ticks_to_us(span) / rows / 1000);
+    for (row = 0; row < rows; row++)
+        printf("%9.3fs |%.*s|\n", ticks_to_us(span * row / rows) / 1e6, cols, &map[row * cols]);
+
+    free(map);
+}
+
+// The requests made by the game, with the time between them: the refills of the streaming buffer are made by CDVDMAN.
+static int writeBenchTrace(const char *path)
+{
+    FILE *file;
+    unsigned int i;
+    u64 end = 0;
+    u32 stlsn = 0;
+    int streaming = 0;
+
+    if ((file = fopen(path, "w")) == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    fprintf(file, "# converted by %s from %u events\n", PROGRAM_NAME, event_count);
+    for (i = 0; i < event_count; i++) {
+        const struct cdvdman_read_event *ev = &events[i];
+
+        if (ev->flags & CDVDMAN_TRACE_STREAM)
+            continue;
+
+        if (i > 0 && times[i] > end && ticks_to_us(times[i] - end) >= 1)
+            fprintf(file, "sleep %.0f\n", ticks_to_us(times[i] - end));
+        end = times[i] + ev->latency;
+
+        if (ev->flags & CDVDMAN_TRACE_STREAD) {
+            // The streaming buffer's size is not recorded.
+            if (!streaming) {
+                fprintf(file, "stinit 128 8\n");
+                streaming = 1;
+                stlsn = ~ev->lsn;
+            }
+            if (ev->lsn != stlsn)
+                fprintf(file, "ststart %u\n", ev->lsn);
+            fprintf(file, "stread %u\n", ev->sectors);
+            stlsn = ev->lsn + ev->sectors;
+        } else if (ev->sector_size != 2048) {
+            fprintf(file, "read %u %u %u\n", ev->lsn, ev->sectors, ev->sector_size);
+        } else {
+            fprintf(file, "read %u %u\n", ev->lsn, ev->sectors);
+        }
+    }
+    if (streaming)
+        fprintf(file, "ststop\n");
+
+    fclose(file);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int rows = 32, cols = 64;
+    const char *bench_trace = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:w:t:")) != -1) {
+        switch (opt) {
+            case 'r':
+                rows = strtoul(optarg, NULL, 0);
+                break;
+            case 'w':
+                cols = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                bench_trace = optarg;
+                break;
+            default:
+                printUsage();
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (argc - optind != 1) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    if (load(argv[optind]) != 0)
+        return EXIT_FAILURE;
+
+    printSummary();
+    printLatencyHistogram();
+    printSeekHistogram();
+    printSeekMap(rows, cols);
+
+    if (bench_trace != NULL && writeBenchTrace(bench_trace) != 0)
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,46 @@
+/*
+  Copyright 2026, Open PS2 Loader contributors
+  Licenced under Academic Free License version 3.0
+  Review Open PS2 Loader README & LICENSE files for further details.
+*/
+
+#ifndef __CDVDTRACE_H__
+#define __CDVDTRACE_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PROGRAM_NAME    "cdvdtrace"
+#define PROGRAM_EXTNAME "CDVDMAN read trace analyser for Open PS2 Loader"
+#define PROGRAM_VER     "0.1.0"
+
+typedef unsigned char u8;
+typedef unsigned short u16;
+typedef unsigned int u32;
+typedef unsigned long long u64;
+typedef signed int s32;
+
+#define IOP_CLOCK_HZ 36864000
+
+// From modules/iopcore/common/cdvdman_opl.h. The dump is an array of these, in little-endian byte order.
+#define CDVDMAN_TRACE_HIT     0x01
+#define CDVDMAN_TRACE_PARTIAL 0x02
+#define CDVDMAN_TRACE_STREAM  0x04
+#define CDVDMAN_TRACE_STREAD  0x08
+#define CDVDMAN_TRACE_ERROR   0x10
+
+struct cdvdman_read_event
+{
+    u32 time;
+    u32 latency;
+    u32 lsn;
+    u16 sectors;
+    u16 sector_size;
+    u8 flags;
+    u8 align;
+    u16 reserved;
+};
+
+#endif
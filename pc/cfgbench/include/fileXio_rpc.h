@@ -0,0 +1,13 @@
+// Host stand-in for the PS2SDK header: configGetStat() is not used by cfgbench.
+#ifndef __FILEXIO_RPC_H
+#define __FILEXIO_RPC_H
+
+typedef struct
+{
+    unsigned int mode;
+    unsigned int size;
+} iox_stat_t;
+
+int fileXioGetStat(const char *name, iox_stat_t *stat);
+
+#endif
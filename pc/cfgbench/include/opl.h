@@ -0,0 +1,25 @@
+// Host stand-in for the OPL header: only what src/config.c needs.
+#ifndef __OPL_H
+#define __OPL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+
+#define LOG(args...)
+
+extern int ps2_ip[4];
+extern int ps2_netmask[4];
+extern int ps2_gateway[4];
+extern char *gBaseMCDir;
+
+#include "../../../include/config.h"
+
+#endif
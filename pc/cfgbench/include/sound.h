@@ -0,0 +1,8 @@
+// Host stand-in for include/sound.h.
+#ifndef __SOUND_H
+#define __SOUND_H
+
+void bgmMute(void);
+void bgmUnMute(void);
+
+#endif
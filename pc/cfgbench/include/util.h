@@ -0,0 +1,30 @@
+// Host stand-in for include/util.h: the file buffer reads from memory only.
+#ifndef __UTIL_H
+#define __UTIL_H
+
+int getmcID(void);
+int getFileSize(int fd);
+int openFile(char *path, int mode);
+
+typedef struct
+{
+    int fd;
+    int mode;
+    char *buffer;
+    unsigned int size;
+    unsigned int available;
+    char *lastPtr;
+    short allocResult;
+} file_buffer_t;
+
+file_buffer_t *openFileBufferBuffer(short allocResult, const void *buffer, unsigned int size);
+file_buffer_t *openFileBuffer(char *fpath, int mode, short allocResult, unsigned int size);
+int readFileBuffer(file_buffer_t *readContext, char **outBuf);
+void writeFileBuffer(file_buffer_t *fileBuffer, char *inBuf, int size);
+void closeFileBuffer(file_buffer_t *fileBuffer);
+
+int max(int a, int b);
+int min(int a, int b);
+int fromHex(char digit);
+
+#endif
@@ -0,0 +1,165 @@
+/*
+  Copyright 2026, Open PS2 Loader contributors
+  Licenced under Academic Free License version 3.0
+  Review Open PS2 Loader README & LICENSE files for further details.
+
+  Times src/config.c on the host: parsing a configuration with configReadBuffer(),
+  then looking up every key in it (and as many keys that are not there) with configGetStr().
+
+  Usage: cfgbench [-r <repeats>] [file.cfg ...]
+  Without files, configurations of 20, 200 and 2000 keys are generated.
+*/
+
+#include "include/opl.h"
+
+#include <time.h>
+
+#define MAX_KEYS 4096
+
+static const char *keyPrefixes[] = {"hdd", "usb", "eth", "app", "theme", "vmc", "Compatibility", "$Config", "gui", "net"};
+
+static char *keys[MAX_KEYS];
+static char *missingKeys[MAX_KEYS];
+static int keyCount;
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static char *generateConfig(int count, int *size)
+{
+    char *text = malloc(count * 96 + 1);
+    int i, length = 0;
+
+    for (i = 0; i < count; i++)
+        length += sprintf(text + length, "%s_%s_%d=%d:/some/path/value/%08x\r\n", keyPrefixes[i % 10], i & 1 ? "mode" : "frames", i, i % 4, i * 2654435761u);
+
+    *size = length;
+    return text;
+}
+
+static char *readConfig(const char *path, int *size)
+{
+    FILE *file = fopen(path, "rb");
+    char *text;
+    long length;
+
+    if (file == NULL) {
+        perror(path);
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    text = malloc(length + 1);
+    if (fread(text, 1, length, file) != (size_t)length) {
+        fclose(file);
+        free(text);
+        return NULL;
+    }
+    fclose(file);
+
+    *size = length;
+    return text;
+}
+
+static void collectKeys(config_set_t *configSet)
+{
+    struct config_value_t *cur;
+
+    char missingKey[CONFIG_KEY_NAME_LEN];
+
+    keyCount = 0;
+    for (cur = configSet->head; cur != NULL && keyCount < MAX_KEYS; cur = cur->next) {
+        snprintf(missingKey, sizeof(missingKey), "%.26s_none", cur->key);
+        missingKeys[keyCount] = strdup(missingKey);
+        keys[keyCount++] = strdup(cur->key);
+    }
+}
+
+static void bench(const char *name, const char *text, int size, int repeats)
+{
+    config_set_t *configSet;
+    double start, parse, hit, miss;
+    const char *value;
+    int i, r, found = 0;
+
+    configSet = configAlloc(0, NULL, NULL);
+
+    start = now();
+    for (r = 0; r < repeats; r++) {
+        configClear(configSet);
+        configReadBuffer(configSet, text, size);
+    }
+    parse = (now() - start) / repeats;
+
+    collectKeys(configSet);
+    if (keyCount == 0) {
+        printf("%-16s no keys\n", name);
+        configFree(configSet);
+        return;
+    }
+
+    start = now();
+    for (r = 0; r < repeats; r++) {
+        for (i = 0; i < keyCount; i++)
+            found += configGetStr(configSet, keys[i], &value);
+    }
+    hit = (now() - start) / ((double)repeats * keyCount);
+
+    start = now();
+    for (r = 0; r < repeats; r++) {
+        for (i = 0; i < keyCount; i++)
+            found -= configGetStr(configSet, missingKeys[i], &value);
+    }
+    miss = (now() - start) / ((double)repeats * keyCount);
+
+    printf("%-16s %5d keys %7d bytes  parse %10.1f us  hit %7.1f ns  miss %7.1f ns%s\n", name, keyCount, size,
+           parse / 1000, hit, miss, found == repeats * keyCount ? "" : "  (lookups failed!)");
+
+    for (i = 0; i < keyCount; i++) {
+        free(keys[i]);
+        free(missingKeys[i]);
+    }
+    configFree(configSet);
+}
+
+int main(int argc, char *argv[])
+{
+    static const int generated[] = {20, 200, 2000};
+    int repeats = 200, i, size;
+    char name[32], *text;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+            repeats = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [-r <repeats>] [file.cfg ...]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (i == argc) {
+        for (i = 0; i < (int)(sizeof(generated) / sizeof(generated[0])); i++) {
+            text = generateConfig(generated[i], &size);
+            snprintf(name, sizeof(name), "generated-%d", generated[i]);
+            bench(name, text, size, repeats);
+            free(text);
+        }
+        return 0;
+    }
+
+    for (; i < argc; i++) {
+        if ((text = readConfig(argv[i], &size)) != NULL) {
+            bench(argv[i], text, size, repeats);
+            free(text);
+        }
+    }
+
+    return 0;
+}
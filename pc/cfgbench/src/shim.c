@@ -0,0 +1,129 @@
+/*
+  Copyright 2026, Open PS2 Loader contributors
+  Licenced under Academic Free License version 3.0
+  Review Open PS2 Loader README & LICENSE files for further details.
+
+  The parts of src/util.c and the rest of OPL that src/config.c uses, for the host.
+  Files are not used: configurations are parsed from memory with configReadBuffer().
+*/
+
+#include "include/opl.h"
+#include "include/util.h"
+#include "include/sound.h"
+#include <fileXio_rpc.h>
+
+int ps2_ip[4];
+int ps2_netmask[4];
+int ps2_gateway[4];
+char *gBaseMCDir = "mc0:OPL";
+
+int getmcID(void)
+{
+    return 0;
+}
+
+int getFileSize(int fd)
+{
+    return 0;
+}
+
+int openFile(char *path, int mode)
+{
+    return -1;
+}
+
+int fileXioGetStat(const char *name, iox_stat_t *stat)
+{
+    return -1;
+}
+
+void bgmMute(void)
+{
+}
+
+void bgmUnMute(void)
+{
+}
+
+file_buffer_t *openFileBuffer(char *fpath, int mode, short allocResult, unsigned int size)
+{
+    return NULL;
+}
+
+file_buffer_t *openFileBufferBuffer(short allocResult, const void *buffer, unsigned int size)
+{
+    file_buffer_t *fileBuffer = (file_buffer_t *)malloc(sizeof(file_buffer_t));
+
+    fileBuffer->size = size;
+    fileBuffer->available = size;
+    fileBuffer->buffer = (char *)malloc(size + 1);
+    fileBuffer->lastPtr = fileBuffer->buffer;
+    fileBuffer->allocResult = allocResult;
+    fileBuffer->fd = -1;
+    fileBuffer->mode = O_RDONLY;
+
+    memcpy(fileBuffer->buffer, buffer, size);
+    fileBuffer->buffer[size] = '\0';
+
+    return fileBuffer;
+}
+
+// As readFileBuffer() in src/util.c, for a buffer that holds the whole file.
+int readFileBuffer(file_buffer_t *fileBuffer, char **outBuf)
+{
+    char *line, *posLF;
+    int lineSize;
+
+    while (fileBuffer->lastPtr != NULL) {
+        line = fileBuffer->lastPtr;
+        posLF = strchr(line, '\n');
+        lineSize = posLF ? posLF - line : (int)strlen(line);
+        fileBuffer->lastPtr = posLF ? posLF + 1 : NULL;
+
+        if (!posLF && !lineSize)
+            break;
+
+        if (lineSize && line[lineSize - 1] == '\r')
+            lineSize--;
+        line[lineSize] = '\0';
+
+        if (line[0] == '#') // '#' for comment lines
+            continue;
+
+        *outBuf = line;
+        return 1;
+    }
+
+    return 0;
+}
+
+void writeFileBuffer(file_buffer_t *fileBuffer, char *inBuf, int size)
+{
+}
+
+void closeFileBuffer(file_buffer_t *fileBuffer)
+{
+    free(fileBuffer->buffer);
+    free(fileBuffer);
+}
+
+int max(int a, int b)
+{
+    return a > b ? a : b;
+}
+
+int min(int a, int b)
+{
+    return a < b ? a : b;
+}
+
+int fromHex(char digit)
+{
+    if (digit >= '0' && digit <= '9')
+        return digit - '0';
+    if (digit >= 'a' && digit <= 'f')
+        return digit - 'a' + 10;
+    if (digit >= 'A' && digit <= 'F')
+        return digit - 'A' + 10;
+    return -1;
+}
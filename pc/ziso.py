@@ -25,6 +25,7 @@ __version__ = "2.0"
 
 import sys
 import os
+import hashlib
 
 import lz4.block
 from struct import pack, unpack
@@ -39,6 +40,11 @@ DEFAULT_PADDING = br'X'
 
 MP = False
 MP_NR = 1024 * 16
+VERSION = 1
+
+# ZSO v2 index entries: 48-bit offset, size - 1 in bits 48-61, and flags
+V2_SHARED = 1 << 62  # Other blocks use the same data
+V2_PLAIN = 1 << 63
 
 
 def hexdump(data):
@@ -75,10 +81,11 @@ def usage():
     print("Usage: ziso [-c level] [-m] [-t percent] [-h] infile outfile")
     print("  -c level: 1-12 compress ISO to ZSO, 1 for standard compression, >1 for high compression")
     print("              0 decompress ZSO to ISO")
-    print("  -b size:  2048-8192, specify block size (2048 by default)")
+    print("  -b size:  2048-16384, specify block size (2048 by default)")
     print("  -m Use multiprocessing acceleration for compressing")
     print("  -t percent Compression Threshold (1-100)")
     print("  -a align Padding alignment 0=small/slow 6=fast/large")
+    print("  -2 Write a ZSO v2 file, which stores identical blocks once and needs no alignment")
     print("  -p pad Padding byte")
     print("  -h this help")
 
@@ -132,15 +139,20 @@ def decompress_zso(fname_in, fname_out):
     magic, header_size, total_bytes, block_size, ver, align = read_zso_header(
         fin)
 
-    if magic != ZISO_MAGIC or block_size == 0 or total_bytes == 0 or header_size != 24 or ver > 1:
+    if magic != ZISO_MAGIC or block_size == 0 or total_bytes == 0 or header_size != 24 or ver > 2:
         print("ziso file format error")
         return -1
 
-    total_block = total_bytes // block_size
+    # The last block may be shorter
+    total_block = (total_bytes + block_size - 1) // block_size
     index_buf = []
 
-    for _ in range(total_block + 1):
-        index_buf.append(unpack('I', fin.read(4))[0])
+    if ver >= 2:
+        for _ in range(total_block):
+            index_buf.append(unpack('Q', fin.read(8))[0])
+    else:
+        for _ in range(total_block + 1):
+            index_buf.append(unpack('I', fin.read(4))[0])
 
     show_zso_info(fname_in, fname_out, total_bytes,
                   block_size, total_block, ver, align)
@@ -157,13 +169,20 @@ def decompress_zso(fname_in, fname_out):
                   (block / percent_period), file=sys.stderr, end='\r')
 
         index = index_buf[block]
-        plain = index & 0x80000000
-        index &= 0x7fffffff
-        read_pos = index << (align)
-
-        if plain:
-            read_size = block_size
+        plain_size = min(block_size, total_bytes - block * block_size)
+
+        if ver >= 2:
+            plain = index & V2_PLAIN
+            read_pos = index & 0xffffffffffff
+            read_size = ((index >> 48) & 0x3fff) + 1
+        elif index & 0x80000000:
+            plain = True
+            read_pos = (index & 0x7fffffff) << (align)
+            read_size = plain_size
         else:
+            plain = False
+            index &= 0x7fffffff
+            read_pos = index << (align)
             index2 = index_buf[block+1] & 0x7fffffff
             # Have to read more bytes if align was set
             read_size = (index2-index) << (align)
@@ -176,14 +195,14 @@ def decompress_zso(fname_in, fname_out):
             dec_data = zso_data
         else:
             try:
-                dec_data = lz4_decompress(zso_data, block_size)
+                dec_data = lz4_decompress(zso_data, plain_size)
 
             except Exception as e:
                 print("%d block: 0x%08X %d %s" %
                       (block, read_pos, read_size, e))
                 sys.exit(-1)
 
-        if (len(dec_data) != block_size):
+        if (len(dec_data) != plain_size):
             print("%d block: 0x%08X %d" %
                   (block, read_pos, read_size))
             sys.exit(-1)
@@ -222,25 +241,63 @@ def compress_zso(fname_in, fname_out, level, bsize):
     total_bytes = fin.tell()
     fin.seek(0)
 
-    magic, header_size, block_size, ver, align = ZISO_MAGIC, 0x18, bsize, 1, DEFAULT_ALIGN
+    magic, header_size, block_size, ver, align = ZISO_MAGIC, 0x18, bsize, VERSION, DEFAULT_ALIGN
 
     # We have to use alignment on any ZSO files which > 2GB, for MSB bit of index as the plain indicator
     # If we don't then the index can be larger than 2GB, which its plain indicator was improperly set
-    align = total_bytes // 2 ** 31
+    # v2 indexes hold 48-bit byte offsets instead
+    align = total_bytes // 2 ** 31 if ver < 2 else 0
 
     header = generate_zso_header(
         magic, header_size, total_bytes, block_size, ver, align)
     fout.write(header)
 
-    total_block = total_bytes // block_size
-    index_buf = [0 for i in range(total_block + 1)]
-
-    fout.write(b"\x00\x00\x00\x00" * len(index_buf))
+    # The last block may be shorter
+    total_block = (total_bytes + block_size - 1) // block_size
+    if ver >= 2:
+        index_buf = [0 for i in range(total_block)]
+        fout.write(b"\x00" * 8 * len(index_buf))
+    else:
+        index_buf = [0 for i in range(total_block + 1)]
+        fout.write(b"\x00\x00\x00\x00" * len(index_buf))
     show_comp_info(fname_in, fname_out, total_bytes, block_size, ver, align, level)
 
     write_pos = fout.tell()
     percent_period = total_block/100
     percent_cnt = 0
+    seen = {}  # v2: hash of the plain data -> first block with that data
+
+    def write_block(block, iso_data, zso_data):
+        nonlocal write_pos
+
+        if ver >= 2:
+            key = hashlib.sha1(iso_data).digest()
+            first = seen.get(key)
+            if first is not None:
+                # Identical blocks share their data
+                index_buf[first] |= V2_SHARED
+                index_buf[block] = index_buf[first]
+                return
+            seen[key] = block
+
+            if 100 * len(zso_data) / len(iso_data) >= min(COMPRESS_THREHOLD, 100):
+                zso_data = iso_data
+                index_buf[block] = V2_PLAIN
+            index_buf[block] |= write_pos | ((len(zso_data) - 1) << 48)
+        else:
+            write_pos = set_align(fout, write_pos, align)
+            index_buf[block] = write_pos >> align
+
+            if 100 * len(zso_data) / len(iso_data) >= min(COMPRESS_THREHOLD, 100):
+                zso_data = iso_data
+                index_buf[block] |= 0x80000000  # Mark as plain
+            elif index_buf[block] & 0x80000000:
+                print(
+                    "Align error, you have to increase align by 1 or OPL won't be able to read offset above 2 ** 31 bytes")
+                sys.exit(1)
+
+        fout.write(zso_data)
+        write_pos += len(zso_data)
 
     if MP:
         pool = Pool()
@@ -269,19 +326,7 @@ def compress_zso(fname_in, fname_out, level, bsize):
                 lz4_compress_mp, iso_data).get(9999999)
 
             for i, zso_data in enumerate(zso_data_all):
-                write_pos = set_align(fout, write_pos, align)
-                index_buf[block] = write_pos >> align
-
-                if 100 * len(zso_data) / len(iso_data[i][0]) >= min(COMPRESS_THREHOLD, 100):
-                    zso_data = iso_data[i][0]
-                    index_buf[block] |= 0x80000000  # Mark as plain
-                elif index_buf[block] & 0x80000000:
-                    print(
-                        "Align error, you have to increase align by 1 or OPL won't be able to read offset above 2 ** 31 bytes")
-                    sys.exit(1)
-
-                fout.write(zso_data)
-                write_pos += len(zso_data)
+                write_block(block, iso_data[i][0], zso_data)
                 block += 1
         else:
             iso_data = fin.read(block_size)
@@ -292,29 +337,19 @@ def compress_zso(fname_in, fname_out, level, bsize):
                 print("%d block: %s" % (block, e))
                 sys.exit(-1)
 
-            write_pos = set_align(fout, write_pos, align)
-            index_buf[block] = write_pos >> align
-
-            if 100 * len(zso_data) / len(iso_data) >= COMPRESS_THREHOLD:
-                zso_data = iso_data
-                index_buf[block] |= 0x80000000  # Mark as plain
-            elif index_buf[block] & 0x80000000:
-                print(
-                    "Align error, you have to increase align by 1 or CFW won't be able to read offset above 2 ** 31 bytes")
-                sys.exit(1)
-
-            fout.write(zso_data)
-            write_pos += len(zso_data)
+            write_block(block, iso_data, zso_data)
             block += 1
 
-    # Last position (total size)
-    index_buf[block] = write_pos >> align
-
     # Update index block
     fout.seek(len(header))
-    for i in index_buf:
-        idx = pack('I', i)
-        fout.write(idx)
+    if ver >= 2:
+        for i in index_buf:
+            fout.write(pack('Q', i))
+    else:
+        # Last position (total size)
+        index_buf[block] = write_pos >> align
+        for i in index_buf:
+            fout.write(pack('I', i))
 
     print("ziso compress completed , total size = %8d bytes , rate %d%%" %
           (write_pos, (write_pos*100/total_bytes)))
@@ -324,14 +359,14 @@ def compress_zso(fname_in, fname_out, level, bsize):
 
 
 def parse_args():
-    global MP, COMPRESS_THREHOLD, DEFAULT_PADDING, DEFAULT_ALIGN
+    global MP, COMPRESS_THREHOLD, DEFAULT_PADDING, DEFAULT_ALIGN, VERSION
 
     if len(sys.argv) < 2:
         usage()
         sys.exit(-1)
 
     try:
-        optlist, args = gnu_getopt(sys.argv, "c:b:mt:a:p:h")
+        optlist, args = gnu_getopt(sys.argv, "c:b:mt:a:p:2h")
     except GetoptError as err:
         print(str(err))
         usage()
@@ -353,6 +388,8 @@ def parse_args():
             DEFAULT_ALIGN = int(a)
         elif o == '-p':
             DEFAULT_PADDING = bytes(a[0], encoding='utf8')
+        elif o == '-2':
+            VERSION = 2
         elif o == '-h':
             usage()
             sys.exit(0)
@@ -363,8 +400,8 @@ def parse_args():
         print("You have to specify input/output filename: %s", err)
         sys.exit(-1)
 
-    if bsize%2048 != 0:
-        print("Error, invalid block size. Must be multiple of 2048.")
+    if bsize < 2048 or bsize > 16384 or bsize & (bsize - 1) != 0:
+        print("Error, invalid block size. Must be 2048, 4096, 8192 or 16384.")
         sys.exit(-1)
 
     return level, bsize, fname_in, fname_out
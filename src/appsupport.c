@@ -455,16 +455,16 @@ static config_set_t *appGetConfig(item_list_t *itemList, int id)
     return config;
 }
 
-static int appGetImage(item_list_t *itemList, char *folder, int isRelative, char *value, char *suffix, GSTEXTURE *resultTex, short psm)
+static int appGetImage(item_list_t *itemList, char *folder, int isRelative, char *value, char *suffix, GSTEXTURE *resultTex, const tex_fit_t *fit)
 {
     char device[8], *startup;
 
     startup = appGetBoot(device, sizeof(device), value);
 
     if (!strcmp(folder, "ART"))
-        return oplGetAppImage(device, folder, isRelative, startup, suffix, resultTex, psm);
+        return oplGetAppImage(device, folder, isRelative, startup, suffix, resultTex, fit);
     else
-        return oplGetAppImage(device, folder, isRelative, value, suffix, resultTex, psm);
+        return oplGetAppImage(device, folder, isRelative, value, suffix, resultTex, fit);
 }
 
 static int appGetTextId(item_list_t *itemList)
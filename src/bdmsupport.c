@@ -12,6 +12,7 @@
 #include "include/cheatman.h"
 #include "include/sound.h"
 #include "modules/iopcore/common/cdvd_config.h"
+#include "modules/iopcore/common/fragmap.h"
 
 #include <usbhdfsd-common.h>
 
@@ -255,10 +256,17 @@ static int bdmUpdateGameList(item_list_t *itemList)
 {
     bdm_device_data_t *pDeviceData = (bdm_device_data_t *)itemList->priv;
 
-    sbReadList(&pDeviceData->bdmGames, pDeviceData->bdmPrefix, &pDeviceData->bdmULSizePrev, &pDeviceData->bdmGameCount);
+    sbReadList(&pDeviceData->bdmGames, pDeviceData->bdmPrefix, &pDeviceData->bdmULSizePrev, &pDeviceData->bdmGameCount, &pDeviceData->bdmResolve);
     return pDeviceData->bdmGameCount;
 }
 
+static int bdmResolveGame(item_list_t *itemList, int *id)
+{
+    bdm_device_data_t *pDeviceData = (bdm_device_data_t *)itemList->priv;
+
+    return sbResolveNext(pDeviceData->bdmGames, pDeviceData->bdmPrefix, pDeviceData->bdmGameCount, &pDeviceData->bdmResolve, id);
+}
+
 static int bdmGetGameCount(item_list_t *itemList)
 {
     bdm_device_data_t *pDeviceData = (bdm_device_data_t *)itemList->priv;
@@ -423,17 +431,21 @@ void bdmLaunchGame(item_list_t *itemList, int id, config_set_t *configSet)
     settings = (struct cdvdman_settings_bdm *)((u8 *)irx + index);
     if (settings == NULL)
         return;
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wstringop-overflow"
-    memset(&settings->frags[0], 0, sizeof(bd_fragment_t) * BDM_MAX_FRAGS);
-#pragma GCC diagnostic pop
-    u8 iTotalFragCount = 0;
+    memset(settings->fragmap, 0, sizeof(settings->fragmap));
+
+    // Every fragment takes at least 2 bytes in the map.
+    bd_fragment_t *frags = malloc(sizeof(bd_fragment_t) * BDM_FRAGMAP_SIZE / 2);
+    if (frags == NULL) {
+        sbUnprepare(&settings->common);
+        return;
+    }
+    int iTotalFragCount = 0;
 
     //
     // Add ISO as fragfile[0] to fragment list
     //
     struct cdvdman_fragfile *iso_frag = &settings->fragfile[0];
-    iso_frag->frag_start = 0;
+    iso_frag->map_start = 0;
     iso_frag->frag_count = 0;
     for (i = 0; i < game->parts; i++) {
         // Open file
@@ -441,21 +453,22 @@ void bdmLaunchGame(item_list_t *itemList, int id, config_set_t *configSet)
         fd = open(partname, O_RDONLY);
         iop_fd = ps2sdk_get_iop_fd(fd);
         if (fd < 0) {
+            free(frags);
             sbUnprepare(&settings->common);
             guiMsgBox(_l(_STR_ERR_FILE_INVALID), 0, NULL);
             return;
         }
 
         // Get fragment list
-        int iFragCount = fileXioIoctl2(iop_fd, USBMASS_IOCTL_GET_FRAGLIST, NULL, 0, (void *)&settings->frags[iTotalFragCount], sizeof(bd_fragment_t) * (BDM_MAX_FRAGS - iTotalFragCount));
-        if (iFragCount > BDM_MAX_FRAGS) {
+        int iFragCount = fileXioIoctl2(iop_fd, USBMASS_IOCTL_GET_FRAGLIST, NULL, 0, (void *)&frags[iTotalFragCount], sizeof(bd_fragment_t) * (BDM_FRAGMAP_SIZE / 2 - iTotalFragCount));
+        if (iFragCount > BDM_FRAGMAP_SIZE / 2 - iTotalFragCount) {
             // Too many fragments
             close(fd);
+            free(frags);
             sbUnprepare(&settings->common);
             guiMsgBox(_l(_STR_ERR_FRAGMENTED), 0, NULL);
             return;
         }
-        iso_frag->frag_count += iFragCount;
         iTotalFragCount += iFragCount;
 
         if ((gPS2Logo) && (i == 0))
@@ -464,6 +477,16 @@ void bdmLaunchGame(item_list_t *itemList, int id, config_set_t *configSet)
         close(fd);
     }
 
+    if (fragmap_encode(settings->fragmap, BDM_FRAGMAP_SIZE, frags, iTotalFragCount) < 0) {
+        // Too many fragments, or too far apart
+        free(frags);
+        sbUnprepare(&settings->common);
+        guiMsgBox(_l(_STR_ERR_FRAGMENTED), 0, NULL);
+        return;
+    }
+    iso_frag->frag_count = iTotalFragCount;
+    free(frags);
+
     // Initialize layer 1 information.
     sbCreatePath(game, partname, pDeviceData->bdmPrefix, "/", 0);
     layer1_start = sbGetISO9660MaxLBA(partname);
@@ -571,10 +594,16 @@ void bdmLaunchGame(item_list_t *itemList, int id, config_set_t *configSet)
 static config_set_t *bdmGetConfig(item_list_t *itemList, int id)
 {
     bdm_device_data_t *pDeviceData = (bdm_device_data_t *)itemList->priv;
-    return sbPopulateConfig(&pDeviceData->bdmGames[id], pDeviceData->bdmPrefix, "/");
+    base_game_info_t *game = &pDeviceData->bdmGames[id];
+
+    // The game may have been selected before its startup ID was read in the background.
+    if (game->startup[0] == '\0')
+        sbResolveGame(game, pDeviceData->bdmPrefix, &pDeviceData->bdmResolve);
+
+    return sbPopulateConfig(game, pDeviceData->bdmPrefix, "/");
 }
 
-static int bdmGetImage(item_list_t *itemList, char *folder, int isRelative, char *value, char *suffix, GSTEXTURE *resultTex, short psm)
+static int bdmGetImage(item_list_t *itemList, char *folder, int isRelative, char *value, char *suffix, GSTEXTURE *resultTex, const tex_fit_t *fit)
 {
     char path[256];
 
@@ -584,7 +613,7 @@ static int bdmGetImage(item_list_t *itemList, char *folder, int isRelative, char
         snprintf(path, sizeof(path), "%s%s/%s_%s", pDeviceData->bdmPrefix, folder, value, suffix);
     else
         snprintf(path, sizeof(path), "%s%s_%s", folder, value, suffix);
-    return texDiscoverLoad(resultTex, path, -1);
+    return texDiscoverLoad(resultTex, path, -1, fit);
 }
 
 static int bdmGetTextId(item_list_t *itemList)
@@ -631,6 +660,7 @@ static void bdmCleanUp(item_list_t *itemList, int exception)
 
         bdm_device_data_t *pDeviceData = (bdm_device_data_t *)itemList->priv;
         free(pDeviceData->bdmGames);
+        sbFreeResolve(&pDeviceData->bdmResolve);
         free(pDeviceData);
         itemList->priv = NULL;
 
@@ -659,6 +689,7 @@ static void bdmShutdown(item_list_t *itemList)
 
         // Free device data.
         free(pDeviceData->bdmGames);
+        sbFreeResolve(&pDeviceData->bdmResolve);
         free(pDeviceData);
         itemList->priv = NULL;
     }
@@ -679,7 +710,7 @@ static char *bdmGetPrefix(item_list_t *itemList)
 static item_list_t bdmGameList = {
     BDM_MODE, 2, 0, 0, MENU_MIN_INACTIVE_FRAMES, BDM_MODE_UPDATE_DELAY, NULL, NULL, &bdmGetTextId, &bdmGetPrefix, &bdmInit, &bdmNeedsUpdate,
     &bdmUpdateGameList, &bdmGetGameCount, &bdmGetGame, &bdmGetGameName, &bdmGetGameNameLength, &bdmGetGameStartup, &bdmDeleteGame, &bdmRenameGame,
-    &bdmLaunchGame, &bdmGetConfig, &bdmGetImage, &bdmCleanUp, &bdmShutdown, &bdmCheckVMC, &bdmGetIconId};
+    &bdmLaunchGame, &bdmGetConfig, &bdmGetImage, &bdmCleanUp, &bdmShutdown, &bdmCheckVMC, &bdmGetIconId, &bdmResolveGame};
 
 void bdmInitSemaphore()
 {
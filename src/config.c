@@ -122,42 +122,148 @@ static int configKeyValidate(const char *key)
     return !strchr(key, '=');
 }
 
-static struct config_value_t *allocConfigItem(const char *key, const char *val)
+// Size of the blocks the values are allocated from
+#define CONFIG_BLOCK_SIZE 2048
+#define CONFIG_INDEX_MIN  16
+
+struct config_block
 {
-    struct config_value_t *it = (struct config_value_t *)malloc(sizeof(struct config_value_t));
-    strncpy(it->key, key, sizeof(it->key));
-    it->key[sizeof(it->key) - 1] = '\0';
-    strncpy(it->val, val, sizeof(it->val));
-    it->val[sizeof(it->val) - 1] = '\0';
-    it->next = NULL;
+    struct config_block *next;
+    unsigned int used;
+    char data[CONFIG_BLOCK_SIZE] __attribute__((aligned(8)));
+};
 
-    return it;
+static void *configAllocMem(config_set_t *configSet, unsigned int size)
+{
+    struct config_block *block = configSet->blocks;
+    void *mem;
+
+    size = (size + 7) & ~7;
+    if (!block || block->used + size > CONFIG_BLOCK_SIZE) {
+        block = (struct config_block *)malloc(sizeof(struct config_block));
+        if (!block)
+            return NULL;
+
+        block->next = configSet->blocks;
+        block->used = 0;
+        configSet->blocks = block;
+    }
+
+    mem = &block->data[block->used];
+    block->used += size;
+    return mem;
+}
+
+// FNV-1a of the key, as far as it would be stored
+static u32 configHashKey(const char *key, int *length)
+{
+    u32 hash = 2166136261u;
+    int i;
+
+    for (i = 0; i < CONFIG_KEY_NAME_LEN - 1 && key[i] != '\0'; i++) {
+        hash ^= (u8)key[i];
+        hash *= 16777619u;
+    }
+
+    *length = i;
+    return hash;
+}
+
+static void configIndexInsert(config_set_t *configSet, struct config_value_t *it)
+{
+    unsigned int slot = it->hash & configSet->indexMask;
+
+    while (configSet->index[slot])
+        slot = (slot + 1) & configSet->indexMask;
+
+    configSet->index[slot] = it;
+}
+
+// Replaces the index with the given empty one, filled with the values of the set.
+static void configIndexReplace(config_set_t *configSet, struct config_value_t **index, unsigned int size)
+{
+    struct config_value_t *it;
+
+    free(configSet->index);
+    configSet->index = index;
+    configSet->indexMask = size - 1;
+
+    for (it = configSet->head; it != NULL; it = it->next)
+        configIndexInsert(configSet, it);
+}
+
+static int configIndexRebuild(config_set_t *configSet, unsigned int size)
+{
+    struct config_value_t **index;
+
+    index = (struct config_value_t **)calloc(size, sizeof(struct config_value_t *));
+    if (!index)
+        return 0;
+
+    configIndexReplace(configSet, index, size);
+
+    return 1;
 }
 
 /// Low level key addition. Does not check for uniqueness.
-static void addConfigValue(config_set_t *configSet, const char *key, const char *val)
+static struct config_value_t *addConfigValue(config_set_t *configSet, const char *key, const char *val)
 {
-    if (!configSet->tail) {
-        configSet->head = allocConfigItem(key, val);
-        configSet->tail = configSet->head;
-    } else {
-        configSet->tail->next = allocConfigItem(key, val);
-        configSet->tail = configSet->tail->next;
+    struct config_value_t *it;
+    int keyLen, valLen;
+    u32 hash;
+
+    hash = configHashKey(key, &keyLen);
+    valLen = strnlen(val, CONFIG_KEY_VALUE_LEN - 1);
+
+    // Grow the index first, so that a failure leaves the set as it was.
+    if (!configSet->index || (configSet->count + 1) * 2 > configSet->indexMask + 1) {
+        if (!configIndexRebuild(configSet, configSet->index ? (configSet->indexMask + 1) * 2 : CONFIG_INDEX_MIN))
+            return NULL;
     }
+
+    it = (struct config_value_t *)configAllocMem(configSet, sizeof(struct config_value_t) + keyLen + 1 + valLen + 1);
+    if (!it)
+        return NULL;
+
+    it->key = (char *)(it + 1);
+    memcpy(it->key, key, keyLen);
+    it->key[keyLen] = '\0';
+    it->val = it->key + keyLen + 1;
+    memcpy(it->val, val, valLen);
+    it->val[valLen] = '\0';
+    it->valSize = valLen + 1;
+    it->hash = hash;
+    it->next = NULL;
+
+    if (!configSet->tail)
+        configSet->head = it;
+    else
+        configSet->tail->next = it;
+    configSet->tail = it;
+
+    configSet->count++;
+    configIndexInsert(configSet, it);
+
+    return it;
 }
 
 static struct config_value_t *getConfigItemForName(config_set_t *configSet, const char *name)
 {
-    struct config_value_t *val = configSet->head;
+    struct config_value_t *it;
+    unsigned int slot;
+    int length;
+    u32 hash;
 
-    while (val) {
-        if (strncmp(val->key, name, sizeof(val->key)) == 0)
-            break;
+    if (!configSet->index)
+        return NULL;
 
-        val = val->next;
+    hash = configHashKey(name, &length);
+    for (slot = hash & configSet->indexMask; (it = configSet->index[slot]) != NULL; slot = (slot + 1) & configSet->indexMask) {
+        if (it->hash == hash && strncmp(it->key, name, length) == 0 && it->key[length] == '\0')
+            return it;
     }
 
-    return val;
+    return NULL;
 }
 
 static char cfgDevice[8];
@@ -240,6 +346,10 @@ config_set_t *configAlloc(int type, config_set_t *configSet, char *fileName)
     configSet->type = type;
     configSet->head = NULL;
     configSet->tail = NULL;
+    configSet->index = NULL;
+    configSet->indexMask = 0;
+    configSet->count = 0;
+    configSet->blocks = NULL;
     if (fileName) {
         int length = strlen(fileName) + 1;
         configSet->filename = (char *)malloc(length * sizeof(char));
@@ -285,14 +395,25 @@ int configSetStr(config_set_t *configSet, const char *key, const char *value)
     struct config_value_t *it = getConfigItemForName(configSet, key);
 
     if (it) {
-        if (strncmp(it->val, value, sizeof(it->val)) != 0) {
-            strncpy(it->val, value, sizeof(it->val));
-            it->val[sizeof(it->val) - 1] = '\0';
+        if (strncmp(it->val, value, CONFIG_KEY_VALUE_LEN - 1) != 0) {
+            int length = strnlen(value, CONFIG_KEY_VALUE_LEN - 1);
+
+            // A longer value gets new room. The old one stays in its block until the set is cleared.
+            if (length + 1 > it->valSize) {
+                char *val = (char *)configAllocMem(configSet, length + 1);
+                if (!val)
+                    return 0;
+                it->val = val;
+                it->valSize = length + 1;
+            }
+            memcpy(it->val, value, length);
+            it->val[length] = '\0';
             if (it->key[0] != '#')
                 configSet->modified = 1;
         }
     } else {
-        addConfigValue(configSet, key, value);
+        if (!addConfigValue(configSet, key, value))
+            return 0;
         if (key[0] != '#')
             configSet->modified = 1;
     }
@@ -371,9 +492,21 @@ int configRemoveKey(config_set_t *configSet, const char *key)
 
     struct config_value_t *val = configSet->head;
     struct config_value_t *prev = NULL;
+    struct config_value_t **index;
+    int removed = 0;
+
+    if (!val)
+        return 1;
+
+    // Removals are rare: rebuilding the index is simpler than leaving tombstones in it.
+    // Allocate the new index first, so that a failure leaves the set as it was.
+    index = (struct config_value_t **)calloc(configSet->indexMask + 1, sizeof(struct config_value_t *));
+    if (!index)
+        return 0;
 
+    // The values stay in their blocks until the set is cleared.
     while (val) {
-        if (strncmp(val->key, key, sizeof(val->key)) == 0) {
+        if (strncmp(val->key, key, CONFIG_KEY_NAME_LEN) == 0) {
             if (key[0] != '#')
                 configSet->modified = 1;
 
@@ -381,19 +514,24 @@ int configRemoveKey(config_set_t *configSet, const char *key)
                 configSet->tail = prev;
 
             val = val->next;
-            if (prev) {
-                free(prev->next);
+            if (prev)
                 prev->next = val;
-            } else {
-                free(configSet->head);
+            else
                 configSet->head = val;
-            }
+
+            configSet->count--;
+            removed = 1;
         } else {
             prev = val;
             val = val->next;
         }
     }
 
+    if (removed)
+        configIndexReplace(configSet, index, configSet->indexMask + 1);
+    else
+        free(index);
+
     return 1;
 }
 
@@ -574,13 +712,18 @@ int configGetStat(config_set_t *configSet, iox_stat_t *stat)
 
 void configClear(config_set_t *configSet)
 {
-    while (configSet->head) {
-        struct config_value_t *cur = configSet->head;
-        configSet->head = cur->next;
+    while (configSet->blocks) {
+        struct config_block *block = configSet->blocks;
+        configSet->blocks = block->next;
 
-        free(cur);
+        free(block);
     }
 
+    free(configSet->index);
+    configSet->index = NULL;
+    configSet->indexMask = 0;
+    configSet->count = 0;
+
     configSet->head = NULL;
     configSet->tail = NULL;
     configSet->modified = 1;
@@ -27,6 +27,7 @@ static time_t ethModifiedDVDPrev;
 static int ethGameCount = 0;
 static unsigned char ethModulesLoaded = 0;
 static base_game_info_t *ethGames = NULL;
+static sb_resolve_t ethResolve; // ISO images of ethGames that are still to be read.
 
 static struct ip4_addr lastIP;
 static struct ip4_addr lastNM;
@@ -490,7 +491,7 @@ static int ethUpdateGameList(item_list_t *itemList)
         if (gNetworkStartup != 0)
             return 0;
 
-        if ((sbReadList(&ethGames, ethPrefix, &ethULSizePrev, &ethGameCount)) < 0) {
+        if ((sbReadList(&ethGames, ethPrefix, &ethULSizePrev, &ethGameCount, &ethResolve)) < 0) {
             gNetworkStartup = ERROR_ETH_SMB_LISTGAMES;
             ethDisplayErrorStatus();
         }
@@ -508,6 +509,7 @@ static int ethUpdateGameList(item_list_t *itemList)
         count = fileXioDevctl(ethBase, SMB_DEVCTL_GETSHARELIST, (void *)&getsharelist, sizeof(getsharelist), NULL, 0);
         if (count > 0) {
             free(ethGames);
+            sbFreeResolve(&ethResolve);
             ethGames = (base_game_info_t *)malloc(sizeof(base_game_info_t) * count);
             for (i = 0; i < count; i++) {
                 LOG("ETHSUPPORT Share found: %s\n", sharelist[i].ShareName);
@@ -714,19 +716,30 @@ static void ethLaunchGame(item_list_t *itemList, int id, config_set_t *configSet
     sysLaunchLoaderElf(filename, "ETH_MODE", size_smb_cdvdman_irx, smb_cdvdman_irx, size_mcemu_irx, smb_mcemu_irx, EnablePS2Logo, compatmask);
 }
 
+static int ethResolveGame(item_list_t *itemList, int *id)
+{
+    return sbResolveNext(ethGames, ethPrefix, ethGameCount, &ethResolve, id);
+}
+
 static config_set_t *ethGetConfig(item_list_t *itemList, int id)
 {
-    return sbPopulateConfig(&ethGames[id], ethPrefix, "\\");
+    base_game_info_t *game = &ethGames[id];
+
+    // The game may have been selected before its startup ID was read in the background.
+    if (game->startup[0] == '\0')
+        sbResolveGame(game, ethPrefix, &ethResolve);
+
+    return sbPopulateConfig(game, ethPrefix, "\\");
 }
 
-static int ethGetImage(item_list_t *itemList, char *folder, int isRelative, char *value, char *suffix, GSTEXTURE *resultTex, short psm)
+static int ethGetImage(item_list_t *itemList, char *folder, int isRelative, char *value, char *suffix, GSTEXTURE *resultTex, const tex_fit_t *fit)
 {
     char path[256];
     if (isRelative)
         snprintf(path, sizeof(path), "%s%s\\%s_%s", ethPrefix, folder, value, suffix);
     else
         snprintf(path, sizeof(path), "%s%s_%s", folder, value, suffix);
-    return texDiscoverLoad(resultTex, path, -1);
+    return texDiscoverLoad(resultTex, path, -1, fit);
 }
 
 static int ethGetTextId(item_list_t *itemList)
@@ -746,6 +759,7 @@ static void ethCleanUp(item_list_t *itemList, int exception)
         LOG("ETHSUPPORT CleanUp\n");
 
         free(ethGames);
+        sbFreeResolve(&ethResolve);
 
         // disconnect from the active SMB session
         if ((exception & UNMOUNT_EXCEPTION) == 0)
@@ -763,6 +777,7 @@ static void ethShutdown(item_list_t *itemList)
         LOG("ETHSUPPORT Shutdown\n");
 
         free(ethGames);
+        sbFreeResolve(&ethResolve);
 
         // disconnect from the active SMB session
         ethSMBDisconnect();
@@ -789,7 +804,7 @@ static char *ethGetPrefix(item_list_t *itemList)
 static item_list_t ethGameList = {
     ETH_MODE, 1, 0, 0, MENU_MIN_INACTIVE_FRAMES, ETH_MODE_UPDATE_DELAY, NULL, NULL, &ethGetTextId, &ethGetPrefix, &ethInit, &ethNeedsUpdate,
     &ethUpdateGameList, &ethGetGameCount, &ethGetGame, &ethGetGameName, &ethGetGameNameLength, &ethGetGameStartup, &ethDeleteGame, &ethRenameGame,
-    &ethLaunchGame, &ethGetConfig, &ethGetImage, &ethCleanUp, &ethShutdown, &ethCheckVMC, &ethGetIconId};
+    &ethLaunchGame, &ethGetConfig, &ethGetImage, &ethCleanUp, &ethShutdown, &ethCheckVMC, &ethGetIconId, &ethResolveGame};
 
 static int ethReadNetConfig(void)
 {
@@ -0,0 +1 @@
+#include "../modules/iopcore/cdvdman/fragmap.c"
@@ -1396,8 +1396,8 @@ void guiDrawSubMenuHints(void)
 static int endIntro = 0; // Break intro loop and start 'Last Played Auto Start' countdown
 static void guiDrawOverlays()
 {
-    // are there any pending operations?
-    int pending = ioHasPendingRequests();
+    // are there any pending operations? Background work does not count.
+    int pending = ioHasPendingRequestsAt(IO_PRIORITY_NORMAL);
     static int busyAlpha = 0x00; // Fully transparant
 
     if (!pending) {
@@ -1430,6 +1430,28 @@ static void guiDrawOverlays()
     snprintf(text, sizeof(text), "%dKiB TEXMAN", ((4 * 1024 * 1024) - gsGlobal->CurrentPointer) / 1024);
     fntRenderString(gTheme->fonts[0], x, y, ALIGN_LEFT, 0, 0, text, GS_SETREG_RGBA(0x60, 0x60, 0x60, 0x80));
     y += yadd;
+
+    rm_texture_stats_t texStats;
+    rmGetTextureStats(&texStats);
+
+    snprintf(text, sizeof(text), "%dKiB USED", texStats.resident / 1024);
+    fntRenderString(gTheme->fonts[0], x, y, ALIGN_LEFT, 0, 0, text, GS_SETREG_RGBA(0x60, 0x60, 0x60, 0x80));
+    y += yadd;
+
+    snprintf(text, sizeof(text), "%dKiB UP (%d)", texStats.uploadBytes / 1024, texStats.uploadPeak / 1024);
+    fntRenderString(gTheme->fonts[0], x, y, ALIGN_LEFT, 0, 0, text, GS_SETREG_RGBA(0x60, 0x60, 0x60, 0x80));
+    y += yadd;
+
+    io_stats_t ioStats;
+    ioGetStats(&ioStats);
+
+    snprintf(text, sizeof(text), "IO %u/%u/%u (%u)", ioStats.depth[IO_PRIORITY_HIGH], ioStats.depth[IO_PRIORITY_NORMAL], ioStats.depth[IO_PRIORITY_LOW], ioStats.peakDepth);
+    fntRenderString(gTheme->fonts[0], x, y, ALIGN_LEFT, 0, 0, text, GS_SETREG_RGBA(0x60, 0x60, 0x60, 0x80));
+    y += yadd;
+
+    snprintf(text, sizeof(text), "%ums WAIT (%u)", ioStats.waitAvg, ioStats.waitMax);
+    fntRenderString(gTheme->fonts[0], x, y, ALIGN_LEFT, 0, 0, text, GS_SETREG_RGBA(0x60, 0x60, 0x60, 0x80));
+    y += yadd;
     y += yadd; // Empty line
 
     if (prevtime != 0) {
@@ -1688,7 +1710,7 @@ int guiMsgBox(const char *text, int addAccept, struct UIItem *ui)
 
 void guiHandleDeferedIO(int *ptr, const char *message, int type, void *data)
 {
-    ioPutRequest(type, data);
+    ioPutRequestEx(type, data, IO_PRIORITY_HIGH, 0, NULL);
 
     while (*ptr)
         guiRenderTextScreen(message);
@@ -1696,7 +1718,7 @@ void guiHandleDeferedIO(int *ptr, const char *message, int type, void *data)
 
 void guiGameHandleDeferedIO(int *ptr, struct UIItem *ui, int type, void *data)
 {
-    ioPutRequest(type, data);
+    ioPutRequestEx(type, data, IO_PRIORITY_HIGH, 0, NULL);
 
     while (*ptr) {
         guiStartFrame();
@@ -625,14 +625,14 @@ static config_set_t *hddGetConfig(item_list_t *itemList, int id)
     return config;
 }
 
-static int hddGetImage(item_list_t *itemList, char *folder, int isRelative, char *value, char *suffix, GSTEXTURE *resultTex, short psm)
+static int hddGetImage(item_list_t *itemList, char *folder, int isRelative, char *value, char *suffix, GSTEXTURE *resultTex, const tex_fit_t *fit)
 {
     char path[256];
     if (isRelative)
         snprintf(path, sizeof(path), "%s%s/%s_%s", gHDDPrefix, folder, value, suffix);
     else
         snprintf(path, sizeof(path), "%s%s_%s", folder, value, suffix);
-    return texDiscoverLoad(resultTex, path, -1);
+    return texDiscoverLoad(resultTex, path, -1, fit);
 }
 
 static int hddGetTextId(item_list_t *itemList)
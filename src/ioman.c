@@ -5,6 +5,7 @@
 #include <malloc.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <time.h>
 #ifdef __EESIO_DEBUG
 #include <sio.h>
 #endif
@@ -24,6 +25,13 @@ struct io_request_t
 {
     int type;
     void *data;
+    // cancellation token and its value when the request was queued
+    const int *token;
+    int tokenValue;
+    clock_t queued;
+    short priority;
+    // taken from gReqPool, or allocated when the pool ran out
+    short pooled;
     struct io_request_t *next;
 };
 
@@ -31,11 +39,27 @@ struct io_handler_t
 {
     int type;
     io_request_handler_t handler;
+    io_request_handler_t release;
 };
 
-/// Circular request queue
-static struct io_request_t *gReqList;
-static struct io_request_t *gReqEnd;
+/// Request queues, one per priority
+static struct io_request_t *gReqList[IO_PRIORITY_COUNT];
+static struct io_request_t *gReqEnd[IO_PRIORITY_COUNT];
+/// Priority of the request being processed, which still counts as pending. IO_PRIORITY_COUNT if there is none.
+static int gReqCurrent;
+/// The request being processed, or NULL
+static struct io_request_t *gReqActive;
+/// Threads waiting for the request being processed to complete, and the semaphore that they wait on
+static int gReqWaiters;
+static s32 gReqDoneSemaId;
+
+/// Request nodes, so that queueing does not allocate memory
+static struct io_request_t gReqPool[MAX_IO_REQUESTS];
+static struct io_request_t *gReqFree;
+
+static io_stats_t gStats;
+// recent average wait, in clock ticks, scaled by 8
+static u32 gWaitAvg;
 
 static struct io_handler_t gRequestHandlers[MAX_IO_HANDLERS];
 
@@ -44,46 +68,55 @@ static int gHandlerCount;
 // id of the processing thread
 static s32 gIOThreadId;
 
-// lock for tip processing
-static s32 gProcSemaId;
-// lock for queue end
-static s32 gEndSemaId;
+// lock for the queues and the handlers
+static s32 gQueueSemaId;
 // ioPrintf sema id
 static s32 gIOPrintfSemaId;
 
 static ee_thread_t gIOThread;
 static ee_sema_t gQueueSema;
+static ee_sema_t gReqDoneSema;
 
 static int isIOBlocked = 0;
 static int isIORunning = 0;
 
-int ioRegisterHandler(int type, io_request_handler_t handler)
+int ioRegisterHandlerEx(int type, io_request_handler_t handler, io_request_handler_t release)
 {
-    WaitSema(gProcSemaId);
+    int i, result = IO_OK;
 
     if (handler == NULL)
         return IO_ERR_INVALID_HANDLER;
 
-    if (gHandlerCount >= MAX_IO_HANDLERS)
-        return IO_ERR_TOO_MANY_HANDLERS;
-
-    int i;
+    WaitSema(gQueueSemaId);
 
     for (i = 0; i < gHandlerCount; ++i) {
-        if (gRequestHandlers[i].type == type)
-            return IO_ERR_DUPLICIT_HANDLER;
+        if (gRequestHandlers[i].type == type) {
+            result = IO_ERR_DUPLICIT_HANDLER;
+            break;
+        }
     }
 
-    gRequestHandlers[gHandlerCount].type = type;
-    gRequestHandlers[gHandlerCount].handler = handler;
-    gHandlerCount++;
+    if (result == IO_OK && gHandlerCount >= MAX_IO_HANDLERS)
+        result = IO_ERR_TOO_MANY_HANDLERS;
+
+    if (result == IO_OK) {
+        gRequestHandlers[gHandlerCount].type = type;
+        gRequestHandlers[gHandlerCount].handler = handler;
+        gRequestHandlers[gHandlerCount].release = release;
+        gHandlerCount++;
+    }
 
-    SignalSema(gProcSemaId);
+    SignalSema(gQueueSemaId);
 
-    return IO_OK;
+    return result;
 }
 
-static io_request_handler_t ioGetHandler(int type)
+int ioRegisterHandler(int type, io_request_handler_t handler)
+{
+    return ioRegisterHandlerEx(type, handler, NULL);
+}
+
+static struct io_handler_t *ioGetHandler(int type)
 {
     int i;
 
@@ -91,70 +124,230 @@ static io_request_handler_t ioGetHandler(int type)
         struct io_handler_t *h = &gRequestHandlers[i];
 
         if (h->type == type)
-            return h->handler;
+            return h;
     }
 
     return NULL;
 }
 
+// The queue lock must be held by the callers of the functions below.
+
+static struct io_request_t *ioAllocRequest(void)
+{
+    struct io_request_t *req = gReqFree;
+
+    if (req) {
+        gReqFree = req->next;
+        req->pooled = 1;
+    } else {
+        req = (struct io_request_t *)malloc(sizeof(struct io_request_t));
+        if (req)
+            req->pooled = 0;
+    }
+
+    return req;
+}
+
+static void ioFreeRequest(struct io_request_t *req)
+{
+    if (req->pooled) {
+        req->next = gReqFree;
+        gReqFree = req;
+    } else
+        free(req);
+}
+
+static void ioAppendRequest(struct io_request_t *req)
+{
+    int priority = req->priority;
+
+    req->next = NULL;
+    if (gReqEnd[priority])
+        gReqEnd[priority]->next = req;
+    else
+        gReqList[priority] = req;
+    gReqEnd[priority] = req;
+
+    gStats.depth[priority]++;
+}
+
+static void ioUnlinkRequest(struct io_request_t *req, struct io_request_t *last)
+{
+    int priority = req->priority;
+
+    if (last)
+        last->next = req->next;
+    else
+        gReqList[priority] = req->next;
+
+    if (req == gReqEnd[priority])
+        gReqEnd[priority] = last;
+
+    gStats.depth[priority]--;
+}
+
+static unsigned int ioGetDepth(void)
+{
+    unsigned int depth = gReqCurrent < IO_PRIORITY_COUNT ? 1 : 0;
+    int priority;
+
+    for (priority = 0; priority < IO_PRIORITY_COUNT; priority++)
+        depth += gStats.depth[priority];
+
+    return depth;
+}
+
+static int ioIsCancelled(struct io_request_t *req)
+{
+    return req->token && *req->token != req->tokenValue;
+}
+
+/// Whether the request is of the given type (any if -1) and was queued with the given token (any if NULL) and cancelled by it (only if the token is given).
+static int ioMatchRequest(struct io_request_t *req, int type, const int *token)
+{
+    return (type < 0 || req->type == type) && (!token || (req->token == token && ioIsCancelled(req)));
+}
+
+/// Removes the requests that match (see ioMatchRequest). Returns them as a list, to be released once the lock is dropped.
+static struct io_request_t *ioTakeRequests(int type, const int *token)
+{
+    struct io_request_t *dropped = NULL, *req, *last, *next;
+    int priority;
+
+    for (priority = 0; priority < IO_PRIORITY_COUNT; priority++) {
+        last = NULL;
+        for (req = gReqList[priority]; req != NULL; req = next) {
+            next = req->next;
+
+            if (ioMatchRequest(req, type, token)) {
+                ioUnlinkRequest(req, last);
+                req->next = dropped;
+                dropped = req;
+            } else
+                last = req;
+        }
+    }
+
+    return dropped;
+}
+
+/// Gives the data of the dropped requests to their release handlers, and frees the requests. Called without the queue lock held.
+static int ioReleaseRequests(struct io_request_t *dropped)
+{
+    struct io_request_t *req, *next;
+    struct io_handler_t *hlr;
+    int count = 0;
+
+    for (req = dropped; req != NULL; req = req->next) {
+        hlr = ioGetHandler(req->type);
+        if (hlr && hlr->release)
+            hlr->release(req->data);
+        count++;
+    }
+
+    if (count) {
+        WaitSema(gQueueSemaId);
+        for (req = dropped; req != NULL; req = next) {
+            next = req->next;
+            ioFreeRequest(req);
+        }
+        gStats.cancelled += count;
+        SignalSema(gQueueSemaId);
+    }
+
+    return count;
+}
+
+/// Takes the next request to process, and drops the cancelled ones found before it.
+static struct io_request_t *ioNextRequest(struct io_request_t **dropped)
+{
+    struct io_request_t *req;
+    u32 wait;
+    int priority;
+
+    WaitSema(gQueueSemaId);
+
+    for (priority = 0; priority < IO_PRIORITY_COUNT; priority++) {
+        while ((req = gReqList[priority]) != NULL) {
+            ioUnlinkRequest(req, NULL);
+
+            if (!ioIsCancelled(req)) {
+                gReqCurrent = priority;
+                gReqActive = req;
+
+                wait = clock() - req->queued;
+                gWaitAvg += wait - gWaitAvg / 8;
+                wait = (u64)wait * 1000 / CLOCKS_PER_SEC;
+                if (wait > gStats.waitMax)
+                    gStats.waitMax = wait;
+
+                SignalSema(gQueueSemaId);
+                return req;
+            }
+
+            req->next = *dropped;
+            *dropped = req;
+        }
+    }
+
+    SignalSema(gQueueSemaId);
+    return NULL;
+}
+
 static void ioProcessRequest(struct io_request_t *req)
 {
     if (!req)
         return;
 
-    io_request_handler_t hlr = ioGetHandler(req->type);
+    struct io_handler_t *hlr = ioGetHandler(req->type);
 
     // invalidate the request
     void *data = req->data;
 
     if (hlr)
-        hlr(data);
+        hlr->handler(data);
 }
 
 static void ioWorkerThread(void *arg)
 {
+    struct io_request_t *req, *dropped;
+
     while (!gIOTerminate) {
         SleepThread();
 
-        // if term requested exit immediately from the loop
-        if (gIOTerminate)
-            break;
-
-        // do we have a request in the queue?
-        WaitSema(gProcSemaId);
-        while (gReqList) {
-            // if term requested exit immediately from the loop
-            if (gIOTerminate)
+        // process the requests in the queue, unless term was requested
+        while (!gIOTerminate) {
+            dropped = NULL;
+            req = ioNextRequest(&dropped);
+            ioReleaseRequests(dropped);
+            if (!req)
                 break;
 
-            struct io_request_t *req = gReqList;
             ioProcessRequest(req);
 
-            // lock the queue tip as well now
-            WaitSema(gEndSemaId);
-
-            // can't be sure if the request was
-            gReqList = req->next;
-            free(req);
-
-            if (!gReqList)
-                gReqEnd = NULL;
-
-            SignalSema(gEndSemaId);
+            WaitSema(gQueueSemaId);
+            gReqCurrent = IO_PRIORITY_COUNT;
+            gReqActive = NULL;
+            gStats.processed++;
+            ioFreeRequest(req);
+            for (; gReqWaiters > 0; gReqWaiters--)
+                SignalSema(gReqDoneSemaId);
+            SignalSema(gQueueSemaId);
         }
-        SignalSema(gProcSemaId);
     }
 
+    LOG("IOMAN %u processed, %u coalesced, %u cancelled, peak depth %u, wait %u ms max\n",
+        gStats.processed, gStats.coalesced, gStats.cancelled, gStats.peakDepth, gStats.waitMax);
+
     // delete the pending requests
-    while (gReqList) {
-        struct io_request_t *req = gReqList;
-        gReqList = gReqList->next;
-        free(req);
-    }
+    WaitSema(gQueueSemaId);
+    dropped = ioTakeRequests(-1, NULL);
+    SignalSema(gQueueSemaId);
+    ioReleaseRequests(dropped);
 
     // delete the semaphores
-    DeleteSema(gProcSemaId);
-    DeleteSema(gEndSemaId);
+    DeleteSema(gQueueSemaId);
+    DeleteSema(gReqDoneSemaId);
 
     isIORunning = 0;
 
@@ -171,10 +364,26 @@ static void ioSimpleActionHandler(void *data)
 
 void ioInit(void)
 {
+    int i;
+
     gIOTerminate = 0;
     gHandlerCount = 0;
-    gReqList = NULL;
-    gReqEnd = NULL;
+    for (i = 0; i < IO_PRIORITY_COUNT; i++) {
+        gReqList[i] = NULL;
+        gReqEnd[i] = NULL;
+    }
+    gReqCurrent = IO_PRIORITY_COUNT;
+    gReqActive = NULL;
+    gReqWaiters = 0;
+
+    gReqFree = NULL;
+    for (i = MAX_IO_REQUESTS - 1; i >= 0; i--) {
+        gReqPool[i].next = gReqFree;
+        gReqFree = &gReqPool[i];
+    }
+
+    memset(&gStats, 0, sizeof(gStats));
+    gWaitAvg = 0;
 
     gIOThreadId = 0;
 
@@ -182,10 +391,14 @@ void ioInit(void)
     gQueueSema.max_count = 1;
     gQueueSema.option = 0;
 
-    gProcSemaId = CreateSema(&gQueueSema);
-    gEndSemaId = CreateSema(&gQueueSema);
+    gQueueSemaId = CreateSema(&gQueueSema);
     gIOPrintfSemaId = CreateSema(&gQueueSema);
 
+    gReqDoneSema.init_count = 0;
+    gReqDoneSema.max_count = MAX_IO_REQUESTS;
+    gReqDoneSema.option = 0;
+    gReqDoneSemaId = CreateSema(&gReqDoneSema);
+
     // default custom simple action handler
     ioRegisterHandler(IO_CUSTOM_SIMPLEACTION, &ioSimpleActionHandler);
 
@@ -201,8 +414,12 @@ void ioInit(void)
     StartThread(gIOThreadId, NULL);
 }
 
-int ioPutRequest(int type, void *data)
+int ioPutRequestEx(int type, void *data, int priority, int flags, const int *token)
 {
+    struct io_request_t *req, *last;
+    unsigned int depth;
+    int p;
+
     if (isIOBlocked)
         return IO_ERR_IO_BLOCKED;
 
@@ -210,70 +427,96 @@ int ioPutRequest(int type, void *data)
     if (!ioGetHandler(type))
         return IO_ERR_INVALID_HANDLER;
 
-    WaitSema(gEndSemaId);
-
-    // We don't have to lock the tip of the queue...
-    // If it exists, it won't be touched, if it does not exist, it is not being processed
-    struct io_request_t *req = gReqEnd;
+    if (priority < 0 || priority >= IO_PRIORITY_COUNT)
+        priority = IO_PRIORITY_NORMAL;
+
+    WaitSema(gQueueSemaId);
+
+    if (flags & IO_REQ_COALESCE) {
+        for (p = 0; p < IO_PRIORITY_COUNT; p++) {
+            last = NULL;
+            for (req = gReqList[p]; req != NULL; last = req, req = req->next) {
+                if (req->type == type && req->data == data && !ioIsCancelled(req))
+                    break;
+            }
+
+            if (req) {
+                // Move it up if this request is more urgent.
+                if (priority < req->priority) {
+                    ioUnlinkRequest(req, last);
+                    req->priority = priority;
+                    ioAppendRequest(req);
+                }
+
+                gStats.coalesced++;
+                SignalSema(gQueueSemaId);
+                return IO_OK;
+            }
+        }
+    }
 
+    req = ioAllocRequest();
     if (!req) {
-        gReqList = (struct io_request_t *)malloc(sizeof(struct io_request_t));
-        req = gReqList;
-        gReqEnd = gReqList;
-    } else {
-        req->next = (struct io_request_t *)malloc(sizeof(struct io_request_t));
-        req = req->next;
-        gReqEnd = req;
+        SignalSema(gQueueSemaId);
+        return IO_ERR_NO_MEMORY;
     }
 
-    req->next = NULL;
     req->type = type;
     req->data = data;
+    req->token = token;
+    req->tokenValue = token ? *token : 0;
+    req->queued = clock();
+    req->priority = priority;
+    ioAppendRequest(req);
 
-    SignalSema(gEndSemaId);
+    depth = ioGetDepth();
+    if (depth > gStats.peakDepth)
+        gStats.peakDepth = depth;
+
+    SignalSema(gQueueSemaId);
 
     // Worker thread cannot wake itself up (WakeupThread will return an error), but it will find the new request before sleeping.
     WakeupThread(gIOThreadId);
     return IO_OK;
 }
 
-int ioRemoveRequests(int type)
+int ioPutRequest(int type, void *data)
 {
-    // lock the deletion sema and the queue end sema as well
-    WaitSema(gProcSemaId);
-    WaitSema(gEndSemaId);
-
-    int count = 0;
-    struct io_request_t *req = gReqList;
-    struct io_request_t *last = NULL;
+    return ioPutRequestEx(type, data, IO_PRIORITY_NORMAL, 0, NULL);
+}
 
-    while (req) {
-        if (req->type == type) {
-            struct io_request_t *next = req->next;
+int ioRemoveRequests(int type)
+{
+    struct io_request_t *dropped;
+    int wait;
 
-            if (last)
-                last->next = next;
+    WaitSema(gQueueSemaId);
+    dropped = ioTakeRequests(type, NULL);
+    // Wait for the request of that type being processed, if any. A handler cannot wait for itself.
+    wait = gReqActive != NULL && ioMatchRequest(gReqActive, type, NULL) && GetThreadId() != gIOThreadId;
+    if (wait)
+        gReqWaiters++;
+    SignalSema(gQueueSemaId);
 
-            if (req == gReqList)
-                gReqList = next;
+    if (wait)
+        WaitSema(gReqDoneSemaId);
 
-            if (req == gReqEnd)
-                gReqEnd = last;
+    return ioReleaseRequests(dropped);
+}
 
-            count++;
-            free(req);
+int ioCancelRequests(const int *token)
+{
+    struct io_request_t *dropped;
 
-            req = next;
-        } else {
-            last = req;
-            req = req->next;
-        }
-    }
+    if (!token)
+        return 0;
 
-    SignalSema(gEndSemaId);
-    SignalSema(gProcSemaId);
+    // Never waits: this is called from the draw path, and the handlers drop stale results themselves.
+    WaitSema(gQueueSemaId);
+    dropped = ioTakeRequests(-1, token);
+    SignalSema(gQueueSemaId);
 
-    return count;
+    return ioReleaseRequests(dropped);
 }
 
 void ioEnd(void)
@@ -287,25 +530,41 @@ void ioEnd(void)
 
 int ioGetPendingRequestCount(void)
 {
-    int count = 0;
+    int count;
 
-    struct io_request_t *req = gReqList;
+    WaitSema(gQueueSemaId);
+    count = ioGetDepth();
+    SignalSema(gQueueSemaId);
 
-    WaitSema(gProcSemaId);
+    return count;
+}
 
-    while (req) {
-        count++;
-        req = req->next;
-    }
+int ioHasPendingRequests(void)
+{
+    return ioHasPendingRequestsAt(IO_PRIORITY_LOW);
+}
+
+int ioHasPendingRequestsAt(int priority)
+{
+    int p;
 
-    SignalSema(gProcSemaId);
+    if (gReqCurrent <= priority)
+        return 1;
 
-    return count;
+    for (p = 0; p <= priority && p < IO_PRIORITY_COUNT; p++) {
+        if (gReqList[p] != NULL)
+            return 1;
+    }
+
+    return 0;
 }
 
-int ioHasPendingRequests(void)
+void ioGetStats(io_stats_t *stats)
 {
-    return gReqList != NULL ? 1 : 0;
+    WaitSema(gQueueSemaId);
+    *stats = gStats;
+    stats->waitAvg = (u64)(gWaitAvg / 8) * 1000 / CLOCKS_PER_SEC;
+    SignalSema(gQueueSemaId);
 }
 
 #ifdef __EESIO_DEBUG
@@ -108,6 +108,14 @@ static void deferredAudioInit(void);
 // frame counter
 static unsigned int frameCounter;
 
+// Games read by each IO_MENU_RESOLVE_DEFFERED request. The request is queued again until all games are read, so that requests queued meanwhile (e.g. for art) are not held up.
+#define MENU_RESOLVE_BATCH 4
+
+#define MENU_RESOLVE_QUEUED 0x01 // A request is queued for the mode.
+#define MENU_RESOLVE_FAILED 0x02 // A game could not be read: the list is refreshed at the end, to drop it.
+
+static unsigned char menuResolveState[MODE_COUNT];
+
 static char errorMessage[256];
 
 static opl_io_module_t list_support[MODE_COUNT];
@@ -150,6 +158,7 @@ int gYOff;
 int gOverscan;
 int gSelectButton;
 int gHDDGameListCache;
+int gTextureCache;
 int gEnableSFX;
 int gEnableBootSND;
 int gEnableBGM;
@@ -464,7 +473,7 @@ int oplPath2Mode(const char *path)
     return -1;
 }
 
-int oplGetAppImage(const char *device, char *folder, int isRelative, char *value, char *suffix, GSTEXTURE *resultTex, short psm)
+int oplGetAppImage(const char *device, char *folder, int isRelative, char *value, char *suffix, GSTEXTURE *resultTex, const tex_fit_t *fit)
 {
     int i, remaining, elfbootmode;
     char priority;
@@ -477,7 +486,7 @@ int oplGetAppImage(const char *device, char *folder, int isRelative, char *value
             listSupport = list_support[elfbootmode].support;
 
             if ((listSupport != NULL) && (listSupport->enabled)) {
-                if (listSupport->itemGetImage(listSupport, folder, isRelative, value, suffix, resultTex, psm) >= 0)
+                if (listSupport->itemGetImage(listSupport, folder, isRelative, value, suffix, resultTex, fit) >= 0)
                     return 0;
             }
         }
@@ -492,7 +501,7 @@ int oplGetAppImage(const char *device, char *folder, int isRelative, char *value
                 continue;
 
             if ((listSupport != NULL) && (listSupport->enabled) && (listSupport->appsPriority == priority)) {
-                if (listSupport->itemGetImage(listSupport, folder, isRelative, value, suffix, resultTex, psm) >= 0)
+                if (listSupport->itemGetImage(listSupport, folder, isRelative, value, suffix, resultTex, fit) >= 0)
                     return 0;
                 remaining--;
             }
@@ -696,6 +705,13 @@ static void updateMenuFromGameList(opl_io_module_t *mdl)
         gup->menu.subMenu = &mdl->subMenu;
         guiDeferUpdate(gup);
     }
+
+    // Games that could only be listed by name are read in the background.
+    menuResolveState[mdl->support->mode] &= ~MENU_RESOLVE_FAILED;
+    if ((mdl->support->itemResolve != NULL) && !(menuResolveState[mdl->support->mode] & MENU_RESOLVE_QUEUED)) {
+        if (ioPutRequestEx(IO_MENU_RESOLVE_DEFFERED, &mdl->support->mode, IO_PRIORITY_LOW, 0, NULL) == IO_OK)
+            menuResolveState[mdl->support->mode] |= MENU_RESOLVE_QUEUED;
+    }
 }
 
 void menuDeferredUpdate(void *data)
@@ -716,6 +732,36 @@ void menuDeferredUpdate(void *data)
     }
 }
 
+static void menuDeferredResolve(void *data)
+{
+    short int *mode = data;
+    int i, id, result;
+
+    menuResolveState[*mode] &= ~MENU_RESOLVE_QUEUED;
+
+    opl_io_module_t *mod = &list_support[*mode];
+    if (!mod->support || !mod->support->itemResolve)
+        return;
+
+    for (i = 0; i < MENU_RESOLVE_BATCH; i++) {
+        result = mod->support->itemResolve(mod->support, &id);
+        if (result == 0) {
+            // All games were read. Those that could not be read are now known to the cache, so refreshing the list drops them.
+            if (menuResolveState[*mode] & MENU_RESOLVE_FAILED)
+                updateMenuFromGameList(mod);
+            return;
+        }
+
+        if (result < 0) {
+            LOG("menuDeferredResolve: game %d could not be read.\n", id);
+            menuResolveState[*mode] |= MENU_RESOLVE_FAILED;
+        }
+    }
+
+    if (ioPutRequestEx(IO_MENU_RESOLVE_DEFFERED, data, IO_PRIORITY_LOW, 0, NULL) == IO_OK)
+        menuResolveState[*mode] |= MENU_RESOLVE_QUEUED;
+}
+
 #define MENU_GENERAL_UPDATE_DELAY 60
 
 static void menuUpdateHook()
@@ -729,7 +775,7 @@ static void menuUpdateHook()
     if (gAutoRefresh) {
         for (i = 0; i < MODE_COUNT; i++) {
             if ((list_support[i].support && list_support[i].support->enabled) && ((list_support[i].support->updateDelay > 0) && (frameCounter % list_support[i].support->updateDelay == 0)))
-                ioPutRequest(IO_MENU_UPDATE_DEFFERED, &list_support[i].support->mode);
+                ioPutRequestEx(IO_MENU_UPDATE_DEFFERED, &list_support[i].support->mode, IO_PRIORITY_LOW, IO_REQ_COALESCE, NULL);
         }
     }
 
@@ -737,7 +783,7 @@ static void menuUpdateHook()
     if (frameCounter % MENU_GENERAL_UPDATE_DELAY == 0) {
         for (i = 0; i < MODE_COUNT; i++) {
             if ((list_support[i].support && list_support[i].support->enabled) && (list_support[i].support->updateDelay == 0))
-                ioPutRequest(IO_MENU_UPDATE_DEFFERED, &list_support[i].support->mode);
+                ioPutRequestEx(IO_MENU_UPDATE_DEFFERED, &list_support[i].support->mode, IO_PRIORITY_LOW, IO_REQ_COALESCE, NULL);
         }
     }
 }
@@ -922,6 +968,7 @@ static void _loadConfig()
             configGetInt(configOPL, CONFIG_OPL_DISABLE_DEBUG, &gEnableDebug);
             configGetInt(configOPL, CONFIG_OPL_PS2LOGO, &gPS2Logo);
             configGetInt(configOPL, CONFIG_OPL_HDD_GAME_LIST_CACHE, &gHDDGameListCache);
+            configGetInt(configOPL, CONFIG_OPL_TEXTURE_CACHE, &gTextureCache);
             configGetStrCopy(configOPL, CONFIG_OPL_EXIT_PATH, gExitPath, sizeof(gExitPath));
             configGetInt(configOPL, CONFIG_OPL_AUTO_SORT, &gAutosort);
             configGetInt(configOPL, CONFIG_OPL_AUTO_REFRESH, &gAutoRefresh);
@@ -1079,6 +1126,7 @@ static void _saveConfig()
         configSetInt(configOPL, CONFIG_OPL_DISABLE_DEBUG, gEnableDebug);
         configSetInt(configOPL, CONFIG_OPL_PS2LOGO, gPS2Logo);
         configSetInt(configOPL, CONFIG_OPL_HDD_GAME_LIST_CACHE, gHDDGameListCache);
+        configSetInt(configOPL, CONFIG_OPL_TEXTURE_CACHE, gTextureCache);
         configSetStr(configOPL, CONFIG_OPL_EXIT_PATH, gExitPath);
         configSetInt(configOPL, CONFIG_OPL_AUTO_SORT, gAutosort);
         configSetInt(configOPL, CONFIG_OPL_AUTO_REFRESH, gAutoRefresh);
@@ -1714,6 +1762,7 @@ static void setDefaults(void)
     gEnableDebug = 0;
     gPS2Logo = 0;
     gHDDGameListCache = 0;
+    gTextureCache = 1;
     gEnableWrite = 0;
     gRememberLastPlayed = 0;
     gAutoStartLastPlayed = 9;
@@ -1783,6 +1832,7 @@ static void init(void)
 
     // handler for deffered menu updates
     ioRegisterHandler(IO_MENU_UPDATE_DEFFERED, &menuDeferredUpdate);
+    ioRegisterHandler(IO_MENU_RESOLVE_DEFFERED, &menuDeferredResolve);
     cacheInit();
 
     gSelectButton = (InitConsoleRegionData() == CONSOLE_REGION_JAPAN) ? KEY_CIRCLE : KEY_CROSS;
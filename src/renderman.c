@@ -87,16 +87,144 @@ const u64 gColFocus = GS_SETREG_RGBA(0xFF, 0xFF, 0xFF, 0x50);  // Alpha 0x50 ->
 const u64 gDefaultCol = GS_SETREG_RGBA(0x80, 0x80, 0x80, 0x80); // Special color for texture multiplication
 const u64 gDefaultAlpha = GS_SETREG_ALPHA(0, 1, 0, 1, 0);
 
+// VRAM residency of the textures: gsKit's texture manager allocates and uploads them, but it only evicts textures when it runs out of VRAM.
+// The textures are tracked here to evict the least recently used ones under a budget, and to spread out the uploads of new textures.
+#define RM_RESIDENT_MAX 128
+// Bytes of new textures that may be uploaded in one frame. A new texture drawn after that is put off to the next frame.
+#define RM_UPLOAD_BUDGET (256 * 1024)
+
+typedef struct
+{
+    GSTEXTURE *txt;
+    u32 size;      // bytes of VRAM, with the CLUT
+    u32 lastFrame; // last frame it was drawn in
+} rm_resident_t;
+
+static rm_resident_t residents[RM_RESIDENT_MAX];
+static int residentCount;
+static u32 residentBytes;
+static u32 vramBudget;
+static u32 rmFrame;
+static u32 frameUploadBytes;
+static u32 frameDeferred;
+static rm_texture_stats_t texStats;
+
+static u32 rmTextureVramSize(GSTEXTURE *txt)
+{
+    u32 size = gsKit_texture_size(txt->Width, txt->Height, txt->PSM);
+
+    if (txt->Clut)
+        size += (txt->PSM == GS_PSM_T4) ? gsKit_texture_size(8, 2, GS_PSM_CT32) : gsKit_texture_size(16, 16, GS_PSM_CT32);
+
+    return size;
+}
+
+static rm_resident_t *rmFindResident(GSTEXTURE *txt)
+{
+    int i;
+
+    for (i = 0; i < residentCount; i++) {
+        if (residents[i].txt == txt)
+            return &residents[i];
+    }
+
+    return NULL;
+}
+
+static void rmRemoveResident(rm_resident_t *resident)
+{
+    residentBytes -= resident->size;
+    *resident = residents[--residentCount];
+}
+
+// Evicts the least recently used texture that was not drawn in this frame. Returns 0 if there is none.
+static int rmEvictResident(void)
+{
+    rm_resident_t *oldest = NULL;
+    int i;
+
+    for (i = 0; i < residentCount; i++) {
+        if (residents[i].lastFrame != rmFrame && (!oldest || residents[i].lastFrame < oldest->lastFrame))
+            oldest = &residents[i];
+    }
+
+    if (!oldest)
+        return 0;
+
+    gsKit_TexManager_free(gsGlobal, oldest->txt);
+    rmRemoveResident(oldest);
+    texStats.evictions++;
+    return 1;
+}
+
+static void rmResetResidents(void)
+{
+    residentCount = 0;
+    residentBytes = 0;
+    vramBudget = __VRAM_SIZE - gsGlobal->CurrentPointer;
+}
+
+// Binds the texture for the next primitive. Returns 0 if its upload is put off to a later frame.
+static int rmBindTexture(GSTEXTURE *txt)
+{
+    rm_resident_t *resident = rmFindResident(txt);
+
+    if (!resident) {
+        u32 size = rmTextureVramSize(txt);
+
+        // At least one new texture is uploaded in each frame, whatever its size.
+        if (frameUploadBytes > 0 && frameUploadBytes + size > RM_UPLOAD_BUDGET) {
+            frameDeferred++;
+            return 0;
+        }
+
+        while ((residentBytes + size > vramBudget || residentCount == RM_RESIDENT_MAX) && rmEvictResident())
+            ;
+
+        frameUploadBytes += size;
+        if (residentCount < RM_RESIDENT_MAX) {
+            resident = &residents[residentCount++];
+            resident->txt = txt;
+            resident->size = size;
+            residentBytes += size;
+        }
+    }
+
+    if (resident)
+        resident->lastFrame = rmFrame;
+
+    gsKit_TexManager_bind(gsGlobal, txt);
+    return 1;
+}
+
 void rmInvalidateTexture(GSTEXTURE *txt)
 {
+    rm_resident_t *resident = rmFindResident(txt);
+
     gsKit_TexManager_invalidate(gsGlobal, txt);
+
+    // The texture keeps its VRAM, but its next upload must not be put off: it is still being drawn.
+    if (resident)
+        frameUploadBytes += resident->size;
 }
 
 void rmUnloadTexture(GSTEXTURE *txt)
 {
+    rm_resident_t *resident = rmFindResident(txt);
+
+    if (resident)
+        rmRemoveResident(resident);
+
     gsKit_TexManager_free(gsGlobal, txt);
 }
 
+void rmGetTextureStats(rm_texture_stats_t *stats)
+{
+    *stats = texStats;
+    stats->resident = residentBytes;
+    stats->budget = vramBudget;
+}
+
 void rmStartFrame(void)
 {
     if (hires == 0)
@@ -133,6 +261,14 @@ void rmEndFrame(void)
     }
 
     gsKit_TexManager_nextFrame(gsGlobal);
+
+    texStats.uploadBytes = frameUploadBytes;
+    if (frameUploadBytes > texStats.uploadPeak)
+        texStats.uploadPeak = frameUploadBytes;
+    texStats.deferred = frameDeferred;
+    frameUploadBytes = 0;
+    frameDeferred = 0;
+    rmFrame++;
 }
 
 static int rmOnVSync(int cause)
@@ -238,6 +374,8 @@ int rmSetMode(int force)
             gsKit_sync_flip(gsGlobal);
         }
 
+        rmResetResidents();
+
         LOG("RENDERMAN New vmode: %d, %d x %d\n", vmode, gsGlobal->Width, gsGlobal->Height);
     }
 
@@ -330,7 +468,9 @@ void rmDrawQuad(rm_quad_t *q)
         gsKit_set_test(gsGlobal, GS_ATEST_OFF);
     }
 
-    gsKit_TexManager_bind(gsGlobal, q->txt);
+    if (!rmBindTexture(q->txt))
+        return;
+
     gsKit_prim_sprite_texture(gsGlobal, q->txt,
                               q->ul.x + fRenderXOff, q->ul.y + fRenderYOff,
                               q->ul.u, q->ul.v,
@@ -365,17 +505,18 @@ void rmDrawOverlayPixmap(GSTEXTURE *overlay, int x, int y, short aligned, int w,
     else
         gsGlobal->PrimAlphaEnable = GS_SETTING_OFF;
 
-    gsKit_TexManager_bind(gsGlobal, inlay);
-    gsKit_prim_quad_texture(gsGlobal, inlay,
-                            quad.ul.x + ulx + fRenderXOff, quad.ul.y + uly + fRenderYOff,
-                            0.0f, 0.0f,
-                            quad.ul.x + urx + fRenderXOff, quad.ul.y + ury + fRenderYOff,
-                            inlay->Width, 0.0f,
-                            quad.ul.x + blx + fRenderXOff, quad.ul.y + bly + fRenderYOff,
-                            0.0f, inlay->Height,
-                            quad.ul.x + brx + fRenderXOff, quad.ul.y + bry + fRenderYOff,
-                            inlay->Width, inlay->Height, order, gDefaultCol);
-    order++;
+    if (rmBindTexture(inlay)) {
+        gsKit_prim_quad_texture(gsGlobal, inlay,
+                                quad.ul.x + ulx + fRenderXOff, quad.ul.y + uly + fRenderYOff,
+                                0.0f, 0.0f,
+                                quad.ul.x + urx + fRenderXOff, quad.ul.y + ury + fRenderYOff,
+                                inlay->Width, 0.0f,
+                                quad.ul.x + blx + fRenderXOff, quad.ul.y + bly + fRenderYOff,
+                                0.0f, inlay->Height,
+                                quad.ul.x + brx + fRenderXOff, quad.ul.y + bry + fRenderYOff,
+                                inlay->Width, inlay->Height, order, gDefaultCol);
+        order++;
+    }
 
     rmDrawQuad(&quad);
 }
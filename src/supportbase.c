@@ -13,7 +13,7 @@
 #include "include/gui.h"
 
 #define NEWLIB_PORT_AWARE
-#include <fileXio_rpc.h> // fileXioMount("iso:", ***), fileXioUmount("iso:")
+#include <fileXio_rpc.h> // fileXioMount("iso:", ***), fileXioUmount("iso:"), fileXioDread()
 #include <io_common.h>   // FIO_MT_RDONLY
 #include <ps2sdkapi.h>   // lseek64
 
@@ -26,10 +26,49 @@ struct game_list_t
     struct game_list_t *next;
 };
 
+/* games.bin caches the startup IDs of the ISO images found in a directory, so that they do not have to be mounted every time the list is refreshed.
+   It starts with a header, followed by fixed-size slots. Each slot is keyed by the hash of the filename, the file size and the modification time,
+   so an image that was replaced is noticed. Slots are updated in place, so only the entries that changed are written back. */
+#define GAME_CACHE_MAGIC   0x43424C4F // "OLBC"
+#define GAME_CACHE_VERSION 2
+
+struct game_cache_header
+{
+    u32 magic;
+    u16 version;
+    u16 entry_size; // sizeof(struct game_cache_entry)
+    u32 count;      // Number of slots, including free ones.
+    u32 reserved;
+};
+
+struct game_cache_entry
+{
+    u32 hash; // Hash of the filename. 0 = free slot.
+    u32 size; // File size and modification time, as returned by the device.
+    u32 hisize;
+    u8 mtime[8];
+    u32 flags; // GAME_CACHE_ENTRY_*
+    base_game_info_t info;
+};
+
+#define GAME_CACHE_ENTRY_UNREADABLE 0x01 // SYSTEM.CNF could not be read. Tried again when the list is read again.
+
+#define GAME_CACHE_SEEN  0x01 // The file is still in the directory.
+#define GAME_CACHE_DIRTY 0x02 // The slot has to be written back.
+
+#define SB_RESOLVE_SAVE_INTERVAL 8 // Games resolved by sbResolveGame() between two updates of games.bin.
+
 struct game_cache_list
 {
-    unsigned int count;
-    base_game_info_t *games;
+    char path[256];     // Folder that holds games.bin.
+    unsigned int count; // Slots
+    unsigned int saved; // Slots in games.bin.
+    unsigned int freeHint; // No free slot before this one.
+    struct game_cache_entry *games;
+    u8 *state;  // GAME_CACHE_* flags, one per slot.
+    int *index; // Open-addressed hash table of slot numbers (-1 = empty).
+    unsigned int indexMask;
+    int valid; // games.bin exists and is in the current format, so it can be updated in place.
 };
 
 int sbIsSameSize(const char *prefix, int prevSize)
@@ -131,247 +170,575 @@ static int GetStartupExecName(const char *path, char *filename, int maxlength)
 
 static void freeISOGameListCache(struct game_cache_list *cache);
 
+// FNV-1a
+static u32 hashISOGameListCache(const char *filename)
+{
+    u32 hash = 0x811C9DC5;
+
+    while (*filename != '\0') {
+        hash ^= (u8)*filename++;
+        hash *= 0x01000193;
+    }
+
+    return hash != 0 ? hash : 1; // 0 marks a free slot.
+}
+
+static int indexISOGameListCache(struct game_cache_list *cache)
+{
+    unsigned int i, size, pos;
+
+    free(cache->index);
+
+    // Keep the table at most half full.
+    for (size = 16; size < cache->count * 2; size <<= 1)
+        ;
+
+    if ((cache->index = malloc(size * sizeof(int))) == NULL)
+        return ENOMEM;
+    cache->indexMask = size - 1;
+    memset(cache->index, 0xFF, size * sizeof(int));
+
+    for (i = 0; i < cache->count; i++) {
+        if (cache->games[i].hash == 0)
+            continue;
+
+        for (pos = cache->games[i].hash & cache->indexMask; cache->index[pos] >= 0; pos = (pos + 1) & cache->indexMask)
+            ;
+        cache->index[pos] = i;
+    }
+
+    return 0;
+}
+
 static int loadISOGameListCache(const char *path, struct game_cache_list *cache)
 {
     char filename[256];
+    struct game_cache_header header;
     FILE *file;
-    base_game_info_t *games;
-    int result, size, count;
+    int result;
 
     freeISOGameListCache(cache);
+    strncpy(cache->path, path, sizeof(cache->path) - 1);
+    cache->path[sizeof(cache->path) - 1] = '\0';
 
     sprintf(filename, "%s/games.bin", path);
     file = fopen(filename, "rb");
     if (file != NULL) {
-        fseek(file, 0, SEEK_END);
-        size = ftell(file);
-        rewind(file);
+        if (fread(&header, sizeof(header), 1, file) == 1 && header.magic == GAME_CACHE_MAGIC && header.version == GAME_CACHE_VERSION && header.entry_size == sizeof(struct game_cache_entry)) {
+            cache->count = header.count;
+            cache->games = malloc(header.count * sizeof(struct game_cache_entry));
+            cache->state = calloc(header.count, 1);
 
-        count = size / sizeof(base_game_info_t);
-        if (count > 0) {
-            games = memalign(64, count * sizeof(base_game_info_t));
-            if (games != NULL) {
-                if (fread(games, sizeof(base_game_info_t), count, file) == count) {
-                    LOG("loadISOGameListCache: %d games loaded.\n", count);
-                    cache->count = count;
-                    cache->games = games;
-                    result = 0;
-                } else {
-                    LOG("loadISOGameListCache: I/O error.\n");
-                    free(games);
-                    result = EIO;
-                }
-            } else {
+            if (header.count > 0 && (cache->games == NULL || cache->state == NULL)) {
                 LOG("loadISOGameListCache: failed to allocate memory.\n");
                 result = ENOMEM;
-            }
+            } else if (fread(cache->games, sizeof(struct game_cache_entry), header.count, file) != header.count) {
+                LOG("loadISOGameListCache: I/O error.\n");
+                result = EIO;
+            } else
+                result = 0;
         } else {
-            result = -1; // Empty file (should not happen)
+            LOG("loadISOGameListCache: unsupported format, rebuilding.\n");
+            result = EINVAL;
         }
 
         fclose(file);
+
+        if (result == 0) {
+            LOG("loadISOGameListCache: %u slots loaded.\n", cache->count);
+            cache->saved = cache->count;
+            cache->valid = 1;
+        } else {
+            free(cache->games);
+            free(cache->state);
+            cache->games = NULL;
+            cache->state = NULL;
+            cache->count = 0;
+        }
     } else {
         result = ENOENT;
     }
 
-    return result;
+    // An empty index is needed to add entries, even without games.bin.
+    return indexISOGameListCache(cache) == 0 ? result : ENOMEM;
 }
 
 static void freeISOGameListCache(struct game_cache_list *cache)
 {
-    if (cache->games != NULL) {
-        free(cache->games);
-        cache->games = NULL;
-        cache->count = 0;
-    }
+    free(cache->games);
+    free(cache->state);
+    free(cache->index);
+    memset(cache, 0, sizeof(struct game_cache_list));
 }
 
-static int updateISOGameList(const char *path, const struct game_cache_list *cache, const struct game_list_t *head, int count)
+// Queries for the slot of the file, by its name (NameLen characters of name, followed by the extension). Only the new filename format is supported (filename.ext).
+static int queryISOGameListCache(const struct game_cache_list *cache, u32 hash, const char *filename, int NameLen)
 {
-    char filename[256];
-    FILE *file;
-    const struct game_list_t *game;
-    int result, i, j, modified;
-    base_game_info_t *list;
+    const struct game_cache_entry *entry;
+    unsigned int pos;
+    int slot;
 
-    modified = 0;
-    if (cache != NULL) {
-        if ((head != NULL) && (count > 0)) {
-            game = head;
-
-            for (i = 0; i < count; i++) {
-                for (j = 0; j < cache->count; j++) {
-                    if (strncmp(cache->games[i].name, game->gameinfo.name, ISO_GAME_NAME_MAX + 1) == 0 && strncmp(cache->games[i].extension, game->gameinfo.extension, ISO_GAME_EXTENSION_MAX + 1) == 0)
-                        break;
-                }
+    if (cache->index == NULL)
+        return -1;
 
-                if (j == cache->count) {
-                    LOG("updateISOGameList: game added.\n");
-                    modified = 1;
-                    break;
-                }
+    for (pos = hash & cache->indexMask; (slot = cache->index[pos]) >= 0; pos = (pos + 1) & cache->indexMask) {
+        entry = &cache->games[slot];
+
+        if (entry->hash == hash && strncmp(entry->info.name, filename, NameLen) == 0 && entry->info.name[NameLen] == '\0' && strcmp(entry->info.extension, &filename[NameLen]) == 0)
+            return slot;
+    }
 
-                game = game->next;
+    return -1;
+}
+
+// Stores the entry of a file into its slot. Files that are not cached yet are given a free slot, or one appended to the cache.
+static int storeISOGameListCache(struct game_cache_list *cache, const struct game_cache_entry *entry)
+{
+    char filename[ISO_GAME_FNAME_MAX + 1];
+    struct game_cache_entry *games;
+    unsigned int i, slots, pos;
+    u8 *state;
+    int slot;
+
+    if (cache->index == NULL)
+        return ENOMEM;
+
+    snprintf(filename, sizeof(filename), "%s%s", entry->info.name, entry->info.extension);
+    if ((slot = queryISOGameListCache(cache, entry->hash, filename, strlen(entry->info.name))) < 0) {
+        for (i = cache->freeHint; i < cache->count && cache->games[i].hash != 0; i++)
+            ;
+
+        if (i == cache->count) {
+            // Grow by a few slots at once. The new slots are written out as free slots, so the file always holds every slot.
+            slots = cache->count + 16;
+            if ((games = realloc(cache->games, slots * sizeof(struct game_cache_entry))) == NULL)
+                return ENOMEM;
+            cache->games = games;
+            if ((state = realloc(cache->state, slots)) == NULL)
+                return ENOMEM;
+            cache->state = state;
+
+            for (; cache->count < slots; cache->count++) {
+                cache->games[cache->count].hash = 0;
+                cache->state[cache->count] = GAME_CACHE_DIRTY;
             }
+        }
+
+        slot = i;
+        cache->freeHint = i + 1;
+        cache->games[slot].hash = entry->hash;
 
-            if ((!modified) && (count != cache->count)) {
-                LOG("updateISOGameList: game removed.\n");
-                modified = 1;
+        if (cache->count * 2 > cache->indexMask + 1) {
+            if (indexISOGameListCache(cache) != 0) {
+                cache->games[slot].hash = 0;
+                return ENOMEM;
             }
         } else {
-            modified = 0;
+            for (pos = entry->hash & cache->indexMask; cache->index[pos] >= 0; pos = (pos + 1) & cache->indexMask)
+                ;
+            cache->index[pos] = slot;
         }
-    } else {
-        modified = ((head != NULL) && (count > 0)) ? 1 : 0;
+    }
+
+    memcpy(&cache->games[slot], entry, sizeof(struct game_cache_entry));
+    cache->state[slot] |= GAME_CACHE_SEEN | GAME_CACHE_DIRTY;
+
+    return 0;
+}
+
+// Frees the slots of the files that are gone and writes the modified slots back.
+static int updateISOGameList(struct game_cache_list *cache)
+{
+    char filename[256];
+    struct game_cache_header header;
+    FILE *file;
+    unsigned int i, j, live;
+    int result, modified;
+
+    modified = 0;
+    live = 0;
+    for (i = 0; i < cache->count; i++) {
+        if (cache->games[i].hash != 0 && !(cache->state[i] & GAME_CACHE_SEEN)) {
+            LOG("updateISOGameList: game removed.\n");
+            cache->games[i].hash = 0;
+            cache->state[i] |= GAME_CACHE_DIRTY;
+            if (i < cache->freeHint)
+                cache->freeHint = i;
+        }
+
+        if (cache->games[i].hash != 0)
+            live++;
+        if (cache->state[i] & GAME_CACHE_DIRTY)
+            modified = 1;
     }
 
     if (!modified)
         return 0;
-    LOG("updateISOGameList: caching new game list.\n");
 
-    result = 0;
-    sprintf(filename, "%s/games.bin", path);
-    if ((head != NULL) && (count > 0)) {
-        list = (base_game_info_t *)memalign(64, sizeof(base_game_info_t) * count);
-
-        if (list != NULL) {
-            // Convert the linked list into a flat array, for writing performance.
-            game = head;
-            for (i = 0; (i < count) && (game != NULL); i++, game = game->next) {
-                // copy one game, advance
-                memcpy(&list[i], &game->gameinfo, sizeof(base_game_info_t));
+    snprintf(filename, sizeof(filename), "%s/games.bin", cache->path);
+    if (live == 0) {
+        // Last game deleted.
+        remove(filename);
+        result = 0;
+    } else {
+        header.magic = GAME_CACHE_MAGIC;
+        header.version = GAME_CACHE_VERSION;
+        header.entry_size = sizeof(struct game_cache_entry);
+        header.count = cache->count;
+        header.reserved = 0;
+
+        result = 0;
+        if (cache->valid && (file = fopen(filename, "r+b")) != NULL) {
+            LOG("updateISOGameList: updating the game list cache.\n");
+
+            if (cache->count != cache->saved)
+                result = fwrite(&header, sizeof(header), 1, file) == 1 ? 0 : EIO;
+
+            // Write each run of modified slots with one call.
+            for (i = 0; i < cache->count && result == 0; i = j) {
+                if (!(cache->state[i] & GAME_CACHE_DIRTY)) {
+                    j = i + 1;
+                    continue;
+                }
+
+                for (j = i + 1; j < cache->count && (cache->state[j] & GAME_CACHE_DIRTY); j++)
+                    ;
+
+                if (fseek(file, sizeof(header) + i * sizeof(struct game_cache_entry), SEEK_SET) != 0 || fwrite(&cache->games[i], sizeof(struct game_cache_entry), j - i, file) != j - i)
+                    result = EIO;
             }
 
-            file = fopen(filename, "wb");
-            if (file != NULL) {
-                result = fwrite(list, sizeof(base_game_info_t), count, file) == count ? 0 : EIO;
+            fclose(file);
+        } else {
+            LOG("updateISOGameList: caching new game list.\n");
+
+            if ((file = fopen(filename, "wb")) != NULL) {
+                if (fwrite(&header, sizeof(header), 1, file) != 1 || fwrite(cache->games, sizeof(struct game_cache_entry), cache->count, file) != cache->count)
+                    result = EIO;
 
                 fclose(file);
-
-                if (result != 0)
-                    remove(filename);
             } else
                 result = EIO;
+        }
 
-            free(list);
-        } else
-            result = ENOMEM;
-    } else {
-        // Last game deleted.
-        remove(filename);
+        if (result != 0)
+            remove(filename);
     }
 
+    cache->valid = (result == 0 && live > 0);
+    cache->saved = cache->valid ? cache->count : 0;
+    for (i = 0; i < cache->count; i++)
+        cache->state[i] &= ~GAME_CACHE_DIRTY;
+
     return result;
 }
 
-// Queries for the game entry, based on filename. Only the new filename format is supported (filename.ext).
-static int queryISOGameListCache(const struct game_cache_list *cache, base_game_info_t *ginfo, const char *filename)
+static int getISOStartup(const char *path, char *startup)
 {
-    char isoname[ISO_GAME_FNAME_MAX + 1];
-    int i;
-
-    for (i = 0; i < cache->count; i++) {
-        snprintf(isoname, sizeof(isoname), "%s%s", cache->games[i].name, cache->games[i].extension);
+    int result;
 
-        if (strcmp(filename, isoname) == 0) {
-            memcpy(ginfo, &cache->games[i], sizeof(base_game_info_t));
-            return 0;
-        }
-    }
+    if (fileXioMount("iso:", path, FIO_MT_RDONLY) >= 0)
+        result = GetStartupExecName("iso:/SYSTEM.CNF;1", startup, GAME_STARTUP_MAX - 1);
+    else
+        result = -ENOENT;
+    fileXioUmount("iso:");
 
-    return ENOENT;
+    return result;
 }
 
-static int scanForISO(char *path, char type, struct game_list_t **glist)
+/* Lists the ISO images in the folder, with the startup IDs cached in games.bin. Images that are not in the cache (or were modified)
+   are listed with an empty startup ID, to be read by sbResolveGame(). So are the images that could not be read before, unless skipUnreadable is set.
+   The cache is kept, for sbResolveGame() to update. */
+static int scanForISO(char *path, char type, struct game_list_t **glist, struct game_cache_list *cache, int skipUnreadable)
 {
     int count = 0;
-    struct game_cache_list cache = {0, NULL};
-    base_game_info_t cachedGInfo;
-    char fullpath[256];
-    struct dirent *dirent;
-    DIR *dir;
-
-    int cacheLoaded = loadISOGameListCache(path, &cache) == 0;
+    struct game_cache_entry *entry;
+    base_game_info_t game;
+    iox_dirent_t dirent;
+    int fd;
 
-    if ((dir = opendir(path)) != NULL) {
-        size_t base_path_len = strlen(path);
-        strcpy(fullpath, path);
-        fullpath[base_path_len] = '/';
+    loadISOGameListCache(path, cache);
 
-        while ((dirent = readdir(dir)) != NULL) {
+    if ((fd = fileXioDopen(path)) >= 0) {
+        while (fileXioDread(fd, &dirent) > 0) {
             int NameLen;
-            int format = isValidIsoName(dirent->d_name, &NameLen);
+            int format = isValidIsoName(dirent.name, &NameLen);
 
             if (format <= 0 || NameLen > ISO_GAME_NAME_MAX)
                 continue; // Skip files that cannot be supported properly.
 
-            strcpy(fullpath + base_path_len + 1, dirent->d_name);
+            memset(&game, 0, sizeof(base_game_info_t));
+
+            if (format == GAME_FORMAT_OLD_ISO) {
+                // old iso format can't be cached
+                strncpy(game.name, &dirent.name[GAME_STARTUP_MAX], NameLen);
+                game.name[NameLen] = '\0';
+                strncpy(game.startup, dirent.name, GAME_STARTUP_MAX - 1);
+                game.startup[GAME_STARTUP_MAX - 1] = '\0';
+                strncpy(game.extension, &dirent.name[GAME_STARTUP_MAX + NameLen], sizeof(game.extension) - 1);
+                game.extension[sizeof(game.extension) - 1] = '\0';
+            } else {
+                int slot = queryISOGameListCache(cache, hashISOGameListCache(dirent.name), dirent.name, NameLen);
+
+                if (slot >= 0) {
+                    cache->state[slot] |= GAME_CACHE_SEEN;
+                    entry = &cache->games[slot];
+                } else
+                    entry = NULL;
+
+                if (entry != NULL && entry->size == dirent.stat.size && entry->hisize == dirent.stat.hisize && memcmp(entry->mtime, dirent.stat.mtime, sizeof(entry->mtime)) == 0 && entry->info.startup[0] != '\0') {
+                    // use cached entry
+                    memcpy(&game, &entry->info, sizeof(base_game_info_t));
+                } else if (entry != NULL && (entry->flags & GAME_CACHE_ENTRY_UNREADABLE) && skipUnreadable) {
+                    continue; // Could not be read again just now.
+                } else {
+                    // SYSTEM.CNF has to be read: list the game by name for now.
+                    strncpy(game.name, dirent.name, NameLen);
+                    game.name[NameLen] = '\0';
+                    strncpy(game.extension, &dirent.name[NameLen], sizeof(game.extension) - 1);
+                    game.extension[sizeof(game.extension) - 1] = '\0';
+                }
+            }
 
             struct game_list_t *next = malloc(sizeof(struct game_list_t));
             if (!next)
                 break; // Out of memory
 
+            memcpy(&next->gameinfo, &game, sizeof(base_game_info_t));
+            next->gameinfo.parts = 1;
+            next->gameinfo.media = type;
+            next->gameinfo.format = format;
+            next->gameinfo.sizeMB = 0;
             next->next = *glist;
             *glist = next;
-            base_game_info_t *game = &next->gameinfo;
-            memset(game, 0, sizeof(base_game_info_t));
 
-            if (format == GAME_FORMAT_OLD_ISO) {
-                // old iso format can't be cached
-                strncpy(game->name, &dirent->d_name[GAME_STARTUP_MAX], NameLen);
-                game->name[NameLen] = '\0';
-                strncpy(game->startup, dirent->d_name, GAME_STARTUP_MAX - 1);
-                game->startup[GAME_STARTUP_MAX - 1] = '\0';
-                strncpy(game->extension, &dirent->d_name[GAME_STARTUP_MAX + NameLen], sizeof(game->extension) - 1);
-                game->extension[sizeof(game->extension) - 1] = '\0';
-            } else if (cacheLoaded && queryISOGameListCache(&cache, &cachedGInfo, dirent->d_name) == 0) {
-                // use cached entry
-                memcpy(game, &cachedGInfo, sizeof(base_game_info_t));
-            } else {
-                // need to mount and read SYSTEM.CNF
-                char startup[GAME_STARTUP_MAX];
-                int MountFD = fileXioMount("iso:", fullpath, FIO_MT_RDONLY);
-
-                if (MountFD < 0 || GetStartupExecName("iso:/SYSTEM.CNF;1", startup, GAME_STARTUP_MAX - 1) != 0) {
-                    fileXioUmount("iso:");
-                    *glist = next->next;
-                    free(next);
-                    continue;
-                }
+            count++;
+        }
+        fileXioDclose(fd);
+    }
 
-                strcpy(game->startup, startup);
-                strncpy(game->name, dirent->d_name, NameLen);
-                game->name[NameLen] = '\0';
-                strncpy(game->extension, &dirent->d_name[NameLen], sizeof(game->extension) - 1);
-                game->extension[sizeof(game->extension) - 1] = '\0';
+    updateISOGameList(cache);
 
-                fileXioUmount("iso:");
-            }
+    return count;
+}
 
-            game->parts = 1;
-            game->media = type;
-            game->format = format;
-            game->sizeMB = 0;
+int sbResolveGame(base_game_info_t *game, const char *prefix, sb_resolve_t *resolve)
+{
+    struct game_cache_list *cache;
+    struct game_cache_entry entry;
+    char path[256], startup[GAME_STARTUP_MAX];
+    iox_stat_t stat;
+    int result;
+
+    snprintf(path, sizeof(path), "%s%s/%s%s", prefix, (game->media == SCECdPS2CD) ? "CD" : "DVD", game->name, game->extension);
+    if ((result = getISOStartup(path, startup)) != 0)
+        startup[0] = '\0';
+
+    // Cache the result, including failures. Unreadable images are tried again when the list is read again.
+    cache = resolve->cache[(game->media == SCECdPS2CD) ? 0 : 1];
+    if (cache != NULL && fileXioGetStat(path, &stat) >= 0) {
+        snprintf(path, sizeof(path), "%s%s", game->name, game->extension);
+        entry.hash = hashISOGameListCache(path);
+        entry.size = stat.size;
+        entry.hisize = stat.hisize;
+        memcpy(entry.mtime, stat.mtime, sizeof(entry.mtime));
+        entry.flags = (result != 0) ? GAME_CACHE_ENTRY_UNREADABLE : 0;
+        memcpy(&entry.info, game, sizeof(base_game_info_t));
+        strcpy(entry.info.startup, startup);
+
+        if (storeISOGameListCache(cache, &entry) == 0 && ++resolve->unsaved >= SB_RESOLVE_SAVE_INTERVAL) {
+            updateISOGameList(resolve->cache[0]);
+            updateISOGameList(resolve->cache[1]);
+            resolve->unsaved = 0;
+        }
+    }
 
-            count++;
+    if (result == 0) {
+        // The list is read by the GUI thread: write the first character last, so that a partial ID is never seen.
+        strcpy(&game->startup[1], &startup[1]);
+        game->startup[0] = startup[0];
+    }
+
+    return result;
+}
+
+int sbResolveNext(base_game_info_t *list, const char *prefix, int gamecount, sb_resolve_t *resolve, int *id)
+{
+    base_game_info_t *game;
+
+    while (resolve->next < gamecount) {
+        game = &list[resolve->next++];
+
+        if (game->format == GAME_FORMAT_ISO && game->startup[0] == '\0') {
+            *id = resolve->next - 1;
+            if (sbResolveGame(game, prefix, resolve) == 0)
+                return 1;
+            resolve->failed++;
+            return -1;
         }
-        closedir(dir);
     }
 
-    if (cacheLoaded) {
-        updateISOGameList(path, &cache, *glist, count);
-        freeISOGameListCache(&cache);
-    } else {
-        updateISOGameList(path, NULL, *glist, count);
+    // The list is read again to drop the games that could not be read: do not try them again then.
+    resolve->skipUnreadable = resolve->failed > 0;
+
+    sbFreeResolve(resolve);
+
+    return 0;
+}
+
+void sbFreeResolve(sb_resolve_t *resolve)
+{
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        if (resolve->cache[i] != NULL) {
+            if (resolve->unsaved > 0)
+                updateISOGameList(resolve->cache[i]);
+            freeISOGameListCache(resolve->cache[i]);
+            free(resolve->cache[i]);
+            resolve->cache[i] = NULL;
+        }
     }
 
-    return count;
+    resolve->unsaved = 0;
+}
+
+/* The size of a ul.cfg game is the total size of its parts, which all have to be looked up. ulcache.bin keeps these sizes,
+   along with the size and modification time of ul.cfg. If ul.cfg was not modified, the sizes are used as they are.
+   Otherwise, the sizes of the games that are still listed are kept and only the others are looked up. */
+#define UL_CACHE_MAGIC   0x43554C4F // "OLUC"
+#define UL_CACHE_VERSION 1
+
+struct ul_cache_header
+{
+    u32 magic;
+    u16 version;
+    u16 entry_size; // sizeof(struct ul_cache_entry)
+    u32 count;
+    u32 cfgsize; // Size and modification time of ul.cfg.
+    u8 cfgmtime[8];
+};
+
+struct ul_cache_entry
+{
+    u32 crc; // USBA_crc32() of the name.
+    char startup[GAME_STARTUP_MAX];
+    u8 parts;
+    u8 media;
+    u16 reserved;
+    u32 sizeMB;
+};
+
+static int matchULCache(const struct ul_cache_entry *entry, u32 crc, const base_game_info_t *game)
+{
+    return (entry->crc == crc && entry->parts == game->parts && entry->media == game->media && memcmp(entry->startup, game->startup, GAME_STARTUP_MAX) == 0);
+}
+
+static u32 getULGameSize(const char *prefix, const base_game_info_t *game, u32 crc)
+{
+    char path[256];
+    iox_stat_t stat;
+    u64 size;
+    int part;
+
+    size = 0;
+    for (part = 0; part < game->parts; part++) {
+        snprintf(path, sizeof(path), "%sul.%08X.%s.%02x", prefix, crc, game->startup, part);
+        if (fileXioGetStat(path, &stat) < 0)
+            break;
+        size += ((u64)stat.hisize << 32) | stat.size;
+    }
+
+    return size >> 20;
 }
 
-int sbReadList(base_game_info_t **list, const char *prefix, int *fsize, int *gamecount)
+static void sbReadULSizes(const char *prefix, base_game_info_t *games, int count)
+{
+    char path[256];
+    struct ul_cache_header header;
+    struct ul_cache_entry *cached, *entries;
+    iox_stat_t stat;
+    FILE *file;
+    int i, j, valid, modified;
+    u32 crc;
+
+    snprintf(path, sizeof(path), "%sul.cfg", prefix);
+    if (fileXioGetStat(path, &stat) < 0)
+        memset(&stat, 0, sizeof(stat));
+
+    if ((entries = malloc(count * sizeof(struct ul_cache_entry))) == NULL)
+        return;
+
+    cached = NULL;
+    valid = 0;
+    header.count = 0;
+    snprintf(path, sizeof(path), "%sulcache.bin", prefix);
+    if ((file = fopen(path, "rb")) != NULL) {
+        if (fread(&header, sizeof(header), 1, file) == 1 && header.magic == UL_CACHE_MAGIC && header.version == UL_CACHE_VERSION && header.entry_size == sizeof(struct ul_cache_entry)) {
+            if ((cached = malloc(header.count * sizeof(struct ul_cache_entry))) != NULL && fread(cached, sizeof(struct ul_cache_entry), header.count, file) == header.count)
+                valid = (header.cfgsize == stat.size && memcmp(header.cfgmtime, stat.mtime, sizeof(header.cfgmtime)) == 0 && header.count == count);
+            else {
+                free(cached);
+                cached = NULL;
+                header.count = 0;
+            }
+        } else
+            header.count = 0;
+        fclose(file);
+    }
+
+    modified = !valid;
+    for (i = 0; i < count; i++) {
+        crc = USBA_crc32(games[i].name);
+
+        // Games usually keep their place in ul.cfg, so look there first.
+        if (i < header.count && matchULCache(&cached[i], crc, &games[i]))
+            j = i;
+        else {
+            for (j = 0; j < header.count && !matchULCache(&cached[j], crc, &games[i]); j++)
+                ;
+        }
+
+        if (j < header.count)
+            memcpy(&entries[i], &cached[j], sizeof(struct ul_cache_entry));
+        else {
+            entries[i].crc = crc;
+            memcpy(entries[i].startup, games[i].startup, GAME_STARTUP_MAX);
+            entries[i].parts = games[i].parts;
+            entries[i].media = games[i].media;
+            entries[i].reserved = 0;
+            entries[i].sizeMB = getULGameSize(prefix, &games[i], crc);
+            modified = 1;
+        }
+
+        games[i].sizeMB = entries[i].sizeMB;
+    }
+    free(cached);
+
+    if (modified) {
+        header.magic = UL_CACHE_MAGIC;
+        header.version = UL_CACHE_VERSION;
+        header.entry_size = sizeof(struct ul_cache_entry);
+        header.count = count;
+        header.cfgsize = stat.size;
+        memcpy(header.cfgmtime, stat.mtime, sizeof(header.cfgmtime));
+
+        if ((file = fopen(path, "wb")) != NULL) {
+            valid = (fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(entries, sizeof(struct ul_cache_entry), count, file) == count);
+            fclose(file);
+
+            if (!valid)
+                remove(path);
+        }
+    }
+
+    free(entries);
+}
+
+int sbReadList(base_game_info_t **list, const char *prefix, int *fsize, int *gamecount, sb_resolve_t *resolve)
 {
     int fd, size, id = 0, result;
-    int count;
+    int count, skipUnreadable;
     char path[256];
 
     free(*list);
@@ -379,16 +746,29 @@ int sbReadList(base_game_info_t **list, const char *prefix, int *fsize, int *gam
     *fsize = -1;
     *gamecount = 0;
 
+    // Games that were still being resolved are listed again.
+    sbFreeResolve(resolve);
+    resolve->next = 0;
+    resolve->failed = 0;
+    skipUnreadable = resolve->skipUnreadable;
+    resolve->skipUnreadable = 0;
+    resolve->cache[0] = calloc(1, sizeof(struct game_cache_list));
+    resolve->cache[1] = calloc(1, sizeof(struct game_cache_list));
+    if (resolve->cache[0] == NULL || resolve->cache[1] == NULL) {
+        sbFreeResolve(resolve);
+        return -ENOMEM;
+    }
+
     // temporary storage for the game names
     struct game_list_t *dlist_head = NULL;
 
     // count iso games in "cd" directory
     snprintf(path, sizeof(path), "%sCD", prefix);
-    count = scanForISO(path, SCECdPS2CD, &dlist_head);
+    count = scanForISO(path, SCECdPS2CD, &dlist_head, resolve->cache[0], skipUnreadable);
 
     // count iso games in "dvd" directory
     snprintf(path, sizeof(path), "%sDVD", prefix);
-    if ((result = scanForISO(path, SCECdPS2DVD, &dlist_head)) >= 0) {
+    if ((result = scanForISO(path, SCECdPS2DVD, &dlist_head, resolve->cache[1], skipUnreadable)) >= 0) {
         count = count < 0 ? result : count + result;
     }
 
@@ -396,53 +776,46 @@ int sbReadList(base_game_info_t **list, const char *prefix, int *fsize, int *gam
     snprintf(path, sizeof(path), "%sul.cfg", prefix);
     fd = openFile(path, O_RDONLY);
     if (fd >= 0) {
-        USBExtreme_game_entry_t GameEntry;
+        USBExtreme_game_entry_t *GameEntries;
+        int ulcount;
 
         if (count < 0)
             count = 0;
         size = getFileSize(fd);
         *fsize = size;
-        count += size / sizeof(USBExtreme_game_entry_t);
+        ulcount = size / sizeof(USBExtreme_game_entry_t);
+        count += ulcount;
 
         if (count > 0) {
             if ((*list = (base_game_info_t *)malloc(sizeof(base_game_info_t) * count)) != NULL) {
                 memset(*list, 0, sizeof(base_game_info_t) * count);
 
-                while (size > 0) {
-                    base_game_info_t *g = &(*list)[id++];
-
-                    // populate game entry in list even if entry corrupted
-                    read(fd, &GameEntry, sizeof(USBExtreme_game_entry_t));
-                    size -= sizeof(USBExtreme_game_entry_t);
-
-                    // to ensure no leaks happen, we copy manually and pad the strings
-                    memcpy(g->name, GameEntry.name, UL_GAME_NAME_MAX);
-                    g->name[UL_GAME_NAME_MAX] = '\0';
-                    memcpy(g->startup, GameEntry.startup, GAME_STARTUP_MAX);
-                    g->startup[GAME_STARTUP_MAX] = '\0';
-                    g->extension[0] = '\0';
-                    g->parts = GameEntry.parts;
-                    g->media = GameEntry.media;
-                    g->format = GAME_FORMAT_USBLD;
-                    g->sizeMB = 0;
-
-                    /* TODO: size calculation is very slow
-                    implmented some caching, or do not touch at all */
-
-                    // calculate total size for individual game
-                    /*int ulfd = 1;
-                    u8 part;
-                    unsigned int name_checksum = USBA_crc32(g->name);
-
-                    for (part = 0; part < g->parts && ulfd >= 0; part++) {
-                        snprintf(path, sizeof(path), "%sul.%08X.%s.%02x", prefix, name_checksum, g->startup, part);
-                        ulfd = openFile(path, O_RDONLY);
-                        if (ulfd >= 0) {
-                            g->sizeMB += (getFileSize(ulfd) >> 20);
-                            close(ulfd);
-                        }
-                    }*/
-                }
+                if (ulcount > 0 && (GameEntries = malloc(ulcount * sizeof(USBExtreme_game_entry_t))) != NULL) {
+                    // Read all records at once. Populate game entries in list even if entries are corrupted or missing.
+                    memset(GameEntries, 0, ulcount * sizeof(USBExtreme_game_entry_t));
+                    read(fd, GameEntries, ulcount * sizeof(USBExtreme_game_entry_t));
+
+                    for (; id < ulcount; id++) {
+                        base_game_info_t *g = &(*list)[id];
+                        USBExtreme_game_entry_t *GameEntry = &GameEntries[id];
+
+                        // to ensure no leaks happen, we copy manually and pad the strings
+                        memcpy(g->name, GameEntry->name, UL_GAME_NAME_MAX);
+                        g->name[UL_GAME_NAME_MAX] = '\0';
+                        memcpy(g->startup, GameEntry->startup, GAME_STARTUP_MAX);
+                        g->startup[GAME_STARTUP_MAX] = '\0';
+                        g->extension[0] = '\0';
+                        g->parts = GameEntry->parts;
+                        g->media = GameEntry->media;
+                        g->format = GAME_FORMAT_USBLD;
+                        g->sizeMB = 0;
+                    }
+                    free(GameEntries);
+
+                    // calculate total size for individual games
+                    sbReadULSizes(prefix, *list, ulcount);
+                } else
+                    count -= ulcount;
             }
         }
         close(fd);
@@ -37,9 +37,10 @@ static void cacheLoadImage(void *data)
     GSTEXTURE *texture = &req->entry->texture;
     texFree(texture);
 
-    if (handler->itemGetImage(handler, req->cache->prefix, req->cache->isPrefixRelative, req->value, req->cache->suffix, texture, GS_PSM_CT24) < 0)
+    if (handler->itemGetImage(handler, req->cache->prefix, req->cache->isPrefixRelative, req->value, req->cache->suffix, texture, &req->cache->fit) < 0) {
         req->entry->lastUsed = 0;
-    else
+        req->entry->prefetched = 0; // Nothing was loaded, so nothing can be wasted.
+    } else
         req->entry->lastUsed = guiFrameId;
 
     req->entry->qr = NULL;
@@ -47,9 +48,30 @@ static void cacheLoadImage(void *data)
     free(req);
 }
 
+// A prefetch that was cancelled because the scrolling direction changed: give the slot back without reading anything
+static void cacheReleaseImage(void *data)
+{
+    load_image_request_t *req = data;
+
+    if (!req)
+        return;
+
+    req->cache->stats.cancelled++;
+
+    // Unless the cache entry was already reused
+    if (req->cacheUID == req->entry->UID) {
+        req->entry->UID = 0;
+        req->entry->lastUsed = -1;
+        req->entry->qr = NULL;
+        req->entry->prefetched = 0; // Counted as cancelled, not as wasted.
+    }
+
+    free(req);
+}
+
 void cacheInit()
 {
-    ioRegisterHandler(IO_CACHE_LOAD_ART, &cacheLoadImage);
+    ioRegisterHandlerEx(IO_CACHE_LOAD_ART, &cacheLoadImage, &cacheReleaseImage);
 }
 
 void cacheEnd()
@@ -77,11 +99,36 @@ static void cacheClearItem(cache_entry_t *item, int freeTxt)
     item->UID = 0;
 }
 
-image_cache_t *cacheInitCache(int userId, const char *prefix, int isPrefixRelative, const char *suffix, int count)
+// Bytes of EE memory held by a loaded image
+static unsigned int cacheTextureSize(GSTEXTURE *texture)
+{
+    unsigned int size;
+
+    if (!texture->Mem)
+        return 0;
+
+    size = gsKit_texture_size_ee(texture->Width, texture->Height, texture->PSM);
+    if (texture->Clut)
+        size += texture->PSM == GS_PSM_T4 ? gsKit_texture_size_ee(8, 2, GS_PSM_CT32) : gsKit_texture_size_ee(16, 16, GS_PSM_CT32);
+
+    return size;
+}
+
+static void cacheEvictItem(image_cache_t *cache, cache_entry_t *item)
+{
+    if (item->prefetched)
+        cache->stats.wasted++;
+
+    cacheClearItem(item, 1);
+}
+
+image_cache_t *cacheInitCache(int userId, const char *prefix, int isPrefixRelative, const char *suffix, int count, unsigned int budget)
 {
     image_cache_t *cache = (image_cache_t *)malloc(sizeof(image_cache_t));
     cache->userId = userId;
     cache->count = count;
+    cache->budget = budget;
+    cache->used = 0;
     cache->prefix = NULL;
     int length;
     if (prefix) {
@@ -93,7 +140,12 @@ image_cache_t *cacheInitCache(int userId, const char *prefix, int isPrefixRelati
     length = strlen(suffix) + 1;
     cache->suffix = (char *)malloc(length * sizeof(char));
     memcpy(cache->suffix, suffix, length);
+    memset(&cache->fit, 0, sizeof(cache->fit));
     cache->nextUID = 1;
+    cache->generation = 0;
+    cache->direction = 0;
+    cache->anchor = NULL;
+    memset(&cache->stats, 0, sizeof(cache->stats));
     cache->content = (cache_entry_t *)malloc(count * sizeof(cache_entry_t));
 
     int i;
@@ -105,6 +157,9 @@ image_cache_t *cacheInitCache(int userId, const char *prefix, int isPrefixRelati
 
 void cacheDestroyCache(image_cache_t *cache)
 {
+    LOG("TEXCACHE %s: %u hits, %u misses, %u prefetched, %u wasted, %u cancelled, %u/%u bytes\n", cache->suffix,
+        cache->stats.hits, cache->stats.misses, cache->stats.prefetched, cache->stats.wasted, cache->stats.cancelled, cache->used, cache->budget);
+
     int i;
     for (i = 0; i < cache->count; ++i) {
         cacheClearItem(&cache->content[i], 1);
@@ -116,60 +171,159 @@ void cacheDestroyCache(image_cache_t *cache)
     free(cache);
 }
 
-GSTEXTURE *cacheGetTexture(image_cache_t *cache, item_list_t *list, int *cacheId, int *UID, char *value)
+// Looks up the entry the item was given. Returns 1 if the item needs a new entry, 0 otherwise.
+static int cacheLookup(image_cache_t *cache, int *cacheId, int *UID, GSTEXTURE **texture)
 {
+    *texture = NULL;
+
     if (*cacheId == -2) {
-        return NULL;
+        return 0;
     } else if (*cacheId != -1) {
         cache_entry_t *entry = &cache->content[*cacheId];
         if (entry->UID == *UID) {
             if (entry->qr)
-                return NULL;
+                return 0;
             else if (entry->lastUsed == 0) {
                 *cacheId = -2;
-                return NULL;
+                return 0;
             } else {
-                entry->lastUsed = guiFrameId;
-                return &entry->texture;
+                *texture = &entry->texture;
+                return 0;
             }
         }
 
         *cacheId = -1;
     }
 
-    // under the cache pre-delay (to avoid filling cache while moving around)
-    if (guiInactiveFrames < list->delay)
-        return NULL;
+    return 1;
+}
+
+// Picks the entry for a new image: the least recently used one that is neither being loaded nor displayed in this frame.
+// If the loaded images exceed the memory budget, the least recently used ones are released until they fit.
+static int cacheFindSlot(image_cache_t *cache)
+{
+    cache_entry_t *entry;
+    unsigned int used;
+    int i, oldest, oldestLoaded, rtime, rtimeLoaded;
+
+    while (1) {
+        used = 0;
+        oldest = -1;
+        oldestLoaded = -1;
+        rtime = guiFrameId;
+        rtimeLoaded = guiFrameId;
 
-    cache_entry_t *currEntry, *oldestEntry = NULL;
-    int i, rtime = guiFrameId;
+        for (i = 0; i < cache->count; i++) {
+            entry = &cache->content[i];
+            if (entry->qr)
+                continue;
 
-    for (i = 0; i < cache->count; i++) {
-        currEntry = &cache->content[i];
-        if ((!currEntry->qr) && (currEntry->lastUsed < rtime)) {
-            oldestEntry = currEntry;
-            rtime = currEntry->lastUsed;
-            *cacheId = i;
+            used += cacheTextureSize(&entry->texture);
+            if (entry->lastUsed < rtime) {
+                oldest = i;
+                rtime = entry->lastUsed;
+            }
+            if (entry->texture.Mem && entry->lastUsed < rtimeLoaded) {
+                oldestLoaded = i;
+                rtimeLoaded = entry->lastUsed;
+            }
         }
+
+        cache->used = used;
+        if (!cache->budget || used <= cache->budget || oldestLoaded < 0)
+            return oldest;
+
+        // The released entry is free now, so it will be picked on the next pass unless more have to go.
+        cacheEvictItem(cache, &cache->content[oldestLoaded]);
     }
+}
 
-    if (oldestEntry) {
-        load_image_request_t *req = malloc(sizeof(load_image_request_t) + strlen(value) + 1);
-        req->cache = cache;
-        req->entry = oldestEntry;
-        req->list = list;
-        req->value = (char *)req + sizeof(load_image_request_t);
-        strcpy(req->value, value);
-        req->cacheUID = cache->nextUID;
+static void cacheQueueLoad(image_cache_t *cache, item_list_t *list, int slot, int *cacheId, int *UID, char *value, int prefetch)
+{
+    cache_entry_t *entry = &cache->content[slot];
+    load_image_request_t *req = malloc(sizeof(load_image_request_t) + strlen(value) + 1);
+    req->cache = cache;
+    req->entry = entry;
+    req->list = list;
+    req->value = (char *)req + sizeof(load_image_request_t);
+    strcpy(req->value, value);
+    req->cacheUID = cache->nextUID;
 
-        cacheClearItem(oldestEntry, 1);
-        oldestEntry->qr = req;
-        oldestEntry->UID = cache->nextUID;
+    cacheEvictItem(cache, entry);
+    entry->qr = req;
+    entry->UID = cache->nextUID;
+    entry->prefetched = prefetch;
 
-        *UID = cache->nextUID++;
+    *cacheId = slot;
+    *UID = cache->nextUID++;
 
-        ioPutRequest(IO_CACHE_LOAD_ART, req);
+    // Prefetches wait behind everything else, and are cancelled when the scrolling direction changes.
+    if (ioPutRequestEx(IO_CACHE_LOAD_ART, req, prefetch ? IO_PRIORITY_LOW : IO_PRIORITY_NORMAL, 0, prefetch ? &cache->generation : NULL) != IO_OK) {
+        // Not queued (I/O blocked): the image will be asked for again.
+        entry->qr = NULL;
+        entry->UID = 0;
+        entry->lastUsed = -1;
+        free(req);
+    }
+}
+
+GSTEXTURE *cacheGetTexture(image_cache_t *cache, item_list_t *list, int *cacheId, int *UID, char *value)
+{
+    GSTEXTURE *texture;
+
+    if (!cacheLookup(cache, cacheId, UID, &texture)) {
+        if (texture) {
+            cache_entry_t *entry = &cache->content[*cacheId];
+
+            // Count each time the image comes into view, not every frame it is drawn in.
+            if (entry->prefetched || entry->lastUsed < guiFrameId - 1)
+                cache->stats.hits++;
+            entry->prefetched = 0;
+            entry->lastUsed = guiFrameId;
+        }
+
+        return texture;
+    }
+
+    // under the cache pre-delay (to avoid filling cache while moving around)
+    if (guiInactiveFrames < list->delay)
+        return NULL;
+
+    int slot = cacheFindSlot(cache);
+    if (slot >= 0) {
+        cache->stats.misses++;
+        cacheQueueLoad(cache, list, slot, cacheId, UID, value, 0);
     }
 
     return NULL;
 }
+
+int cachePrefetchTexture(image_cache_t *cache, item_list_t *list, int *cacheId, int *UID, char *value)
+{
+    GSTEXTURE *texture;
+
+    if (!cacheLookup(cache, cacheId, UID, &texture))
+        return 1; // Already loaded, being loaded or known to be missing.
+
+    // Prefetches are queued behind the images that are displayed, but not while any of those are still waiting to be loaded.
+    if (ioHasPendingRequestsAt(IO_PRIORITY_NORMAL))
+        return 0;
+
+    int slot = cacheFindSlot(cache);
+    if (slot < 0)
+        return 0;
+
+    cache->stats.prefetched++;
+    cacheQueueLoad(cache, list, slot, cacheId, UID, value, 1);
+    return 0;
+}
+
+void cacheSetDirection(image_cache_t *cache, int direction)
+{
+    if (direction != cache->direction) {
+        // The prefetches still queued are dropped.
+        cache->generation++;
+        cache->direction = direction;
+        ioCancelRequests(&cache->generation);
+    }
+}
@@ -3,6 +3,7 @@
 #include "include/util.h"
 #include "include/ioman.h"
 #include <png.h>
+#include <sys/stat.h>
 
 extern void *load0_png;
 extern void *load1_png;
@@ -100,6 +101,8 @@ extern void *apps_case_png;
 
 // Not related to screen size, just to limit at some point
 static int maxSize = 720 * 512 * 4;
+// Largest image that can be shrunk while it is read (the sums of the averaged pixels must fit into 32 bits)
+#define TEX_MAX_SOURCE 4096
 
 typedef struct
 {
@@ -126,6 +129,34 @@ typedef struct
 
 static png_texture_t pngTexture;
 
+// GS-ready copies of the images read from files, kept in a subdirectory next to them so they do not have to be decoded again.
+#define TEX_CACHE_DIR     "cache"
+#define TEX_CACHE_MAGIC   0x54474C4F // "OLGT"
+#define TEX_CACHE_VERSION 2
+// The header and the CLUT take the first block, so that the pixels start on a sector boundary.
+#define TEX_CACHE_HEADER_SIZE 2048
+
+typedef struct
+{
+    u32 magic;
+    u16 version;
+    u16 psm;
+    u16 width;
+    u16 height;
+    u16 clutPsm;
+    u16 clutSize; // bytes of CLUT after the header, 0 if none
+    u32 size;     // bytes of pixels, from TEX_CACHE_HEADER_SIZE
+    u32 srcSize;  // size and modification time of the image it was made from
+    u32 srcMtime;
+    tex_fit_t fit; // what the image was fitted to
+} tex_cache_header_t;
+
+// Cache directories that could not be written to, so that they are not tried again for every image.
+#define TEX_CACHE_RO_DIRS 8
+
+static char texCacheRoDirs[TEX_CACHE_RO_DIRS][256];
+static int texCacheRoNext;
+
 static texture_t internalDefault[TEXTURES_COUNT] = {
     {LOAD0_ICON, "load0", &load0_png},
     {LOAD1_ICON, "load1", &load1_png},
@@ -314,9 +345,8 @@ static void texReadPixels4(GSTEXTURE *texture, png_bytep *rowPointers, size_t si
         pixel[i] = (pixel[i] << 4) | (pixel[i] >> 4);
 }
 
-static void texReadPixels8(GSTEXTURE *texture, png_bytep *rowPointers, size_t size)
+static void texReadClut8(GSTEXTURE *texture)
 {
-    unsigned char *pixel = (unsigned char *)texture->Mem;
     png_clut_t *clut = (png_clut_t *)texture->Clut;
     int i;
 
@@ -336,6 +366,14 @@ static void texReadPixels8(GSTEXTURE *texture, png_bytep *rowPointers, size_t si
             clut[i + 8] = tmp;
         }
     }
+}
+
+static void texReadPixels8(GSTEXTURE *texture, png_bytep *rowPointers, size_t size)
+{
+    unsigned char *pixel = (unsigned char *)texture->Mem;
+    int i;
+
+    texReadClut8(texture);
 
     for (i = 0; i < texture->Height; i++)
         memcpy(&pixel[i * texture->Width], rowPointers[i], texture->Width);
@@ -409,7 +447,248 @@ static void texReadData(GSTEXTURE *texture, png_structp pngPtr, png_infop infoPt
     png_read_end(pngPtr, NULL);
 }
 
-static int texLoadAll(GSTEXTURE *texture, const char *filePath, int texId)
+// Reads the image one row at a time, shrinking it to the size of the texture.
+// Truecolour pixels are averaged over the area each texture pixel covers, palette indexes are sampled.
+static void texReadShrunk(GSTEXTURE *texture, png_structp pngPtr, png_infop infoPtr, int srcWidth, int srcHeight)
+{
+    int rowBytes = png_get_rowbytes(pngPtr, infoPtr);
+    size_t size = gsKit_texture_size_ee(texture->Width, texture->Height, texture->PSM);
+    int width = texture->Width, height = texture->Height;
+    int bpp = texture->PSM == GS_PSM_CT32 ? 4 : 3;
+    int x, y, sx, sy, c, x0, x1, area;
+    u32 *sums = NULL;
+    u8 *pixel;
+
+    texture->Mem = memalign(128, size);
+    png_bytep row = malloc(rowBytes);
+    if (texture->PSM != GS_PSM_T8)
+        sums = calloc(width * 4, sizeof(u32));
+
+    if (!texture->Mem || !row || (texture->PSM != GS_PSM_T8 && !sums)) {
+        LOG("TEXTURES ReadShrunk: Failed to allocate memory\n");
+        texFree(texture);
+        free(row);
+        free(sums);
+        return;
+    }
+
+    pixel = (u8 *)texture->Mem;
+    if (texture->PSM == GS_PSM_T8)
+        texReadClut8(texture);
+
+    for (sy = 0, y = 0; sy < srcHeight; sy++) {
+        png_read_row(pngPtr, row, NULL);
+
+        if (texture->PSM == GS_PSM_T8) {
+            // Take the row and the pixels nearest to the centres of the texture's.
+            if (y < height && sy == ((2 * y + 1) * srcHeight) / (2 * height)) {
+                for (x = 0; x < width; x++)
+                    *pixel++ = row[((2 * x + 1) * srcWidth) / (2 * width)];
+                y++;
+            }
+            continue;
+        }
+
+        // The source pixels are RGBA or RGB with a filler byte.
+        for (x = 0; x < width; x++) {
+            x0 = (x * srcWidth) / width;
+            x1 = ((x + 1) * srcWidth) / width;
+            for (sx = x0; sx < x1; sx++) {
+                for (c = 0; c < 4; c++)
+                    sums[x * 4 + c] += row[sx * 4 + c];
+            }
+        }
+
+        // Output row y is made of the source rows from y * srcHeight / height, up to the next one's.
+        if (sy + 1 == ((y + 1) * srcHeight) / height) {
+            int rows = sy + 1 - (y * srcHeight) / height;
+
+            for (x = 0; x < width; x++) {
+                x0 = (x * srcWidth) / width;
+                x1 = ((x + 1) * srcWidth) / width;
+                area = (x1 - x0) * rows;
+                for (c = 0; c < bpp; c++)
+                    *pixel++ = (sums[x * 4 + c] + area / 2) / area;
+                if (bpp == 4)
+                    pixel[-1] >>= 1;
+            }
+
+            memset(sums, 0, width * 4 * sizeof(u32));
+            y++;
+        }
+    }
+
+    free(sums);
+    free(row);
+
+    png_read_end(pngPtr, NULL);
+}
+
+// Median cut over a histogram of the colours reduced to 5 bits per channel
+#define TEX_QUANT_BITS  5
+#define TEX_QUANT_CELLS (1 << (3 * TEX_QUANT_BITS))
+#define TEX_QUANT_COLOURS 256
+
+typedef struct
+{
+    u8 min[3];
+    u8 max[3];
+    u32 count;
+} tex_quant_box_t;
+
+static inline int texQuantCell(int r, int g, int b)
+{
+    return (r << (2 * TEX_QUANT_BITS)) | (g << TEX_QUANT_BITS) | b;
+}
+
+// Shrinks the box to the cells that are used, and counts their pixels.
+static void texQuantShrink(tex_quant_box_t *box, const u32 *hist)
+{
+    u8 min[3] = {0xFF, 0xFF, 0xFF}, max[3] = {0, 0, 0};
+    int v[3];
+    u32 count = 0;
+
+    for (v[0] = box->min[0]; v[0] <= box->max[0]; v[0]++) {
+        for (v[1] = box->min[1]; v[1] <= box->max[1]; v[1]++) {
+            for (v[2] = box->min[2]; v[2] <= box->max[2]; v[2]++) {
+                u32 n = hist[texQuantCell(v[0], v[1], v[2])];
+                if (n) {
+                    int c;
+                    for (c = 0; c < 3; c++) {
+                        if (v[c] < min[c])
+                            min[c] = v[c];
+                        if (v[c] > max[c])
+                            max[c] = v[c];
+                    }
+                    count += n;
+                }
+            }
+        }
+    }
+
+    memcpy(box->min, min, 3);
+    memcpy(box->max, max, 3);
+    box->count = count;
+}
+
+// Splits the box in two along its longest side, at the median of its pixels. Returns 0 if it cannot be split.
+static int texQuantSplit(tex_quant_box_t *box, tex_quant_box_t *other, const u32 *hist)
+{
+    u32 planes[1 << TEX_QUANT_BITS], sum;
+    int axis = 0, c, v[3], cut;
+
+    for (c = 1; c < 3; c++) {
+        if (box->max[c] - box->min[c] > box->max[axis] - box->min[axis])
+            axis = c;
+    }
+    if (box->max[axis] == box->min[axis])
+        return 0;
+
+    memset(planes, 0, sizeof(planes));
+    for (v[0] = box->min[0]; v[0] <= box->max[0]; v[0]++) {
+        for (v[1] = box->min[1]; v[1] <= box->max[1]; v[1]++) {
+            for (v[2] = box->min[2]; v[2] <= box->max[2]; v[2]++)
+                planes[v[axis]] += hist[texQuantCell(v[0], v[1], v[2])];
+        }
+    }
+
+    // Cut after the plane that brings half of the pixels behind, leaving at least one plane on the other side.
+    sum = 0;
+    for (cut = box->min[axis]; cut < box->max[axis] - 1; cut++) {
+        sum += planes[cut];
+        if (sum >= box->count / 2)
+            break;
+    }
+
+    *other = *box;
+    box->max[axis] = cut;
+    other->min[axis] = cut + 1;
+    texQuantShrink(box, hist);
+    texQuantShrink(other, hist);
+    return 1;
+}
+
+// Reduces a CT24 texture to T8, with a palette chosen by median cut.
+static int texPalettize(GSTEXTURE *texture)
+{
+    tex_quant_box_t *boxes;
+    png_clut_t *clut;
+    u32 *hist;
+    u8 *src, *dst, *pixel;
+    int i, count, pixels = texture->Width * texture->Height;
+
+    hist = calloc(TEX_QUANT_CELLS, sizeof(u32));
+    boxes = malloc(TEX_QUANT_COLOURS * sizeof(tex_quant_box_t));
+    dst = memalign(128, gsKit_texture_size_ee(texture->Width, texture->Height, GS_PSM_T8));
+    clut = memalign(128, gsKit_texture_size_ee(16, 16, GS_PSM_CT32));
+    if (!hist || !boxes || !dst || !clut) {
+        free(hist);
+        free(boxes);
+        free(dst);
+        free(clut);
+        return -1;
+    }
+
+    src = (u8 *)texture->Mem;
+    for (i = 0, pixel = src; i < pixels; i++, pixel += 3)
+        hist[texQuantCell(pixel[0] >> 3, pixel[1] >> 3, pixel[2] >> 3)]++;
+
+    memset(boxes[0].min, 0, 3);
+    memset(boxes[0].max, (1 << TEX_QUANT_BITS) - 1, 3);
+    texQuantShrink(&boxes[0], hist);
+
+    // Split the most populated box until the palette is full, or every box is down to a single colour.
+    for (count = 1; count < TEX_QUANT_COLOURS; count++) {
+        int best = -1;
+        for (i = 0; i < count; i++) {
+            if (memcmp(boxes[i].min, boxes[i].max, 3) && (best < 0 || boxes[i].count > boxes[best].count))
+                best = i;
+        }
+        if (best < 0 || !texQuantSplit(&boxes[best], &boxes[count], hist))
+            break;
+    }
+
+    // Each box gives the average of its colours, then its cells are turned into its index.
+    memset(clut, 0, gsKit_texture_size_ee(16, 16, GS_PSM_CT32));
+    for (i = 0; i < count; i++) {
+        tex_quant_box_t *box = &boxes[i];
+        u32 sums[3] = {0, 0, 0};
+        int v[3], c;
+
+        for (v[0] = box->min[0]; v[0] <= box->max[0]; v[0]++) {
+            for (v[1] = box->min[1]; v[1] <= box->max[1]; v[1]++) {
+                for (v[2] = box->min[2]; v[2] <= box->max[2]; v[2]++) {
+                    u32 *cell = &hist[texQuantCell(v[0], v[1], v[2])];
+                    for (c = 0; c < 3; c++)
+                        sums[c] += *cell * ((v[c] << 3) | (v[c] >> 2));
+                    *cell = i;
+                }
+            }
+        }
+
+        // The CLUT is stored in CSM1 order: entries 8-15 of each 32 are swapped with 16-23.
+        int entry = ((i & 0x18) == 8 || (i & 0x18) == 16) ? i ^ 0x18 : i;
+        clut[entry].red = (sums[0] + box->count / 2) / box->count;
+        clut[entry].green = (sums[1] + box->count / 2) / box->count;
+        clut[entry].blue = (sums[2] + box->count / 2) / box->count;
+        clut[entry].alpha = 0x80;
+    }
+
+    for (i = 0, pixel = src; i < pixels; i++, pixel += 3)
+        dst[i] = hist[texQuantCell(pixel[0] >> 3, pixel[1] >> 3, pixel[2] >> 3)];
+
+    free(hist);
+    free(boxes);
+
+    texFree(texture);
+    texture->Mem = dst;
+    texture->Clut = clut;
+    texture->PSM = GS_PSM_T8;
+    texture->ClutPSM = GS_PSM_CT32;
+    return 0;
+}
+
+static int texLoadAll(GSTEXTURE *texture, const char *filePath, int texId, const tex_fit_t *fit)
 {
     texPrepare(texture);
     png_structp pngPtr = NULL;
@@ -477,6 +756,18 @@ static int texLoadAll(GSTEXTURE *texture, const char *filePath, int texId)
     texture->Width = pngWidth;
     texture->Height = pngHeight;
 
+    // Interlaced images cannot be read one row at a time, and 4-bit indexes are not worth the trouble.
+    int shrink = 0;
+    if (fit && interlaceType == PNG_INTERLACE_NONE && !(colorType == PNG_COLOR_TYPE_PALETTE && bitDepth == 4)) {
+        if (fit->width > 0 && texture->Width > fit->width)
+            texture->Width = fit->width;
+        if (fit->height > 0 && texture->Height > fit->height)
+            texture->Height = fit->height;
+        shrink = (texture->Width != pngWidth || texture->Height != pngHeight);
+        if (shrink && (pngWidth > TEX_MAX_SOURCE || pngHeight > TEX_MAX_SOURCE))
+            return texEnd(pngPtr, infoPtr, pFileBuffer, ERR_BAD_DIMENSION);
+    }
+
     if (bitDepth == 16)
         png_set_strip_16(pngPtr);
 
@@ -534,24 +825,182 @@ static int texLoadAll(GSTEXTURE *texture, const char *filePath, int texId)
         return texEnd(pngPtr, infoPtr, pFileBuffer, ERR_BAD_DIMENSION);
     }
 
-    texReadData(texture, pngPtr, infoPtr, texPngReadPixels);
+    if (shrink)
+        texReadShrunk(texture, pngPtr, infoPtr, pngWidth, pngHeight);
+    else
+        texReadData(texture, pngPtr, infoPtr, texPngReadPixels);
+
+    if (fit && fit->palettize && texture->Mem && texture->PSM == GS_PSM_CT24)
+        texPalettize(texture);
 
     return texEnd(pngPtr, infoPtr, pFileBuffer, 0);
 }
 
-static int texLoad(GSTEXTURE *texture, const char *filePath)
+static int texLoad(GSTEXTURE *texture, const char *filePath, const tex_fit_t *fit)
 {
-    return texLoadAll(texture, filePath, -1);
+    return texLoadAll(texture, filePath, -1, fit);
 }
 
 int texLoadInternal(GSTEXTURE *texture, int texId)
 {
-    return texLoadAll(texture, NULL, texId);
+    return texLoadAll(texture, NULL, texId, NULL);
 }
 
-int texDiscoverLoad(GSTEXTURE *texture, const char *path, int texId)
+// Builds the path of the cached copy of an image: <dir>/cache/<name>.gst
+static void texCachePath(char *cachePath, int size, const char *filePath)
 {
-    char filePath[256];
+    const char *name = strrchr(filePath, '/');
+    const char *ext;
+    int dirLen;
+
+    if (!name)
+        name = strchr(filePath, ':');
+    name = name ? name + 1 : filePath;
+    dirLen = name - filePath;
+
+    ext = strrchr(name, '.');
+    if (!ext)
+        ext = name + strlen(name);
+
+    snprintf(cachePath, size, "%.*s" TEX_CACHE_DIR "/%.*s.gst", dirLen, filePath, (int)(ext - name), name);
+}
+
+static int texCacheLoad(GSTEXTURE *texture, const char *cachePath, const struct stat *src, const tex_fit_t *fit)
+{
+    tex_cache_header_t *header;
+    u8 *block;
+    int fd, result = ERR_BAD_FILE;
+
+    fd = open(cachePath, O_RDONLY);
+    if (fd < 0)
+        return ERR_BAD_FILE;
+
+    texPrepare(texture);
+
+    block = memalign(64, TEX_CACHE_HEADER_SIZE);
+    if (block == NULL || read(fd, block, TEX_CACHE_HEADER_SIZE) != TEX_CACHE_HEADER_SIZE)
+        goto end;
+
+    header = (tex_cache_header_t *)block;
+    if (header->magic != TEX_CACHE_MAGIC || header->version != TEX_CACHE_VERSION || header->srcSize != (u32)src->st_size || header->srcMtime != (u32)src->st_mtime)
+        goto end;
+    if (memcmp(&header->fit, fit, sizeof(tex_fit_t)))
+        goto end;
+    if (sizeof(tex_cache_header_t) + header->clutSize > TEX_CACHE_HEADER_SIZE || texSizeValidate(header->width, header->height, header->psm) < 0)
+        goto end;
+    if (header->size != (u32)gsKit_texture_size_ee(header->width, header->height, header->psm))
+        goto end;
+
+    texture->Width = header->width;
+    texture->Height = header->height;
+    texture->PSM = header->psm;
+    texture->ClutPSM = header->clutPsm;
+
+    if (header->clutSize) {
+        texture->Clut = memalign(128, header->clutSize);
+        if (!texture->Clut)
+            goto end;
+        memcpy(texture->Clut, block + sizeof(tex_cache_header_t), header->clutSize);
+    }
+
+    // The pixels are read in one go, straight into the texture.
+    texture->Mem = memalign(128, header->size);
+    if (texture->Mem && read(fd, texture->Mem, header->size) == (int)header->size)
+        result = 0;
+
+end:
+    if (result < 0)
+        texFree(texture);
+    free(block);
+    close(fd);
+    return result;
+}
+
+static int texCacheWrite(int fd, GSTEXTURE *texture, const struct stat *src, const tex_fit_t *fit)
+{
+    tex_cache_header_t *header;
+    u8 *block;
+    int size, result = -1;
+
+    block = memalign(64, TEX_CACHE_HEADER_SIZE);
+    if (!block)
+        return -1;
+    memset(block, 0, TEX_CACHE_HEADER_SIZE);
+
+    size = gsKit_texture_size_ee(texture->Width, texture->Height, texture->PSM);
+
+    header = (tex_cache_header_t *)block;
+    header->magic = TEX_CACHE_MAGIC;
+    header->version = TEX_CACHE_VERSION;
+    header->psm = texture->PSM;
+    header->width = texture->Width;
+    header->height = texture->Height;
+    header->clutPsm = texture->ClutPSM;
+    header->size = size;
+    header->srcSize = src->st_size;
+    header->srcMtime = src->st_mtime;
+    header->fit = *fit;
+    if (texture->Clut) {
+        header->clutSize = texture->PSM == GS_PSM_T4 ? gsKit_texture_size_ee(8, 2, GS_PSM_CT32) : gsKit_texture_size_ee(16, 16, GS_PSM_CT32);
+        memcpy(block + sizeof(tex_cache_header_t), texture->Clut, header->clutSize);
+    }
+
+    if (write(fd, block, TEX_CACHE_HEADER_SIZE) == TEX_CACHE_HEADER_SIZE && write(fd, texture->Mem, size) == size)
+        result = 0;
+
+    free(block);
+    return result;
+}
+
+static void texCacheSetReadOnly(const char *dirPath)
+{
+    LOG("texCacheStore: cannot write to %s\n", dirPath);
+    strcpy(texCacheRoDirs[texCacheRoNext], dirPath);
+    texCacheRoNext = (texCacheRoNext + 1) % TEX_CACHE_RO_DIRS;
+}
+
+static void texCacheStore(GSTEXTURE *texture, const char *cachePath, const struct stat *src, const tex_fit_t *fit)
+{
+    char dirPath[256];
+    int i, fd, result;
+
+    snprintf(dirPath, sizeof(dirPath), "%.*s", (int)(strrchr(cachePath, '/') - cachePath), cachePath);
+    for (i = 0; i < TEX_CACHE_RO_DIRS; i++) {
+        if (strcmp(texCacheRoDirs[i], dirPath) == 0)
+            return;
+    }
+
+    fd = open(cachePath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        // The first image cached in this directory: create the cache directory.
+        mkdir(dirPath, 0777);
+
+        fd = open(cachePath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0) {
+            texCacheSetReadOnly(dirPath);
+            return;
+        }
+    }
+
+    result = texCacheWrite(fd, texture, src, fit);
+    close(fd);
+
+    // Do not leave a truncated copy behind.
+    if (result < 0) {
+        remove(cachePath);
+        texCacheSetReadOnly(dirPath);
+    }
+}
+
+int texDiscoverLoad(GSTEXTURE *texture, const char *path, int texId, const tex_fit_t *fit)
+{
+    static const tex_fit_t noFit = {0, 0, 0};
+    char filePath[256], cachePath[256];
+    struct stat st;
+    int useCache;
+
+    if (!fit)
+        fit = &noFit;
 
     LOG("texDiscoverLoad(%s)\n", path);
 
@@ -560,12 +1009,23 @@ int texDiscoverLoad(GSTEXTURE *texture, const char *path, int texId)
     else
         snprintf(filePath, sizeof(filePath), "%s.%s", path, "png");
 
-    int fd = open(filePath, O_RDONLY);
-    if (fd > 0) {
-        // File found, load it
-        close(fd);
-        return (texLoad(texture, filePath) >= 0) ? 0 : ERR_BAD_FILE;
+    if (stat(filePath, &st) != 0)
+        return ERR_BAD_FILE;
+
+    // Memory cards are too small and slow to be worth it.
+    useCache = gTextureCache && strncmp(filePath, "mc", 2) != 0;
+    if (useCache) {
+        texCachePath(cachePath, sizeof(cachePath), filePath);
+        if (texCacheLoad(texture, cachePath, &st, fit) == 0)
+            return 0;
     }
 
-    return ERR_BAD_FILE;
+    // File found, load it
+    if (texLoad(texture, filePath, fit) < 0)
+        return ERR_BAD_FILE;
+
+    if (useCache && texture->Mem)
+        texCacheStore(texture, cachePath, &st, fit);
+
+    return 0;
 }
\ No newline at end of file
@@ -363,7 +363,7 @@ static image_texture_t *initImageTexture(const char *themePath, config_set_t *th
     if (themePath) {
         char path[256];
         snprintf(path, sizeof(path), "%s%s", themePath, imgName);
-        if (texDiscoverLoad(&texture->source, path, texId) >= 0)
+        if (texDiscoverLoad(&texture->source, path, texId, NULL) >= 0)
             ;
         result = 1;
     } else {
@@ -454,6 +454,11 @@ static void endMutableImage(struct theme_element *elem)
     free(elem);
 }
 
+// Game images loaded ahead of the selected item, in the scrolling direction
+#define GAME_IMAGE_PREFETCH 4
+// Default memory budget of a game image cache, in KiB per image of its count
+#define GAME_IMAGE_BUDGET 96
+
 static mutable_image_t *initMutableImage(const char *themePath, config_set_t *themeConfig, theme_t *theme, const char *name, int type, const char *cachePattern, int cacheCount, const char *defaultTexture, const char *overlayTexture)
 {
     mutable_image_t *mutableImage = (mutable_image_t *)malloc(sizeof(mutable_image_t));
@@ -468,6 +473,7 @@ static mutable_image_t *initMutableImage(const char *themePath, config_set_t *th
     mutableImage->overlayTextureLinked = 0;
 
     char elemProp[64];
+    int cacheBudget = -1;
 
     if (type == ELEM_TYPE_ATTRIBUTE_IMAGE) {
         snprintf(elemProp, sizeof(elemProp), "%s_attribute", name);
@@ -478,7 +484,11 @@ static mutable_image_t *initMutableImage(const char *themePath, config_set_t *th
         configGetStr(themeConfig, elemProp, &cachePattern);
         snprintf(elemProp, sizeof(elemProp), "%s_count", name);
         configGetInt(themeConfig, elemProp, &cacheCount);
-        LOG("THEMES MutableImage %s: type: %s using cache pattern: %s count: %d\n", name, elementsType[type], cachePattern, cacheCount);
+        snprintf(elemProp, sizeof(elemProp), "%s_budget", name);
+        configGetInt(themeConfig, elemProp, &cacheBudget);
+        if (cacheBudget < 0)
+            cacheBudget = cacheCount * GAME_IMAGE_BUDGET;
+        LOG("THEMES MutableImage %s: type: %s using cache pattern: %s count: %d budget: %dKiB\n", name, elementsType[type], cachePattern, cacheCount, cacheBudget);
     }
 
     snprintf(elemProp, sizeof(elemProp), "%s_default", name);
@@ -496,9 +506,9 @@ static mutable_image_t *initMutableImage(const char *themePath, config_set_t *th
 
     if (cachePattern && !mutableImage->cache) {
         if (type == ELEM_TYPE_ATTRIBUTE_IMAGE)
-            mutableImage->cache = cacheInitCache(-1, themePath, 0, cachePattern, 1);
-        else
-            mutableImage->cache = cacheInitCache(theme->gameCacheCount++, "ART", 1, cachePattern, cacheCount);
+            mutableImage->cache = cacheInitCache(-1, themePath, 0, cachePattern, 1, 0);
+        else // The budget limits the images held, the extra entries leave room for the prefetched ones.
+            mutableImage->cache = cacheInitCache(theme->gameCacheCount++, "ART", 1, cachePattern, cacheCount + GAME_IMAGE_PREFETCH, cacheBudget * 1024);
     }
 
     if (!themePath)
@@ -546,17 +556,54 @@ static GSTEXTURE *getGameImageTexture(image_cache_t *cache, void *support, struc
     if (gEnableArt) {
         item_list_t *list = (item_list_t *)support;
         char *startup = list->itemGetStartup(list, item->id);
+        if (startup[0] == '\0')
+            return NULL; // Not read yet: do not let the cache record a missing image.
         return cacheGetTexture(cache, list, &item->cache_id[cache->userId], &item->cache_uid[cache->userId], startup);
     }
 
     return NULL;
 }
 
+// Loads the images of the next items in the scrolling direction while the I/O thread has nothing else to do.
+static void prefetchGameImages(image_cache_t *cache, void *support, struct submenu_list *item)
+{
+    item_list_t *list = (item_list_t *)support;
+    int i;
+
+    if (!gEnableArt)
+        return;
+
+    // Only compare the previous item: it may have been freed since.
+    if (item != cache->anchor) {
+        if (item->prev && item->prev == cache->anchor)
+            cacheSetDirection(cache, 1);
+        else if (item->next && item->next == cache->anchor)
+            cacheSetDirection(cache, -1);
+        cache->anchor = item;
+    }
+
+    if (!cache->direction)
+        cacheSetDirection(cache, 1);
+
+    for (i = 0; i < GAME_IMAGE_PREFETCH; i++) {
+        item = cache->direction > 0 ? item->next : item->prev;
+        if (!item)
+            break;
+
+        char *startup = list->itemGetStartup(list, item->item.id);
+        if (startup[0] == '\0')
+            continue;
+        if (!cachePrefetchTexture(cache, list, &item->item.cache_id[cache->userId], &item->item.cache_uid[cache->userId], startup))
+            break;
+    }
+}
+
 static void drawGameImage(struct menu_list *menu, struct submenu_list *item, config_set_t *config, struct theme_element *elem)
 {
     mutable_image_t *gameImage = (mutable_image_t *)elem->extended;
     if (item) {
         GSTEXTURE *texture = getGameImageTexture(gameImage->cache, menu->item->userdata, &item->item);
+        prefetchGameImages(gameImage->cache, menu->item->userdata, item);
         if (!texture || !texture->Mem) {
             if (gameImage->defaultTexture)
                 texture = &gameImage->defaultTexture->source;
@@ -582,11 +629,41 @@ static void drawGameImage(struct menu_list *menu, struct submenu_list *item, con
     }
 }
 
+// Game images are shrunk to the size their element draws them at when they are loaded, and may be palettized.
+static void initGameImageFit(config_set_t *themeConfig, const char *name, theme_element_t *elem, mutable_image_t *mutableImage)
+{
+    char elemProp[64];
+    tex_fit_t fit;
+    int palettize = (elem->type == ELEM_TYPE_GAME_IMAGE); // Backgrounds would show banding
+
+    if (!mutableImage->cache)
+        return;
+
+    snprintf(elemProp, sizeof(elemProp), "%s_palettize", name);
+    configGetInt(themeConfig, elemProp, &palettize);
+
+    fit.width = (elem->width != DIM_UNDEF) ? rmScaleX(elem->width) : 0;
+    fit.height = (elem->height != DIM_UNDEF) ? rmScaleY(elem->height) : 0;
+    fit.palettize = palettize;
+
+    // A shared cache keeps the largest size, and only palettizes if all of its elements allow it.
+    if (mutableImage->cacheLinked) {
+        tex_fit_t *current = &mutableImage->cache->fit;
+        current->width = (current->width && fit.width) ? max(current->width, fit.width) : 0;
+        current->height = (current->height && fit.height) ? max(current->height, fit.height) : 0;
+        current->palettize = current->palettize && fit.palettize;
+    } else
+        mutableImage->cache->fit = fit;
+
+    LOG("THEMES GameImage %s: fitted to %dx%d, palettize: %d\n", name, mutableImage->cache->fit.width, mutableImage->cache->fit.height, mutableImage->cache->fit.palettize);
+}
+
 static void initGameImage(const char *themePath, config_set_t *themeConfig, theme_t *theme, theme_element_t *elem, const char *name, const char *pattern, int count, const char *texture, const char *overlay)
 {
     mutable_image_t *mutableImage = initMutableImage(themePath, themeConfig, theme, name, elem->type, pattern, count, texture, overlay);
     elem->extended = mutableImage;
     elem->endElem = &endMutableImage;
+    initGameImageFit(themeConfig, name, elem, mutableImage);
 
     if (mutableImage->cache)
         elem->drawElem = &drawGameImage;
@@ -761,6 +838,7 @@ static void initBackground(const char *themePath, config_set_t *themeConfig, the
     mutable_image_t *mutableImage = initMutableImage(themePath, themeConfig, theme, name, elem->type, pattern, count, texture, NULL);
     elem->extended = mutableImage;
     elem->endElem = &endMutableImage;
+    initGameImageFit(themeConfig, name, elem, mutableImage);
 
     if (mutableImage->cache)
         elem->drawElem = &drawGameImage;
@@ -1183,7 +1261,7 @@ static int thmLoadResource(GSTEXTURE *texture, int texId, const char *themePath,
     int success = -1;
 
     if (themePath != NULL)
-        success = texDiscoverLoad(texture, themePath, texId); // only set success here
+        success = texDiscoverLoad(texture, themePath, texId, NULL); // only set success here
 
     if ((success < 0) && useDefault)
         texLoadInternal(texture, texId); // we don't mind the result of "default"
@@ -38,10 +38,10 @@ static void longLseek(int fd, unsigned int lba)
     }
 }
 
-int read_raw_data(u8 *addr, u32 size, u32 offset, u32 shift)
+int read_raw_data(u8 *addr, u32 size, u64 offset)
 {
-    u32 lba = offset / (2048 >> shift); // avoid overflow by shifting sector size instead of offset
-    u32 pos = (offset << shift) & 2047; // doesn't matter if it overflows since we only care about the 11 LSB anyways
+    u32 lba = offset >> 11;
+    u32 pos = (u32)offset & 2047;
     if (probed_fd > 0) {                // USB/ETH
         longLseek(probed_fd, lba);
         lseek(probed_fd, pos, SEEK_CUR);
@@ -86,4 +86,9 @@ int read_raw_data(u8 *addr, u32 size, u32 offset, u32 shift)
 void *ziso_alloc(u32 size)
 {
     return malloc(size);
+}
+
+void ziso_free(void *ptr)
+{
+    free(ptr);
 }
\ No newline at end of file